@@ -0,0 +1,385 @@
+#include "AggregateLane.h"
+#include "RingWriteKernels.h"
+#include "Transport/SharedMemoryWait.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+
+AggregateLane::~AggregateLane()
+{
+    close();
+}
+
+bool AggregateLane::mapSegment()
+{
+    constexpr size_t bytes = sizeof(SharedAggregateSegment);
+
+    char name[64];
+    SharedAggregateSegment::nameFor(static_cast<uint32_t>(getuid()), name, sizeof(name));
+
+    // Exactly one instance creates and initialises the segment; the rest attach to it
+    fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    const bool created = fd != -1;
+
+    if (!created)
+        fd = shm_open(name, O_RDWR, 0600);
+
+    if (fd == -1)
+    {
+        juce::Logger::writeToLog("Aggregation: failed to open shared memory: " + juce::String(strerror(errno)));
+        return false;
+    }
+
+    if (created && ftruncate(fd, static_cast<off_t>(bytes)) == -1)
+    {
+        juce::Logger::writeToLog("Aggregation: failed to size shared memory: " + juce::String(strerror(errno)));
+        shm_unlink(name);
+        return false;
+    }
+
+    // An attaching instance may get here before the creator has sized the segment
+    const double deadline = juce::Time::getMillisecondCounterHiRes() + ATTACH_TIMEOUT_MS;
+    struct stat info {};
+    if (fstat(fd, &info) == -1 || info.st_uid != getuid())
+    {
+        juce::Logger::writeToLog("Aggregation: shared memory " + juce::String(name) + " belongs to another user");
+        return false;
+    }
+
+    while (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) < bytes)
+    {
+        if (juce::Time::getMillisecondCounterHiRes() > deadline)
+        {
+            juce::Logger::writeToLog("Aggregation: shared memory has the wrong size");
+            return false;
+        }
+        juce::Thread::sleep(1);
+    }
+
+    void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED)
+    {
+        juce::Logger::writeToLog("Aggregation: failed to map shared memory: " + juce::String(strerror(errno)));
+        return false;
+    }
+
+    segment = static_cast<SharedAggregateSegment*>(mapped);
+
+    if (created)
+    {
+        // ftruncate zero-fills, so every lane starts FREE and every cursor at 0
+        new (&segment->layoutVersion) std::atomic<uint32_t>(SharedAggregateSegment::LAYOUT_VERSION);
+        segment->magic.store(SharedAggregateSegment::MAGIC, std::memory_order_release);
+        return true;
+    }
+
+    while (segment->magic.load(std::memory_order_acquire) != SharedAggregateSegment::MAGIC)
+    {
+        if (juce::Time::getMillisecondCounterHiRes() > deadline)
+        {
+            juce::Logger::writeToLog("Aggregation: shared memory was never initialised");
+            return false;
+        }
+        juce::Thread::sleep(1);
+    }
+
+    if (segment->layoutVersion.load(std::memory_order_relaxed) != SharedAggregateSegment::LAYOUT_VERSION)
+    {
+        juce::Logger::writeToLog("Aggregation: shared memory has layout version "
+                                 + juce::String(segment->layoutVersion.load(std::memory_order_relaxed))
+                                 + ", expected " + juce::String(SharedAggregateSegment::LAYOUT_VERSION));
+        return false;
+    }
+
+    return true;
+}
+
+bool AggregateLane::open(const juce::String& name, int numChannels, double sampleRate, int periodFrames)
+{
+    close();
+
+    if (numChannels <= 0 || sampleRate <= 0.0)
+        return false;
+
+    // The lane comes first, so every instance that has joined the format owns a lane
+    // (joinFormat() relies on that to spot a format left behind by dead processes)
+    if (!mapSegment() || !claimLane() || !joinFormat(sampleRate, periodFrames))
+    {
+        close();
+        return false;
+    }
+
+    // Not live (lastWriteNs 0) until the first write, so the receiver ignores it meanwhile
+    laneChannels = juce::jmin(numChannels, SharedAggregateSegment::MAX_LANE_CHANNELS);
+    truncatedChannels.store(numChannels - laneChannels, std::memory_order_relaxed);
+    lane->lastWriteNs.store(0, std::memory_order_release);
+    lane->numChannels.store(static_cast<uint32_t>(laneChannels), std::memory_order_relaxed);
+    lane->sourceChannels.store(static_cast<uint32_t>(numChannels), std::memory_order_relaxed);
+    lane->startPosition.store(0, std::memory_order_relaxed);
+    lane->writtenPosition.store(0, std::memory_order_relaxed);
+    std::memset(lane->name, 0, sizeof(lane->name));
+    name.copyToUTF8(lane->name, sizeof(lane->name) - 1);
+    std::memset(segment->laneData[laneIndex], 0, sizeof(segment->laneData[laneIndex]));
+
+    if (laneChannels < numChannels)
+        juce::Logger::writeToLog("Aggregation: lanes carry at most " + juce::String(SharedAggregateSegment::MAX_LANE_CHANNELS)
+                                 + " channels; sending the first " + juce::String(laneChannels) + " of " + juce::String(numChannels));
+
+    started = false;
+    juce::Logger::writeToLog("Aggregation: writing lane " + juce::String(laneIndex) + " (" + juce::String(laneChannels) + " channels)");
+    return true;
+}
+
+bool AggregateLane::claimLane()
+{
+    // Claim a free lane, or one left behind by a process that no longer exists
+    const int pid = static_cast<int>(getpid());
+    for (int index = 0; index < SharedAggregateSegment::MAX_LANES && lane == nullptr; ++index)
+    {
+        auto& candidate = segment->lanes[index];
+        uint32_t expected = SharedAggregateSegment::Lane::FREE;
+
+        if (candidate.state.compare_exchange_strong(expected, SharedAggregateSegment::Lane::CLAIMED, std::memory_order_acq_rel))
+        {
+            candidate.ownerPid.store(pid, std::memory_order_relaxed);
+            lane = &candidate;
+            laneIndex = index;
+            continue;
+        }
+
+        int owner = candidate.ownerPid.load(std::memory_order_relaxed);
+        if (owner != pid && kill(owner, 0) == -1 && errno == ESRCH
+            && candidate.ownerPid.compare_exchange_strong(owner, pid, std::memory_order_acq_rel))
+        {
+            lane = &candidate;
+            laneIndex = index;
+        }
+    }
+
+    if (lane == nullptr)
+    {
+        juce::Logger::writeToLog("Aggregation: all " + juce::String(SharedAggregateSegment::MAX_LANES) + " lanes are in use");
+        return false;
+    }
+
+    return true;
+}
+
+bool AggregateLane::joinFormat(double sampleRate, int periodFrames)
+{
+    const uint64_t wantedRate = SharedAggregateSegment::packFormat(sampleRate, 0);
+    uint64_t format = segment->format.load(std::memory_order_acquire);
+
+    for (;;)
+    {
+        uint32_t openLanes = SharedAggregateSegment::openLanesOf(format);
+
+        if (openLanes > 0 && (format >> 32) != (wantedRate >> 32))
+        {
+            // Another rate is set. That stands while any other lane's process is alive;
+            // if they all died without closing, the format is stale and is taken over.
+            const int pid = static_cast<int>(getpid());
+            for (const auto& other : segment->lanes)
+            {
+                const int owner = other.ownerPid.load(std::memory_order_relaxed);
+                if (&other != lane && other.state.load(std::memory_order_acquire) == SharedAggregateSegment::Lane::CLAIMED
+                    && (owner == pid || kill(owner, 0) == 0 || errno != ESRCH))
+                {
+                    juce::Logger::writeToLog("Aggregation: segment runs at " + juce::String(SharedAggregateSegment::sampleRateOf(format))
+                                             + " Hz, not " + juce::String(sampleRate) + " Hz");
+                    return false;
+                }
+            }
+
+            openLanes = 0;
+        }
+
+        const uint64_t joined = openLanes == 0 ? SharedAggregateSegment::packFormat(sampleRate, 1) : format + 1;
+        if (segment->format.compare_exchange_weak(format, joined, std::memory_order_acq_rel))
+        {
+            // The first lane of a session also sets the receiver's wakeup period
+            if (openLanes == 0)
+                segment->periodFrames.store(static_cast<uint32_t>(juce::jmax(0, periodFrames)), std::memory_order_relaxed);
+
+            joinedFormat = true;
+            return true;
+        }
+    }
+}
+
+void AggregateLane::leaveFormat()
+{
+    // The last lane out clears the rate, so the next session may choose another one
+    uint64_t format = segment->format.load(std::memory_order_acquire);
+    while (SharedAggregateSegment::openLanesOf(format) > 0)
+    {
+        const uint64_t left = SharedAggregateSegment::openLanesOf(format) == 1 ? 0 : format - 1;
+        if (segment->format.compare_exchange_weak(format, left, std::memory_order_acq_rel))
+            break;
+    }
+
+    joinedFormat = false;
+}
+
+void AggregateLane::close()
+{
+    if (joinedFormat && segment != nullptr)
+        leaveFormat();
+
+    truncatedChannels.store(0, std::memory_order_relaxed);
+
+    if (lane != nullptr)
+    {
+        lane->lastWriteNs.store(0, std::memory_order_release);
+        lane->state.store(SharedAggregateSegment::Lane::FREE, std::memory_order_release);
+        lane = nullptr;
+    }
+    laneIndex = -1;
+
+    if (segment != nullptr)
+    {
+        munmap(segment, sizeof(SharedAggregateSegment));
+        segment = nullptr;
+    }
+
+    if (fd != -1)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+uint64_t AggregateLane::alignedPosition(juce::int64 hostPosition)
+{
+    const uint64_t host = static_cast<uint64_t>(juce::jmax<juce::int64>(0, hostPosition));
+    const uint64_t written = lane->writtenPosition.load(std::memory_order_relaxed);
+    uint64_t offset = segment->timelineOffset.load(std::memory_order_acquire);
+
+    if (!started || host + offset >= written)
+        return host + offset;
+
+    // The host went back (loop, locate) or isn't moving (stopped). Continue from the
+    // furthest any live lane got; the other lanes of this cycle, seeing the same host
+    // position, then land on the same slots.
+    const uint64_t now = SharedAggregateSegment::nowNs();
+    uint64_t furthest = written;
+    for (const auto& other : segment->lanes)
+        if (SharedAggregateSegment::isLive(other, now))
+            furthest = juce::jmax(furthest, other.writtenPosition.load(std::memory_order_acquire));
+
+    // Another lane raising the offset meanwhile fails the CAS with a bigger offset, which
+    // ends the loop as soon as it reaches wanted
+    const uint64_t wanted = furthest - host;
+    for (int attempt = 0; attempt < MAX_CAS_ATTEMPTS && offset < wanted; ++attempt)
+        if (segment->timelineOffset.compare_exchange_weak(offset, wanted, std::memory_order_acq_rel))
+            break;
+
+    return host + segment->timelineOffset.load(std::memory_order_acquire);
+}
+
+void AggregateLane::clearFrames(uint64_t position, uint64_t numFrames)
+{
+    numFrames = juce::jmin(numFrames, SharedAggregateSegment::CAPACITY_FRAMES);
+    const uint64_t firstRun = juce::jmin(numFrames, SharedAggregateSegment::CAPACITY_FRAMES - (position & SharedAggregateSegment::CAPACITY_MASK));
+    const size_t frameBytes = static_cast<size_t>(laneChannels) * sizeof(float);
+
+    std::memset(segment->laneFrame(laneIndex, position), 0, firstRun * frameBytes);
+    if (numFrames > firstRun)
+        std::memset(segment->laneFrame(laneIndex, position + firstRun), 0, (numFrames - firstRun) * frameBytes);
+}
+
+void AggregateLane::advanceComplete(uint64_t now)
+{
+    // Only the lane that completes a position moves the cursor, so it moves once per position
+    const uint64_t own = lane->writtenPosition.load(std::memory_order_relaxed);
+    uint64_t written[SharedAggregateSegment::MAX_LANES] {};   // 0 for lanes that aren't live
+    uint64_t furthest = own;
+
+    for (int index = 0; index < SharedAggregateSegment::MAX_LANES; ++index)
+        if (SharedAggregateSegment::isLive(segment->lanes[index], now))
+            furthest = juce::jmax(furthest, written[index] = segment->lanes[index].writtenPosition.load(std::memory_order_acquire));
+
+    // A lane this far behind would keep the cursor back until the others lap the audio
+    // the receiver hasn't read yet; it holds the cursor again once it catches up
+    uint64_t complete = own;
+    for (const uint64_t position : written)
+        if (position != 0 && position + SharedAggregateSegment::MAX_LANE_LAG_FRAMES >= furthest)
+            complete = juce::jmin(complete, position);
+
+    uint64_t previous = segment->completePosition.load(std::memory_order_relaxed);
+    bool advanced = false;
+    for (int attempt = 0; attempt < MAX_CAS_ATTEMPTS && !advanced && previous < complete; ++attempt)
+        advanced = segment->completePosition.compare_exchange_weak(previous, complete, std::memory_order_acq_rel);
+
+    // Whoever moved it past complete meanwhile also did the wakeup
+    if (!advanced)
+        return;
+
+    const uint64_t period = juce::jmax<uint64_t>(1, segment->periodFrames.load(std::memory_order_relaxed));
+    if (previous / period != complete / period)
+    {
+        segment->completeNotify.fetch_add(1, std::memory_order_release);
+        if (segment->waiters.load(std::memory_order_acquire) != 0)
+            SharedMemoryWait::wakeAll(segment->completeNotify);
+    }
+}
+
+template <typename SampleType>
+void AggregateLane::write(const juce::AudioBuffer<SampleType>& buffer, int numChannels, int numSamples, juce::int64 hostPosition, float gain)
+{
+    if (lane == nullptr || numSamples <= 0)
+        return;
+
+    // A block this long would overwrite audio the receiver is still expected to read
+    if (static_cast<uint64_t>(numSamples) > SharedAggregateSegment::CAPACITY_FRAMES / 2)
+    {
+        oversizedBlocks.store(oversizedBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    const uint64_t position = alignedPosition(hostPosition);
+    uint64_t written = lane->writtenPosition.load(std::memory_order_relaxed);
+
+    if (!started)
+    {
+        lane->startPosition.store(position, std::memory_order_relaxed);
+        written = position;
+        started = true;
+    }
+    else if (position < written)
+    {
+        // Another lane's ahead of this cycle (hosts that don't process tracks in lockstep)
+        droppedBlocks.store(droppedBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Skipped host frames become silence, so the lane never holds stale audio
+    if (position > written)
+        clearFrames(written, position - written);
+
+    const int channels = juce::jmin(numChannels, laneChannels, buffer.getNumChannels());
+    const int firstRun = static_cast<int>(juce::jmin<uint64_t>(static_cast<uint64_t>(numSamples),
+                                                               SharedAggregateSegment::CAPACITY_FRAMES - (position & SharedAggregateSegment::CAPACITY_MASK)));
+
+    if (channels < laneChannels)
+        clearFrames(position, static_cast<uint64_t>(numSamples));
+
+    RingWriteKernels::interleaveSpan(segment->laneFrame(laneIndex, position), laneChannels, buffer.getArrayOfReadPointers(),
+                                     channels, 0, firstRun, static_cast<SampleType>(gain));
+    if (numSamples > firstRun)
+        RingWriteKernels::interleaveSpan(segment->laneFrame(laneIndex, position + static_cast<uint64_t>(firstRun)), laneChannels,
+                                         buffer.getArrayOfReadPointers(), channels, firstRun, numSamples - firstRun,
+                                         static_cast<SampleType>(gain));
+
+    const uint64_t now = SharedAggregateSegment::nowNs();
+    lane->writtenPosition.store(position + static_cast<uint64_t>(numSamples), std::memory_order_release);
+    lane->lastWriteNs.store(now, std::memory_order_release);
+    advanceComplete(now);
+}
+
+template void AggregateLane::write(const juce::AudioBuffer<float>&, int, int, juce::int64, float);
+template void AggregateLane::write(const juce::AudioBuffer<double>&, int, int, juce::int64, float);
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SharedAggregateSegment.h"
+
+//==============================================================================
+// This instance's lane in the shared aggregate segment (see SharedAggregateSegment.h).
+//
+// open() maps this user's segment, creating it if this is the first instance, claims a
+// free lane and joins the segment's sample rate. write() then copies every block into
+// the lane at its host sample position and advances the shared "complete up to" cursor.
+// The segment is never unlinked, because other instances and the receiver keep using
+// it; the last lane to close clears its sample rate instead.
+//==============================================================================
+class AggregateLane
+{
+public:
+    AggregateLane() = default;
+    ~AggregateLane();
+
+    // Call from prepareToPlay or the message thread, never while processBlock runs.
+    // periodFrames sets the receiver's wakeup period if this call creates the segment.
+    bool open(const juce::String& name, int numChannels, double sampleRate, int periodFrames);
+    void close();
+
+    bool isOpen() const        { return segment != nullptr; }
+    int getLaneIndex() const   { return laneIndex; }
+
+    // Audio thread: writes numSamples frames of the first numChannels channels, scaled by
+    // gain, at hostPosition. Never blocks, allocates or makes a system call, except a
+    // futex wake once per period while a receiver is waiting.
+    template <typename SampleType>
+    void write(const juce::AudioBuffer<SampleType>& buffer, int numChannels, int numSamples, juce::int64 hostPosition, float gain);
+
+    uint64_t getDroppedBlocks() const    { return droppedBlocks.load(std::memory_order_relaxed); }
+    uint64_t getOversizedBlocks() const  { return oversizedBlocks.load(std::memory_order_relaxed); }
+
+    // Channels beyond MAX_LANE_CHANNELS that open() had to leave out (0 if none)
+    int getTruncatedChannels() const     { return truncatedChannels.load(std::memory_order_relaxed); }
+
+private:
+    bool mapSegment();
+    bool claimLane();
+    bool joinFormat(double sampleRate, int periodFrames);
+    void leaveFormat();
+    uint64_t alignedPosition(juce::int64 hostPosition);
+    void clearFrames(uint64_t position, uint64_t numFrames);
+    void advanceComplete(uint64_t now);
+
+    static constexpr int ATTACH_TIMEOUT_MS = 200;   // For the creating instance to initialise it
+
+    // Shared cursors only ever grow, so a failed compare-and-swap means another lane
+    // moved them; give up after this many rather than spin on the audio thread
+    static constexpr int MAX_CAS_ATTEMPTS = 16;
+
+    int fd = -1;
+    SharedAggregateSegment* segment = nullptr;
+    SharedAggregateSegment::Lane* lane = nullptr;
+    int laneIndex = -1;
+    int laneChannels = 0;
+    bool joinedFormat = false;
+    bool started = false;           // Audio thread only
+
+    std::atomic<uint64_t> droppedBlocks { 0 };
+    std::atomic<uint64_t> oversizedBlocks { 0 };   // Longer than CAPACITY_FRAMES / 2, never written
+    std::atomic<int> truncatedChannels { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AggregateLane)
+};
@@ -0,0 +1,124 @@
+#include "RingWriteKernels.h"
+#include "TestSegment.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+//==============================================================================
+// Ring write benchmark: the plugin's publish path (ast_write_reserve, the interleave
+// kernel, ast_write_commit) into a transport ring of each channel count, for float32
+// and float64 rings fed from float host buffers. A reader on the same thread releases
+// every block outside the timed region, so the ring never fills.
+//
+// The cost per sample should stay flat as channels are added, i.e. the block cost
+// grows linearly with the channel count; layouts above
+// RingWriteKernels::WIDE_CHANNEL_THRESHOLD go through the tiled kernel.
+//
+// Usage: RingWriteBenchmark [blockFrames] [seconds of audio per case]
+//==============================================================================
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int channelCounts[] = { 2, 8, 12, 16, 32, 64 };
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Result
+    {
+        double nsPerBlock = 0.0;
+        double nsPerSample = 0.0;
+        bool failed = false;
+    };
+
+    Result runCase (int numChannels, uint32_t format, int blockFrames, double seconds)
+    {
+        Result result;
+
+        // Ring sized like the plugin's: a few blocks plus latency headroom
+        TestSegment segment(static_cast<uint64_t>(blockFrames) * 16 + 8192, static_cast<uint32_t>(numChannels), format);
+        ast_ring* writer = segment.attach();
+        if (writer == nullptr || !segment.configure(writer))
+        {
+            result.failed = true;
+            ast_detach(writer);
+            return result;
+        }
+
+        // Attached after the configure, so it starts with the ring's layout
+        ast_ring* reader = segment.attach();
+
+        std::vector<std::vector<float>> host(static_cast<size_t>(numChannels), std::vector<float>(static_cast<size_t>(blockFrames)));
+        std::vector<const float*> channels;
+        for (size_t channel = 0; channel < host.size(); ++channel)
+        {
+            for (int frame = 0; frame < blockFrames; ++frame)
+                host[channel][static_cast<size_t>(frame)] = static_cast<float>((frame * 31 + static_cast<int>(channel) * 7) % 1024) / 1024.0f;
+            channels.push_back(host[channel].data());
+        }
+
+        const auto numBlocks = std::max(1, static_cast<int>(seconds * sampleRate / blockFrames));
+        Clock::duration elapsed {};
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            const auto start = Clock::now();
+
+            ast_span span;
+            if (ast_write_reserve(writer, static_cast<uint32_t>(blockFrames), &span) != AST_OK)
+            {
+                result.failed = true;
+                break;
+            }
+
+            RingWriteKernels::interleaveIntoSpan(span, 0, channels.data(), numChannels, 0, 0.5f);
+            ast_write_commit(writer, &span, static_cast<uint64_t>(block), static_cast<double>(block));
+
+            elapsed += Clock::now() - start;
+
+            ast_span readSpan;
+            if (ast_read_acquire(reader, static_cast<uint32_t>(blockFrames), &readSpan) != AST_OK
+                || ast_read_release(reader, &readSpan) != AST_OK)
+            {
+                result.failed = true;
+                break;
+            }
+        }
+
+        const double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+        result.nsPerBlock = ns / numBlocks;
+        result.nsPerSample = result.nsPerBlock / (static_cast<double>(blockFrames) * numChannels);
+
+        ast_detach(reader);
+        ast_detach(writer);
+        return result;
+    }
+}
+
+int main (int argc, char** argv)
+{
+    const int blockFrames = std::max(16, std::min(4096, argc > 1 ? std::atoi(argv[1]) : 256));
+    const double seconds = std::max(0.1, std::min(600.0, argc > 2 ? std::atof(argv[2]) : 10.0));
+
+    std::printf("%d-frame blocks, %.1f s of audio per case\n", blockFrames, seconds);
+    std::printf("channels  ring     ns/block   ns/sample  block/deadline\n");
+
+    const double deadlineNs = blockFrames * 1.0e9 / sampleRate;
+    bool failed = false;
+
+    for (const int numChannels : channelCounts)
+    {
+        for (const uint32_t format : { static_cast<uint32_t>(AST_FORMAT_FLOAT32), static_cast<uint32_t>(AST_FORMAT_FLOAT64) })
+        {
+            const auto result = runCase(numChannels, format, blockFrames, seconds);
+            failed = failed || result.failed;
+
+            std::printf("%8d  %-7s %9.0f %11.3f %14.4f%s\n", numChannels, format == AST_FORMAT_FLOAT64 ? "float64" : "float32",
+                        result.nsPerBlock, result.nsPerSample, result.nsPerBlock / deadlineNs, result.failed ? "  (ring error)" : "");
+        }
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Set to 0 (e.g. -DAUDIOSENDER_ENABLE_INSTRUMENTATION=0) to compile the per-stage
+// processBlock timing out entirely; Scope then becomes an empty object, the histograms
+// aren't allocated and the metrics exporter leaves them out.
+#ifndef AUDIOSENDER_ENABLE_INSTRUMENTATION
+ #define AUDIOSENDER_ENABLE_INSTRUMENTATION 1
+#endif
+
+//==============================================================================
+// Per-stage processBlock timing and deadline tracking.
+//
+// The audio thread times each stage with the monotonic clock (a vDSO read, no
+// syscall), the same clock TransportDiagnostics records callback times with, and
+// once per callback adds the results to log2-spaced histograms of
+// relaxed atomics that readers can sample at any time without locks. A deadline
+// miss is a callback that took longer than numSamples / sampleRate, i.e. longer
+// than the audio it produced.
+//==============================================================================
+struct BlockInstrumentation
+{
+    enum Stage
+    {
+        GAIN = 0,
+        METERING,
+        NETWORK,        // Network FIFO push and the aggregation lane
+        METRICS,        // Shared parameters, offline waits, latency tracking, adaptive buffering
+        RING_WRITE,     // Interleave, headers, events and the writeIndex publish
+        SNAPSHOT,
+        RETURN_PATH,
+        NUM_STAGES
+    };
+
+    static constexpr const char* stageName (int stage)
+    {
+        constexpr const char* names[NUM_STAGES] = { "gain", "metering", "network", "metrics", "ring_write", "snapshot", "return_path" };
+        return names[stage];
+    }
+
+    // Bin b counts durations in [2^(b-1), 2^b) ns (bin 0 is exactly 0); the last bin
+    // catches everything from ~1 s up
+    static constexpr int TIME_BINS = 32;
+
+    // Callback duration as a share of its deadline, in 10% steps; the last bin is >= 100%
+    static constexpr int LOAD_BINS = 11;
+
+    static int timeBin (uint64_t nanoseconds)
+    {
+        int bin = 0;
+        while (nanoseconds != 0 && bin < TIME_BINS - 1)
+        {
+            nanoseconds >>= 1;
+            ++bin;
+        }
+        return bin;
+    }
+
+    // Upper edge of a time bin in nanoseconds
+    static constexpr uint64_t timeBinUpperNs (int bin) { return bin == 0 ? 0 : (uint64_t { 1 } << bin); }
+
+    static uint64_t nowNs()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Same clock in milliseconds, for TransportDiagnostics
+    static double nowMs() { return static_cast<double>(nowNs()) * 1.0e-6; }
+
+   #if AUDIOSENDER_ENABLE_INSTRUMENTATION
+    std::atomic<uint64_t> stageHistogram[NUM_STAGES][TIME_BINS] {};
+    std::atomic<uint64_t> stageTotalNs[NUM_STAGES] {};
+    std::atomic<uint64_t> callbackHistogram[TIME_BINS] {};
+    std::atomic<uint64_t> intervalHistogram[TIME_BINS] {};
+    std::atomic<uint64_t> loadHistogram[LOAD_BINS] {};
+    std::atomic<uint64_t> callbacks { 0 };
+    std::atomic<uint64_t> deadlineMisses { 0 };
+
+    uint64_t lastCallbackStartNs = 0;   // Audio thread only
+
+    static void increment (std::atomic<uint64_t>& counter, uint64_t amount = 1)
+    {
+        // Single writer, so no read-modify-write instruction is needed
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    //==============================================================================
+    // Lives for one processBlock call, from the callback's start time. lap(stage)
+    // charges the time since the previous lap (or the start) to that stage; everything
+    // is recorded when the scope ends, whichever way the callback returns, up to the
+    // end time given to finish() (or the clock then, if it wasn't called).
+    class Scope
+    {
+    public:
+        Scope (BlockInstrumentation& owner, uint64_t callbackStartNs, int numSamples, double sampleRate)
+            : instrumentation(owner),
+              startNs(callbackStartNs),
+              lastLapNs(startNs),
+              deadlineNs(sampleRate > 0.0 ? static_cast<uint64_t>(numSamples * 1.0e9 / sampleRate) : 0)
+        {
+        }
+
+        ~Scope()
+        {
+            const uint64_t endNs = finishNs != 0 ? finishNs : nowNs();
+            const uint64_t durationNs = endNs - startNs;
+
+            for (int stage = 0; stage < NUM_STAGES; ++stage)
+            {
+                if (!stageHit[stage])
+                    continue;
+
+                increment(instrumentation.stageHistogram[stage][timeBin(stageNs[stage])]);
+                increment(instrumentation.stageTotalNs[stage], stageNs[stage]);
+            }
+
+            increment(instrumentation.callbackHistogram[timeBin(durationNs)]);
+
+            if (instrumentation.lastCallbackStartNs != 0)
+                increment(instrumentation.intervalHistogram[timeBin(startNs - instrumentation.lastCallbackStartNs)]);
+            instrumentation.lastCallbackStartNs = startNs;
+
+            if (deadlineNs > 0)
+            {
+                const uint64_t loadBin = durationNs * 10 / deadlineNs;
+                increment(instrumentation.loadHistogram[loadBin < static_cast<uint64_t>(LOAD_BINS - 1) ? loadBin : static_cast<uint64_t>(LOAD_BINS - 1)]);
+
+                if (durationNs > deadlineNs)
+                    increment(instrumentation.deadlineMisses);
+            }
+
+            increment(instrumentation.callbacks);
+        }
+
+        void lap (Stage stage)
+        {
+            const uint64_t now = nowNs();
+            stageNs[stage] += now - lastLapNs;
+            stageHit[stage] = true;
+            lastLapNs = now;
+        }
+
+        void finish (uint64_t callbackEndNs) { finishNs = callbackEndNs; }
+
+    private:
+        BlockInstrumentation& instrumentation;
+        const uint64_t startNs;
+        uint64_t lastLapNs;
+        const uint64_t deadlineNs;
+        uint64_t finishNs = 0;
+        uint64_t stageNs[NUM_STAGES] {};
+        bool stageHit[NUM_STAGES] {};
+    };
+   #else
+    class Scope
+    {
+    public:
+        Scope (BlockInstrumentation&, uint64_t, int, double) {}
+        void lap (Stage) {}
+        void finish (uint64_t) {}
+    };
+   #endif
+};
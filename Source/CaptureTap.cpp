@@ -0,0 +1,383 @@
+#include "CaptureTap.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace
+{
+    // Allocates the file's blocks up to newSize, not just its length: writing through a
+    // mapping of a sparse file raises SIGBUS in the host once the disk is full, whereas
+    // this fails up front with ENOSPC.
+    bool reserveFileSpace(int fd, size_t newSize)
+    {
+       #if defined (__APPLE__)
+        struct stat info;
+        if (fstat(fd, &info) == -1)
+            return false;
+
+        if (static_cast<size_t>(info.st_size) < newSize)
+        {
+            fstore_t store { F_ALLOCATEALL, F_PEOFPOSMODE, 0, static_cast<off_t>(newSize - static_cast<size_t>(info.st_size)), 0 };
+            if (fcntl(fd, F_PREALLOCATE, &store) == -1)
+                return false;
+        }
+
+        return ftruncate(fd, static_cast<off_t>(newSize)) == 0;
+       #else
+        const int result = posix_fallocate(fd, 0, static_cast<off_t>(newSize));
+        errno = result;
+        return result == 0;
+       #endif
+    }
+}
+
+//==============================================================================
+// A WAVE_FORMAT_EXTENSIBLE float (32 or 64-bit) file written through a growing shared
+// mapping, so appending is a memcpy and the kernel does the write-back.
+class CaptureTap::CaptureFile
+{
+public:
+    ~CaptureFile() { close(); }
+
+    bool open(const juce::File& path, int channels, int sampleBytes, double rate)
+    {
+        fd = ::open(path.getFullPathName().toRawUTF8(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+        if (fd == -1)
+            return false;
+
+        numChannels = channels;
+        bytesPerSample = sampleBytes;
+        sampleRate = rate;
+        dataBytes = 0;
+        return grow(GROW_BYTES);
+    }
+
+    // False if the file couldn't grow (e.g. the disk is full); the block isn't written
+    bool append(const void* interleaved, int numFrames)
+    {
+        const size_t bytes = static_cast<size_t>(numFrames) * static_cast<size_t>(numChannels) * static_cast<size_t>(bytesPerSample);
+
+        if (HEADER_BYTES + dataBytes + bytes > mappedBytes
+            && !grow(juce::jmax(mappedBytes + GROW_BYTES, HEADER_BYTES + dataBytes + bytes)))
+            return false;
+
+        std::memcpy(mapped + HEADER_BYTES + dataBytes, interleaved, bytes);
+        dataBytes += bytes;
+        return true;
+    }
+
+    void close()
+    {
+        if (mapped != nullptr)
+        {
+            writeHeader();
+            munmap(mapped, mappedBytes);
+            mapped = nullptr;
+        }
+
+        if (fd != -1)
+        {
+            // Drop the preallocated tail
+            ftruncate(fd, static_cast<off_t>(HEADER_BYTES + dataBytes));
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    juce::int64 getTotalBytes() const { return static_cast<juce::int64>(HEADER_BYTES + dataBytes); }
+    uint64_t getNumFrames() const     { return dataBytes / (static_cast<size_t>(numChannels) * static_cast<size_t>(bytesPerSample)); }
+    int getNumChannels() const        { return numChannels; }
+    int getBytesPerSample() const     { return bytesPerSample; }
+    double getSampleRate() const      { return sampleRate; }
+
+private:
+    static constexpr size_t HEADER_BYTES = 68;
+    static constexpr size_t GROW_BYTES = 16 * 1024 * 1024;
+
+    bool grow(size_t newSize)
+    {
+        if (mapped != nullptr)
+            munmap(mapped, mappedBytes);
+        mapped = nullptr;
+        mappedBytes = 0;
+
+        if (!reserveFileSpace(fd, newSize))
+            return false;
+
+        void* memory = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (memory == MAP_FAILED)
+            return false;
+
+        mapped = static_cast<uint8_t*>(memory);
+        mappedBytes = newSize;
+        return true;
+    }
+
+    void writeHeader()
+    {
+        auto put16 = [this] (size_t offset, uint16_t v) { v = juce::ByteOrder::swapIfBigEndian(v); std::memcpy(mapped + offset, &v, 2); };
+        auto put32 = [this] (size_t offset, uint32_t v) { v = juce::ByteOrder::swapIfBigEndian(v); std::memcpy(mapped + offset, &v, 4); };
+        auto tag   = [this] (size_t offset, const char* t) { std::memcpy(mapped + offset, t, 4); };
+
+        static const uint8_t ieeeFloatGuid[16] = { 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+                                                   0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71 };
+
+        const uint32_t bitsPerSample = static_cast<uint32_t>(bytesPerSample) * 8;
+        const uint32_t blockAlign = static_cast<uint32_t>(numChannels * bytesPerSample);
+
+        tag(0, "RIFF");   put32(4, static_cast<uint32_t>(HEADER_BYTES - 8 + dataBytes));
+        tag(8, "WAVE");
+        tag(12, "fmt ");  put32(16, 40);
+        put16(20, 0xfffe);                                   // WAVE_FORMAT_EXTENSIBLE
+        put16(22, static_cast<uint16_t>(numChannels));
+        put32(24, static_cast<uint32_t>(sampleRate));
+        put32(28, static_cast<uint32_t>(sampleRate) * blockAlign);
+        put16(32, static_cast<uint16_t>(blockAlign));
+        put16(34, static_cast<uint16_t>(bitsPerSample));
+        put16(36, 22);                                       // Extension size
+        put16(38, static_cast<uint16_t>(bitsPerSample));     // Valid bits
+        put32(40, 0);                                        // Channel mask: unassigned
+        std::memcpy(mapped + 44, ieeeFloatGuid, sizeof(ieeeFloatGuid));
+        tag(60, "data");  put32(64, static_cast<uint32_t>(dataBytes));
+    }
+
+    int fd = -1;
+    uint8_t* mapped = nullptr;
+    size_t mappedBytes = 0;
+    size_t dataBytes = 0;
+    int numChannels = 0;
+    int bytesPerSample = sizeof(float);
+    double sampleRate = 0.0;
+};
+
+//==============================================================================
+CaptureTap::CaptureTap()
+    : juce::Thread("AudioSender capture tap")
+{
+}
+
+CaptureTap::~CaptureTap()
+{
+    stop();
+}
+
+bool CaptureTap::start(SharedAudioData* data, const SharedSegmentExtension* extension, const Settings& newSettings)
+{
+    stop();
+
+    if (data == nullptr || extension == nullptr || extension->ringCapacityFrames.load() == 0
+        || !newSettings.directory.createDirectory())
+        return false;
+
+    sharedData = data;
+    ringCapacity = extension->ringCapacityFrames.load(std::memory_order_acquire);
+    ringStride = static_cast<int>(extension->ringStride.load(std::memory_order_acquire));
+    ringHeaders = reinterpret_cast<const SharedBlockHeader*>(reinterpret_cast<const char*>(data)
+                                                             + extension->ringHeadersOffset.load());
+    ringData = reinterpret_cast<const char*>(data) + extension->ringDataOffset.load();
+    bytesPerSample = extension->sampleFormat.load(std::memory_order_acquire) == SharedSegmentExtension::SAMPLE_FORMAT_FLOAT64
+                         ? static_cast<int>(sizeof(double)) : static_cast<int>(sizeof(float));
+    settings = newSettings;
+
+    // The ring holds the target latency plus two blocks and two reblock periods (see
+    // computeRingLayout), so a margin of one of each still leaves the tap room to read
+    safetyFrames = juce::jmax(ringCapacity / 4, settings.writeAheadFrames);
+    if (safetyFrames >= ringCapacity)
+    {
+        juce::Logger::writeToLog("Capture tap: the ring is too small for blocks of " + juce::String(static_cast<juce::int64>(settings.writeAheadFrames)) + " frames");
+        return false;
+    }
+
+    // A single WAV data chunk is limited to 4 GB. Files rotate before a block would take
+    // them past maxFileBytes, and a block is far smaller than the headroom left here.
+    settings.maxFileBytes = juce::jlimit<juce::int64>(1024 * 1024, 0xffff0000LL, settings.maxFileBytes);
+
+    framesCaptured.store(0);
+    gapFrames.store(0);
+    fileNumber = 0;
+
+    // Low priority: the tap must never compete with the audio thread
+    return startThread(juce::Thread::Priority::low);
+}
+
+void CaptureTap::stop()
+{
+    stopThread(2000);
+    closeFile();
+    sharedData = nullptr;
+}
+
+void CaptureTap::run()
+{
+    // writeIndex always sits on a block boundary, so following the block headers
+    // from here walks the stream block by block.
+    uint64_t cursor = sharedData->writeIndex.load(std::memory_order_acquire);
+
+    while (!threadShouldExit())
+    {
+        const uint64_t writeIndex = sharedData->writeIndex.load(std::memory_order_acquire);
+
+        if (writeIndex == cursor)
+        {
+            wait(POLL_MS);
+            continue;
+        }
+
+        if (writeIndex - cursor + safetyFrames > ringCapacity)
+        {
+            // Fell behind further than the ring can hold
+            recordGap(cursor, writeIndex - cursor);
+            cursor = writeIndex;
+            continue;
+        }
+
+        // Positions may wrap past 2^64, so compare distances rather than positions
+        while (cursor != writeIndex && !threadShouldExit())
+        {
+            const auto header = ringHeaders[cursor & (ringCapacity - 1)];
+            const int blockSize = static_cast<int>(header.blockSize);
+            const int numChannels = ringStride;
+
+            if (blockSize <= 0 || static_cast<uint64_t>(blockSize) > writeIndex - cursor
+                || static_cast<int>(header.numChannels) != ringStride)
+            {
+                // Lost block alignment; resync at the newest boundary
+                recordGap(cursor, writeIndex - cursor);
+                cursor = writeIndex;
+                break;
+            }
+
+            if (!copyBlock(cursor, blockSize, numChannels))
+            {
+                const uint64_t newest = sharedData->writeIndex.load(std::memory_order_acquire);
+                recordGap(cursor, newest - cursor);
+                cursor = newest;
+                break;
+            }
+
+            if (!ensureFile(numChannels, sharedData->sampleRate.load(), blockSize))
+            {
+                recordGap(cursor, static_cast<uint64_t>(blockSize));
+            }
+            else if (!file->append(scratch.get(), blockSize))
+            {
+                // Out of disk space: finish this file with what it has; the next block
+                // tries a new one
+                juce::Logger::writeToLog("Capture tap: couldn't extend the capture file: " + juce::String(strerror(errno)));
+                recordGap(cursor, static_cast<uint64_t>(blockSize));
+                closeFile();
+            }
+            else
+            {
+                const uint64_t frameInFile = file->getNumFrames() - static_cast<uint64_t>(blockSize);
+
+                index->writeText(juce::String("block,") + juce::String(cursor) + "," + juce::String(frameInFile) + ","
+                                 + juce::String(header.sequenceNumber) + "," + juce::String(header.timestamp, 6) + ","
+                                 + juce::String(blockSize) + "," + juce::String(numChannels) + "\n", false, false, nullptr);
+
+                framesCaptured.fetch_add(static_cast<uint64_t>(blockSize), std::memory_order_relaxed);
+            }
+
+            cursor += static_cast<uint64_t>(blockSize);
+        }
+    }
+
+    closeFile();
+}
+
+bool CaptureTap::copyBlock(uint64_t position, int numFrames, int numChannels)
+{
+    const size_t frameBytes = static_cast<size_t>(numChannels) * static_cast<size_t>(bytesPerSample);
+    const size_t needed = static_cast<size_t>(numFrames) * frameBytes;
+    if (needed > scratchSize)
+    {
+        scratch.malloc(needed);
+        scratchSize = needed;
+    }
+
+    // Copy the (at most two) contiguous spans either side of the wrap
+    const char* ring = ringData;
+    const uint64_t start = position & (ringCapacity - 1);
+    const size_t firstFrames = static_cast<size_t>(juce::jmin<uint64_t>(ringCapacity - start, static_cast<uint64_t>(numFrames)));
+
+    std::memcpy(scratch.get(), ring + start * frameBytes, firstFrames * frameBytes);
+    if (firstFrames < static_cast<size_t>(numFrames))
+        std::memcpy(scratch.get() + firstFrames * frameBytes, ring, (static_cast<size_t>(numFrames) - firstFrames) * frameBytes);
+
+    // The copy is only valid if the producer couldn't have wrapped around onto it meanwhile
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t writeIndex = sharedData->writeIndex.load(std::memory_order_acquire);
+    return writeIndex - position + safetyFrames <= ringCapacity;
+}
+
+void CaptureTap::recordGap(uint64_t position, uint64_t numFrames)
+{
+    if (numFrames == 0)
+        return;
+
+    gapFrames.fetch_add(numFrames, std::memory_order_relaxed);
+
+    if (index != nullptr)
+        index->writeText(juce::String("gap,") + juce::String(position) + "," + juce::String(file->getNumFrames()) + ","
+                         + juce::String(numFrames) + "\n", false, false, nullptr);
+}
+
+bool CaptureTap::ensureFile(int numChannels, double sampleRate, int numFrames)
+{
+    if (file != nullptr)
+    {
+        // Rotate if the block about to be appended wouldn't fit, rather than once a file is
+        // already over. A new file always takes its first block.
+        const auto blockBytes = static_cast<juce::int64>(numFrames) * numChannels * bytesPerSample;
+        const bool formatChanged = file->getNumChannels() != numChannels || file->getSampleRate() != sampleRate
+                                   || file->getBytesPerSample() != bytesPerSample;
+        const bool sizeReached = file->getNumFrames() > 0 && file->getTotalBytes() + blockBytes > settings.maxFileBytes;
+        const bool timeReached = settings.maxFileSeconds > 0.0 && file->getNumFrames() > 0
+                                 && static_cast<double>(file->getNumFrames() + static_cast<uint64_t>(numFrames)) > settings.maxFileSeconds * sampleRate;
+
+        if (!formatChanged && !sizeReached && !timeReached)
+            return true;
+
+        closeFile();
+    }
+
+    if (sampleRate <= 0.0)
+        return false;
+
+    const auto baseName = "AudioSender_capture_" + juce::Time::getCurrentTime().formatted("%Y%m%d_%H%M%S")
+                          + "_" + juce::String(++fileNumber);
+    const auto audioFile = settings.directory.getChildFile(baseName + ".wav");
+
+    auto newFile = std::make_unique<CaptureFile>();
+    if (!newFile->open(audioFile, numChannels, bytesPerSample, sampleRate))
+    {
+        const int error = errno;
+        newFile.reset();
+        audioFile.deleteFile();   // Don't leave an empty file behind for every retry
+
+        // Once per failure streak: on a full disk this repeats for every block
+        if (!openFailureLogged)
+            juce::Logger::writeToLog("Capture tap: failed to open " + audioFile.getFullPathName() + ": " + juce::String(strerror(error)));
+        openFailureLogged = true;
+        return false;
+    }
+
+    openFailureLogged = false;
+    file = std::move(newFile);
+    index = std::make_unique<juce::FileOutputStream>(settings.directory.getChildFile(baseName + ".wav.idx.csv"));
+    index->writeText("type,ringPosition,frameInFile,sequenceOrFrames,timestamp,blockSize,numChannels\n", false, false, nullptr);
+    return true;
+}
+
+void CaptureTap::closeFile()
+{
+    if (index != nullptr)
+        index->flush();
+
+    index.reset();
+    file.reset();
+}
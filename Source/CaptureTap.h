@@ -0,0 +1,82 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SharedMemoryManager.h"
+#include "Transport/SharedSegmentExtension.h"
+
+//==============================================================================
+// Background capture of exactly what processBlock published into the ring.
+//
+// The tap is a passive reader: it follows writeIndex from its own cursor and never
+// touches readIndex, so the producer doesn't know it exists and processBlock does no
+// extra work. Audio goes to mmap-backed float WAV files (32 or 64-bit, matching the
+// ring's sample format), with a CSV sidecar (<file>.idx.csv) that lists every block
+// header and every gap. If the tap falls so
+// far behind that the producer may have overwritten frames it hasn't copied yet, it
+// skips ahead to the newest block and records the skipped range as a gap.
+//==============================================================================
+class CaptureTap : private juce::Thread
+{
+public:
+    struct Settings
+    {
+        juce::File directory;
+        juce::int64 maxFileBytes = 1024LL * 1024 * 1024;   // Rotate after this many bytes...
+        double maxFileSeconds = 0.0;                        // ...or this much audio (0 = no limit)
+
+        // How far the producer may write past writeIndex before committing: its largest
+        // host block plus the reblock period
+        uint64_t writeAheadFrames = 0;
+    };
+
+    CaptureTap();
+    ~CaptureTap() override;
+
+    // Must be stopped before the segment is unmapped or the ring resized.
+    bool start(SharedAudioData* data, const SharedSegmentExtension* extension, const Settings& settings);
+    void stop();
+
+    bool isRunning() const { return isThreadRunning(); }
+
+    uint64_t getFramesCaptured() const { return framesCaptured.load(std::memory_order_relaxed); }
+    uint64_t getGapFrames() const      { return gapFrames.load(std::memory_order_relaxed); }
+
+private:
+    class CaptureFile;
+
+    void run() override;
+    bool copyBlock(uint64_t position, int numFrames, int numChannels);
+    void recordGap(uint64_t position, uint64_t numFrames);
+    bool ensureFile(int numChannels, double sampleRate, int numFrames);
+    void closeFile();
+
+    static constexpr int POLL_MS = 10;
+
+    SharedAudioData* sharedData = nullptr;
+    Settings settings;
+
+    // Ring geometry; the tap is restarted whenever the ring is resized
+    uint64_t ringCapacity = 0;
+    int ringStride = 0;
+
+    // Frames the producer may be writing beyond the published writeIndex: a quarter of
+    // the ring, or Settings::writeAheadFrames if that is more. Copied frames closer than
+    // this to being overwritten are treated as lost.
+    uint64_t safetyFrames = 0;
+    int bytesPerSample = sizeof(float);
+    const SharedBlockHeader* ringHeaders = nullptr;
+    const char* ringData = nullptr;
+
+    std::unique_ptr<CaptureFile> file;
+    std::unique_ptr<juce::FileOutputStream> index;
+    int fileNumber = 0;
+    bool openFailureLogged = false;
+
+    juce::HeapBlock<char> scratch;
+    size_t scratchSize = 0;
+
+    std::atomic<uint64_t> framesCaptured { 0 };
+    std::atomic<uint64_t> gapFrames { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CaptureTap)
+};
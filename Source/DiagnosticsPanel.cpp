@@ -0,0 +1,164 @@
+#include "DiagnosticsPanel.h"
+
+DiagnosticsPanel::DiagnosticsPanel()
+{
+    setOpaque(true);
+}
+
+void DiagnosticsPanel::update(const TransportDiagnosticsSnapshot& newSnapshot, double nowMs)
+{
+    // Counter deltas over the time since the previous snapshot
+    const double elapsedSeconds = (nowMs - previousUpdateMs) * 0.001;
+    if (previousUpdateMs > 0.0 && elapsedSeconds > 0.0)
+    {
+        auto rate = [elapsedSeconds] (uint64_t now, uint64_t before)
+        {
+            return now >= before ? static_cast<double>(now - before) / elapsedSeconds : 0.0;
+        };
+
+        overrunsPerSecond        = rate(newSnapshot.overruns, previousOverruns);
+        underrunsPerSecond       = rate(newSnapshot.underruns, previousUnderruns);
+        returnUnderrunsPerSecond = rate(newSnapshot.returnUnderruns, previousReturnUnderruns);
+    }
+
+    previousOverruns = newSnapshot.overruns;
+    previousUnderruns = newSnapshot.underruns;
+    previousReturnUnderruns = newSnapshot.returnUnderruns;
+    previousUpdateMs = nowMs;
+
+    snapshot = newSnapshot;
+    repaint();
+}
+
+void DiagnosticsPanel::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colour::fromRGB(18, 18, 18));
+
+    g.setColour(juce::Colours::goldenrod.withAlpha(0.4f));
+    g.drawHorizontalLine(0, 0.0f, static_cast<float>(getWidth()));
+
+    auto area = getLocalBounds().reduced(10);
+    drawStats(g, area.removeFromTop(80));
+    area.removeFromTop(6);
+
+    auto fillArea = area.removeFromLeft(area.getWidth() / 2);
+    area.removeFromLeft(8);
+
+    drawFillGraph(g, fillArea);
+    drawLatencyHistogram(g, area);
+}
+
+void DiagnosticsPanel::drawStats(juce::Graphics& g, juce::Rectangle<int> area) const
+{
+    auto heartbeat = [this]
+    {
+        if (snapshot.readerHeartbeatAgeMs < 0.0)
+            return juce::String("never");
+        if (snapshot.readerHeartbeatAgeMs < 1000.0)
+            return juce::String(juce::roundToInt(snapshot.readerHeartbeatAgeMs)) + " ms ago";
+        return juce::String(snapshot.readerHeartbeatAgeMs * 0.001, 1) + " s ago";
+    };
+
+    // Main bus loudness; the exporter has every bus
+    auto loudness = [this]
+    {
+        if (snapshot.loudnessBuses == 0)
+            return juce::String("Loudness: not measured");
+
+        auto value = [] (float decibels)
+        {
+            return decibels <= SharedSegmentExtension::LOUDNESS_FLOOR_DB ? juce::String("-inf") : juce::String(decibels, 1);
+        };
+
+        const auto& main = snapshot.loudness[0];
+        return "Loudness M " + value(main.momentaryLufs) + "  S " + value(main.shortTermLufs) + "  I " + value(main.integratedLufs)
+               + " LUFS   True peak " + value(main.truePeakDbtp) + " dBTP";
+    };
+
+    const juce::StringArray lines {
+        "Target latency " + juce::String(snapshot.targetLatencyMs) + " ms   Ring " + juce::String(static_cast<juce::int64>(snapshot.ringCapacity))
+            + " frames   Config #" + juce::String(static_cast<juce::int64>(snapshot.configurationCounter))
+            + " (gen " + juce::String(static_cast<juce::int64>(snapshot.ringGeneration)) + ")",
+        "Overruns " + juce::String(static_cast<juce::int64>(snapshot.overruns)) + " (" + juce::String(overrunsPerSecond, 1) + "/s)   "
+            + "Underruns " + juce::String(static_cast<juce::int64>(snapshot.underruns)) + " (" + juce::String(underrunsPerSecond, 1) + "/s)   "
+            + "Return " + juce::String(returnUnderrunsPerSecond, 1) + "/s",
+        "Callback " + juce::String(snapshot.callbackMs, 2) + " ms (peak " + juce::String(snapshot.callbackPeakMs, 2) + ")   "
+            + "Interval " + juce::String(snapshot.callbackIntervalMs, 2) + " ms   "
+            + "Deadline misses " + (snapshot.instrumented ? juce::String(static_cast<juce::int64>(snapshot.deadlineMisses)) : juce::String("n/a")),
+        "Receiver last read " + heartbeat() + (snapshot.connected ? juce::String() : juce::String("   (not connected)"))
+            + (snapshot.receiverPresent ? juce::String() : juce::String("   (idle: no receiver)"))
+            + "   Resyncs " + juce::String(static_cast<juce::int64>(snapshot.resyncs)),
+        loudness()
+    };
+
+    g.setFont(juce::Font(11.0f));
+    g.setColour(juce::Colours::lightgrey);
+
+    const int lineHeight = area.getHeight() / lines.size();
+    for (const auto& line : lines)
+        g.drawFittedText(line, area.removeFromTop(lineHeight), juce::Justification::centredLeft, 1);
+}
+
+void DiagnosticsPanel::drawFillGraph(juce::Graphics& g, juce::Rectangle<int> area) const
+{
+    g.setColour(juce::Colours::white.withAlpha(0.08f));
+    g.fillRect(area);
+
+    g.setFont(juce::Font(10.0f));
+    g.setColour(juce::Colours::grey);
+    g.drawText("Ring fill", area.reduced(4, 2), juce::Justification::topLeft, false);
+
+    // Target latency as a fraction of the ring
+    if (snapshot.ringCapacity > 0 && snapshot.sampleRate > 0.0)
+    {
+        const double targetFill = snapshot.targetLatencyMs * 0.001 * snapshot.sampleRate / static_cast<double>(snapshot.ringCapacity);
+        const float y = static_cast<float>(area.getBottom()) - static_cast<float>(juce::jlimit(0.0, 1.0, targetFill)) * static_cast<float>(area.getHeight());
+        g.setColour(juce::Colours::goldenrod.withAlpha(0.5f));
+        g.drawHorizontalLine(juce::roundToInt(y), static_cast<float>(area.getX()), static_cast<float>(area.getRight()));
+    }
+
+    juce::Path path;
+    const auto bounds = area.toFloat();
+    const float step = bounds.getWidth() / static_cast<float>(TransportDiagnostics::FILL_HISTORY_SIZE - 1);
+
+    for (uint32_t i = 0; i < TransportDiagnostics::FILL_HISTORY_SIZE; ++i)
+    {
+        const float x = bounds.getX() + step * static_cast<float>(i);
+        const float y = bounds.getBottom() - juce::jlimit(0.0f, 1.0f, snapshot.fillHistory[i]) * bounds.getHeight();
+
+        if (i == 0)
+            path.startNewSubPath(x, y);
+        else
+            path.lineTo(x, y);
+    }
+
+    g.setColour(juce::Colours::lime);
+    g.strokePath(path, juce::PathStrokeType(1.2f));
+}
+
+void DiagnosticsPanel::drawLatencyHistogram(juce::Graphics& g, juce::Rectangle<int> area) const
+{
+    g.setColour(juce::Colours::white.withAlpha(0.08f));
+    g.fillRect(area);
+
+    g.setFont(juce::Font(10.0f));
+    g.setColour(juce::Colours::grey);
+    g.drawText("Queued latency (0-" + juce::String(juce::roundToInt(TransportDiagnostics::LATENCY_BINS * TransportDiagnostics::LATENCY_BIN_MS)) + " ms)",
+               area.reduced(4, 2), juce::Justification::topLeft, false);
+
+    uint64_t peak = 1;
+    for (const auto count : snapshot.latencyHistogram)
+        peak = juce::jmax(peak, count);
+
+    const auto bounds = area.toFloat();
+    const float binWidth = bounds.getWidth() / static_cast<float>(TransportDiagnostics::LATENCY_BINS);
+
+    g.setColour(juce::Colours::goldenrod);
+    for (int bin = 0; bin < TransportDiagnostics::LATENCY_BINS; ++bin)
+    {
+        // Square-root scale so rare bins stay visible next to the common ones
+        const float height = std::sqrt(static_cast<float>(snapshot.latencyHistogram[bin]) / static_cast<float>(peak)) * bounds.getHeight();
+        g.fillRect(bounds.getX() + binWidth * static_cast<float>(bin) + 0.5f, bounds.getBottom() - height,
+                   juce::jmax(1.0f, binWidth - 1.0f), height);
+    }
+}
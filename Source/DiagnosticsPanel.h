@@ -0,0 +1,39 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "TransportDiagnostics.h"
+
+//==============================================================================
+// Collapsible diagnostics view shown under the main editor controls.
+//
+// Shows the ring fill history as a graph, the queued latency histogram, overrun and
+// underrun rates, the configuration generation, callback timing and how long ago the
+// receiver last consumed anything. The editor hands it a fresh snapshot a few times a
+// second; the panel keeps the previous one to turn counters into rates.
+//==============================================================================
+class DiagnosticsPanel : public juce::Component
+{
+public:
+    DiagnosticsPanel();
+
+    void update(const TransportDiagnosticsSnapshot& newSnapshot, double nowMs);
+
+    void paint(juce::Graphics&) override;
+
+private:
+    void drawStats(juce::Graphics&, juce::Rectangle<int> area) const;
+    void drawFillGraph(juce::Graphics&, juce::Rectangle<int> area) const;
+    void drawLatencyHistogram(juce::Graphics&, juce::Rectangle<int> area) const;
+
+    TransportDiagnosticsSnapshot snapshot;
+    uint64_t previousOverruns = 0;
+    uint64_t previousUnderruns = 0;
+    uint64_t previousReturnUnderruns = 0;
+    double previousUpdateMs = 0.0;
+
+    double overrunsPerSecond = 0.0;
+    double underrunsPerSecond = 0.0;
+    double returnUnderrunsPerSecond = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DiagnosticsPanel)
+};
@@ -0,0 +1,358 @@
+#include "LoudnessAnalyzer.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    double toLufs(double power)
+    {
+        return power > 0.0 ? -0.691 + 10.0 * std::log10(power) : -std::numeric_limits<double>::infinity();
+    }
+
+    float floored(double decibels)
+    {
+        return decibels > LoudnessAnalyzer::FLOOR_DB ? static_cast<float>(decibels) : LoudnessAnalyzer::FLOOR_DB;
+    }
+}
+
+LoudnessAnalyzer::LoudnessAnalyzer()
+    : juce::Thread("AudioSender loudness")
+{
+    for (int bus = 0; bus < MAX_BUSES; ++bus)
+        publish(bus, {});
+}
+
+LoudnessAnalyzer::~LoudnessAnalyzer()
+{
+    stop();
+}
+
+bool LoudnessAnalyzer::start(double sampleRate, const Layout& newLayout)
+{
+    stop();
+
+    if (sampleRate <= 0.0 || newLayout.numChannels <= 0 || newLayout.numChannels > MAX_CHANNELS
+        || newLayout.numBuses <= 0 || newLayout.numBuses > MAX_BUSES)
+        return false;
+
+    layout = newLayout;
+
+    // K-weighting filters for this sample rate (BS.1770 stage 1 shelf and stage 2 high
+    // pass, from their analogue prototypes via the bilinear transform)
+    {
+        const double k = std::tan(juce::MathConstants<double>::pi * 1681.974450955533 / sampleRate);
+        const double q = 0.7071752369554196;
+        const double vh = std::pow(10.0, 3.999843853973347 / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+
+        shelfB[0] = (vh + vb * k / q + k * k) / a0;
+        shelfB[1] = 2.0 * (k * k - vh) / a0;
+        shelfB[2] = (vh - vb * k / q + k * k) / a0;
+        shelfA[1] = 2.0 * (k * k - 1.0) / a0;
+        shelfA[2] = (1.0 - k / q + k * k) / a0;
+    }
+    {
+        const double k = std::tan(juce::MathConstants<double>::pi * 38.13547087602444 / sampleRate);
+        const double q = 0.5003270373238773;
+        const double a0 = 1.0 + k / q + k * k;
+
+        highPassB[0] = 1.0;
+        highPassB[1] = -2.0;
+        highPassB[2] = 1.0;
+        highPassA[1] = 2.0 * (k * k - 1.0) / a0;
+        highPassA[2] = (1.0 - k / q + k * k) / a0;
+    }
+
+    // True-peak interpolator: Blackman-windowed sinc at a quarter of the oversampled
+    // rate, normalised so every phase has unity gain at DC
+    constexpr int taps = OVERSAMPLING * TAPS_PER_PHASE;
+    for (int n = 0; n < taps; ++n)
+    {
+        const double t = (n - (taps - 1) * 0.5) / OVERSAMPLING;
+        const double sinc = t == 0.0 ? 1.0 : std::sin(juce::MathConstants<double>::pi * t) / (juce::MathConstants<double>::pi * t);
+        const double phase = 2.0 * juce::MathConstants<double>::pi * n / (taps - 1);
+        interpolator[n] = static_cast<float>(sinc * (0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase)));
+    }
+    for (int phase = 0; phase < OVERSAMPLING; ++phase)
+    {
+        double sum = 0.0;
+        for (int tap = 0; tap < TAPS_PER_PHASE; ++tap)
+            sum += interpolator[tap * OVERSAMPLING + phase];
+        for (int tap = 0; tap < TAPS_PER_PHASE; ++tap)
+            interpolator[tap * OVERSAMPLING + phase] = static_cast<float>(interpolator[tap * OVERSAMPLING + phase] / sum);
+    }
+
+    // Filter and interpolator state start from silence
+    std::fill(std::begin(shelfZ1), std::end(shelfZ1), 0.0);
+    std::fill(std::begin(shelfZ2), std::end(shelfZ2), 0.0);
+    std::fill(std::begin(highPassZ1), std::end(highPassZ1), 0.0);
+    std::fill(std::begin(highPassZ2), std::end(highPassZ2), 0.0);
+    std::memset(history, 0, sizeof(history));
+    historyPosition = 0;
+
+    subBlockFrames = juce::jmax(1, juce::roundToInt(sampleRate * 0.1));
+    clearMeasurement();
+
+    const int fifoFrames = juce::nextPowerOfTwo(juce::roundToInt(sampleRate * FIFO_SECONDS));
+    fifo.setTotalSize(fifoFrames);
+    fifo.reset();
+    fifoData.calloc(static_cast<size_t>(fifoFrames) * static_cast<size_t>(layout.numChannels));
+    droppedFrames.store(0);
+
+    for (int bus = 0; bus < MAX_BUSES; ++bus)
+        publish(bus, {});
+    numBuses.store(layout.numBuses, std::memory_order_release);
+
+    running.store(true, std::memory_order_release);
+    startThread(juce::Thread::Priority::low);
+    return true;
+}
+
+void LoudnessAnalyzer::stop()
+{
+    running.store(false, std::memory_order_release);
+    stopThread(1000);
+}
+
+LoudnessAnalyzer::Results LoudnessAnalyzer::getResults(int bus) const
+{
+    Results results;
+    if (bus < 0 || bus >= MAX_BUSES)
+        return results;
+
+    results.momentaryLufs  = momentary[bus].load(std::memory_order_relaxed);
+    results.shortTermLufs  = shortTerm[bus].load(std::memory_order_relaxed);
+    results.integratedLufs = integrated[bus].load(std::memory_order_relaxed);
+    results.truePeakDbtp   = truePeak[bus].load(std::memory_order_relaxed);
+    return results;
+}
+
+void LoudnessAnalyzer::publish(int bus, const Results& results)
+{
+    momentary[bus].store(results.momentaryLufs, std::memory_order_relaxed);
+    shortTerm[bus].store(results.shortTermLufs, std::memory_order_relaxed);
+    integrated[bus].store(results.integratedLufs, std::memory_order_relaxed);
+    truePeak[bus].store(results.truePeakDbtp, std::memory_order_relaxed);
+}
+
+template <typename SampleType>
+void LoudnessAnalyzer::pushBlock(const juce::AudioBuffer<SampleType>& buffer, int channels, int numSamples, float gain)
+{
+    if (!running.load(std::memory_order_acquire))
+        return;
+
+    const int numChannels = layout.numChannels;
+    const int framesToWrite = juce::jmin(numSamples, fifo.getFreeSpace());
+    if (framesToWrite < numSamples)
+        droppedFrames.fetch_add(static_cast<uint64_t>(numSamples - framesToWrite), std::memory_order_relaxed);
+
+    const int channelsToCopy = juce::jmin(channels, numChannels, buffer.getNumChannels());
+    const auto blockGain = static_cast<SampleType>(gain);
+    const auto scope = fifo.write(framesToWrite);
+
+    auto interleave = [&] (int fifoStart, int numFrames, int sourceOffset)
+    {
+        float* dest = fifoData.get() + static_cast<size_t>(fifoStart) * static_cast<size_t>(numChannels);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            if (channel < channelsToCopy)
+            {
+                const SampleType* source = buffer.getReadPointer(channel, sourceOffset);
+                for (int frame = 0; frame < numFrames; ++frame)
+                    dest[frame * numChannels + channel] = static_cast<float>(source[frame] * blockGain);
+            }
+            else
+            {
+                for (int frame = 0; frame < numFrames; ++frame)
+                    dest[frame * numChannels + channel] = 0.0f;
+            }
+        }
+    };
+
+    if (scope.blockSize1 > 0) interleave(scope.startIndex1, scope.blockSize1, 0);
+    if (scope.blockSize2 > 0) interleave(scope.startIndex2, scope.blockSize2, scope.blockSize1);
+}
+
+template void LoudnessAnalyzer::pushBlock(const juce::AudioBuffer<float>&, int, int, float);
+template void LoudnessAnalyzer::pushBlock(const juce::AudioBuffer<double>&, int, int, float);
+
+void LoudnessAnalyzer::run()
+{
+    while (!threadShouldExit())
+    {
+        if (resetRequested.exchange(false, std::memory_order_acq_rel))
+            clearMeasurement();
+
+        // Read up to the end of the current sub-block, so each one closes on its exact frame
+        const int frames = juce::jmin(fifo.getNumReady(), subBlockFrames - framesInSubBlock);
+        if (frames == 0)
+        {
+            wait(POLL_MS);
+            continue;
+        }
+
+        {
+            const auto scope = fifo.read(frames);
+            const size_t stride = static_cast<size_t>(layout.numChannels);
+            if (scope.blockSize1 > 0) analyse(fifoData.get() + static_cast<size_t>(scope.startIndex1) * stride, scope.blockSize1);
+            if (scope.blockSize2 > 0) analyse(fifoData.get() + static_cast<size_t>(scope.startIndex2) * stride, scope.blockSize2);
+        }
+
+        framesInSubBlock += frames;
+        if (framesInSubBlock == subBlockFrames)
+            finishSubBlock();
+    }
+}
+
+void LoudnessAnalyzer::analyse(const float* frames, int numFrames)
+{
+    const int numChannels = layout.numChannels;
+
+    for (int frame = 0; frame < numFrames; ++frame)
+    {
+        const float* in = frames + static_cast<size_t>(frame) * static_cast<size_t>(numChannels);
+
+        // K-weighted energy. Every channel shares the coefficients, so each step is one
+        // vector operation across the frame's channels.
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const double x = in[channel];
+            const double shelved = shelfB[0] * x + shelfZ1[channel];
+            shelfZ1[channel] = shelfB[1] * x - shelfA[1] * shelved + shelfZ2[channel];
+            shelfZ2[channel] = shelfB[2] * x - shelfA[2] * shelved;
+
+            const double weighted = highPassB[0] * shelved + highPassZ1[channel];
+            highPassZ1[channel] = highPassB[1] * shelved - highPassA[1] * weighted + highPassZ2[channel];
+            highPassZ2[channel] = highPassB[2] * shelved - highPassA[2] * weighted;
+
+            sumSquares[channel] += weighted * weighted;
+        }
+
+        // True peak: the four interpolated phases between the previous sample and this one
+        historyPosition = historyPosition + 1 == TAPS_PER_PHASE ? 0 : historyPosition + 1;
+        std::memcpy(history[historyPosition], in, static_cast<size_t>(numChannels) * sizeof(float));
+        std::memcpy(history[historyPosition + TAPS_PER_PHASE], in, static_cast<size_t>(numChannels) * sizeof(float));
+
+        // history[historyPosition + 1 + k] is the sample from TAPS_PER_PHASE - 1 - k frames ago
+        const auto window = history + historyPosition + 1;
+
+        for (int phase = 0; phase < OVERSAMPLING; ++phase)
+        {
+            float sum[MAX_CHANNELS];
+            for (int channel = 0; channel < numChannels; ++channel)
+                sum[channel] = 0.0f;
+
+            for (int tap = 0; tap < TAPS_PER_PHASE; ++tap)
+            {
+                const float coefficient = interpolator[tap * OVERSAMPLING + phase];
+                const float* samples = window[TAPS_PER_PHASE - 1 - tap];
+                for (int channel = 0; channel < numChannels; ++channel)
+                    sum[channel] += coefficient * samples[channel];
+            }
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                peaks[channel] = juce::jmax(peaks[channel], std::abs(sum[channel]));
+        }
+    }
+}
+
+void LoudnessAnalyzer::finishSubBlock()
+{
+    const int slot = static_cast<int>(subBlocksDone % SHORT_TERM_SUB_BLOCKS);
+    ++subBlocksDone;
+
+    int firstChannel = 0;
+    for (int bus = 0; bus < layout.numBuses; ++bus)
+    {
+        const int channelCount = layout.busChannels[bus];
+
+        double power = 0.0;
+        float peak = 0.0f;
+        for (int channel = firstChannel; channel < firstChannel + channelCount; ++channel)
+        {
+            power += layout.channelWeights[channel] * sumSquares[channel] / subBlockFrames;
+            peak = juce::jmax(peak, peaks[channel]);
+        }
+        firstChannel += channelCount;
+
+        busPower[bus][slot] = power;
+
+        auto meanPower = [this, bus, slot] (int subBlocks)
+        {
+            double sum = 0.0;
+            for (int i = 0; i < subBlocks; ++i)
+                sum += busPower[bus][(slot + SHORT_TERM_SUB_BLOCKS - i) % SHORT_TERM_SUB_BLOCKS];
+            return sum / subBlocks;
+        };
+
+        Results results;
+        results.truePeakDbtp = floored(juce::Decibels::gainToDecibels(static_cast<double>(peak), -1000.0));
+
+        // Momentary loudness is also the gating block for integrated loudness (400 ms,
+        // 75% overlap)
+        if (subBlocksDone >= MOMENTARY_SUB_BLOCKS)
+        {
+            const double blockPower = meanPower(MOMENTARY_SUB_BLOCKS);
+            const double blockLufs = toLufs(blockPower);
+            results.momentaryLufs = floored(blockLufs);
+
+            if (blockLufs > ABSOLUTE_GATE_LUFS)
+            {
+                const int bin = juce::jlimit(0, HISTOGRAM_BINS - 1, static_cast<int>((blockLufs - ABSOLUTE_GATE_LUFS) / HISTOGRAM_STEP_LU));
+                ++histogramCount[bus][bin];
+                histogramPower[bus][bin] += blockPower;
+            }
+        }
+
+        if (subBlocksDone >= SHORT_TERM_SUB_BLOCKS)
+            results.shortTermLufs = floored(toLufs(meanPower(SHORT_TERM_SUB_BLOCKS)));
+
+        // Gated integrated loudness: the mean over the blocks above the absolute gate sets
+        // the relative gate, and the mean over the blocks above both is the result
+        uint64_t count = 0;
+        double total = 0.0;
+        for (int bin = 0; bin < HISTOGRAM_BINS; ++bin)
+        {
+            count += histogramCount[bus][bin];
+            total += histogramPower[bus][bin];
+        }
+
+        if (count > 0)
+        {
+            const double relativeGate = toLufs(total / static_cast<double>(count)) + RELATIVE_GATE_LU;
+            const int firstBin = juce::jlimit(0, HISTOGRAM_BINS, static_cast<int>(std::ceil((relativeGate - ABSOLUTE_GATE_LUFS) / HISTOGRAM_STEP_LU)));
+
+            count = 0;
+            total = 0.0;
+            for (int bin = firstBin; bin < HISTOGRAM_BINS; ++bin)
+            {
+                count += histogramCount[bus][bin];
+                total += histogramPower[bus][bin];
+            }
+
+            if (count > 0)
+                results.integratedLufs = floored(toLufs(total / static_cast<double>(count)));
+        }
+
+        publish(bus, results);
+    }
+
+    std::fill(std::begin(sumSquares), std::end(sumSquares), 0.0);
+    framesInSubBlock = 0;
+    resultsVersion.fetch_add(1, std::memory_order_release);
+}
+
+void LoudnessAnalyzer::clearMeasurement()
+{
+    std::fill(std::begin(sumSquares), std::end(sumSquares), 0.0);
+    std::fill(std::begin(peaks), std::end(peaks), 0.0f);
+    std::memset(busPower, 0, sizeof(busPower));
+    std::memset(histogramCount, 0, sizeof(histogramCount));
+    std::memset(histogramPower, 0, sizeof(histogramPower));
+    framesInSubBlock = 0;
+    subBlocksDone = 0;
+}
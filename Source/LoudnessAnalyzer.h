@@ -0,0 +1,120 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Transport/SharedSegmentExtension.h"
+
+//==============================================================================
+// EBU R128 / ITU-R BS.1770 loudness and true peak per input bus, off the audio thread.
+//
+// The audio thread only interleaves each block into a lock-free FIFO (pushBlock), as
+// for the network sender. A background thread K-weights every channel, integrates
+// 100 ms sub-blocks into momentary (400 ms), short-term (3 s) and gated integrated
+// loudness, and tracks the 4x oversampled true peak. The filters run across all
+// channels of a frame at once from struct-of-arrays state, so the compiler
+// vectorises the channel loops. Results are relaxed atomics that any thread may read.
+//==============================================================================
+class LoudnessAnalyzer : private juce::Thread
+{
+public:
+    static constexpr int MAX_BUSES = SharedSegmentExtension::MAX_LOUDNESS_BUSES;
+    static constexpr int MAX_CHANNELS = SharedSegmentExtension::MAX_CHANNELS;
+
+    // Reported while nothing has been measured yet (and for digital silence)
+    static constexpr float FLOOR_DB = SharedSegmentExtension::LOUDNESS_FLOOR_DB;
+
+    struct Layout
+    {
+        int numChannels = 0;
+        int numBuses = 0;
+        int busChannels[MAX_BUSES] {};          // Consecutive channels per bus, in bus order
+        float channelWeights[MAX_CHANNELS] {};  // BS.1770 weights: 1, 1.41 for surrounds, 0 for LFE
+    };
+
+    struct Results
+    {
+        float momentaryLufs = FLOOR_DB;
+        float shortTermLufs = FLOOR_DB;
+        float integratedLufs = FLOOR_DB;
+        float truePeakDbtp = FLOOR_DB;          // Highest since the last reset
+    };
+
+    LoudnessAnalyzer();
+    ~LoudnessAnalyzer() override;
+
+    // Call from prepareToPlay or the message thread, never from processBlock.
+    bool start(double sampleRate, const Layout& layout);
+    void stop();
+
+    bool isRunning() const { return running.load(std::memory_order_acquire); }
+
+    // Audio thread: copies numSamples frames of the first numChannels channels, scaled
+    // by gain, into the FIFO. Never blocks or allocates; frames that don't fit are
+    // dropped and counted.
+    template <typename SampleType>
+    void pushBlock(const juce::AudioBuffer<SampleType>& buffer, int numChannels, int numSamples, float gain = 1.0f);
+
+    // Any thread. The version changes whenever new results are published (every 100 ms).
+    int getNumBuses() const            { return numBuses.load(std::memory_order_acquire); }
+    Results getResults(int bus) const;
+    uint32_t getResultsVersion() const { return resultsVersion.load(std::memory_order_acquire); }
+    uint64_t getDroppedFrames() const  { return droppedFrames.load(std::memory_order_relaxed); }
+
+    // Any thread: restarts integrated loudness and the true-peak hold.
+    void reset() { resetRequested.store(true, std::memory_order_release); }
+
+private:
+    void run() override;
+    void analyse(const float* frames, int numFrames);
+    void finishSubBlock();
+    void clearMeasurement();
+    void publish(int bus, const Results& results);
+
+    static constexpr int POLL_MS = 20;
+    static constexpr double FIFO_SECONDS = 1.0;
+
+    static constexpr int SHORT_TERM_SUB_BLOCKS = 30;     // 3 s of 100 ms sub-blocks
+    static constexpr int MOMENTARY_SUB_BLOCKS = 4;       // 400 ms
+
+    // Integrated loudness keeps gating blocks in a 0.1 LU histogram from the absolute
+    // gate (-70 LUFS) up, so it needs constant memory however long it runs
+    static constexpr double ABSOLUTE_GATE_LUFS = -70.0;
+    static constexpr double RELATIVE_GATE_LU = -10.0;
+    static constexpr double HISTOGRAM_STEP_LU = 0.1;
+    static constexpr int HISTOGRAM_BINS = 800;           // -70 .. +10 LUFS
+
+    // 4x oversampling interpolator: 48 taps, 12 per phase, as in BS.1770-4 Annex 2
+    static constexpr int OVERSAMPLING = 4;
+    static constexpr int TAPS_PER_PHASE = 12;
+
+    std::atomic<bool> running { false };
+    std::atomic<bool> resetRequested { false };
+
+    Layout layout;
+    juce::AbstractFifo fifo { 1 };
+    juce::HeapBlock<float> fifoData;                     // Interleaved frames, indexed by FIFO position
+
+    // K-weighting: a high shelf then a high pass, as transposed direct form II biquads
+    double shelfB[3] {}, shelfA[3] {}, highPassB[3] {}, highPassA[3] {};
+    double shelfZ1[MAX_CHANNELS] {}, shelfZ2[MAX_CHANNELS] {};
+    double highPassZ1[MAX_CHANNELS] {}, highPassZ2[MAX_CHANNELS] {};
+    double sumSquares[MAX_CHANNELS] {};
+
+    float interpolator[OVERSAMPLING * TAPS_PER_PHASE] {};
+    float history[2 * TAPS_PER_PHASE][MAX_CHANNELS] {};  // Each sample twice, so the window is contiguous
+    int historyPosition = 0;
+    float peaks[MAX_CHANNELS] {};
+
+    int subBlockFrames = 0;
+    int framesInSubBlock = 0;
+    uint64_t subBlocksDone = 0;
+    double busPower[MAX_BUSES][SHORT_TERM_SUB_BLOCKS] {};   // Weighted mean square per sub-block
+    uint64_t histogramCount[MAX_BUSES][HISTOGRAM_BINS] {};
+    double histogramPower[MAX_BUSES][HISTOGRAM_BINS] {};
+
+    std::atomic<int> numBuses { 0 };
+    std::atomic<float> momentary[MAX_BUSES], shortTerm[MAX_BUSES], integrated[MAX_BUSES], truePeak[MAX_BUSES];
+    std::atomic<uint32_t> resultsVersion { 0 };
+    std::atomic<uint64_t> droppedFrames { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoudnessAnalyzer)
+};
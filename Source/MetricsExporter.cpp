@@ -0,0 +1,459 @@
+#include "MetricsExporter.h"
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace
+{
+    // The socket path is a user setting: only ever delete a socket there, never a file
+    // someone mistyped the path of. False if anything else occupies the path.
+    bool removeStaleSocket (const char* path)
+    {
+        struct stat info;
+        if (lstat(path, &info) == -1)
+            return errno == ENOENT;
+
+        return S_ISSOCK(info.st_mode) && (unlink(path) == 0 || errno == ENOENT);
+    }
+}
+
+MetricsExporter::MetricsExporter()
+    : juce::Thread("AudioSender metrics")
+{
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+}
+
+bool MetricsExporter::start(const Settings& newSettings, Source newSource)
+{
+    stop();
+
+    if (newSource == nullptr || (newSettings.socketPath.isEmpty() && (newSettings.port <= 0 || newSettings.port > 65535)))
+        return false;
+
+    settings = newSettings;
+
+    if (newSettings.socketPath.isNotEmpty())
+    {
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+
+        const auto path = newSettings.socketPath.toRawUTF8();
+        if (std::strlen(path) >= sizeof(address.sun_path))
+        {
+            juce::Logger::writeToLog("Metrics exporter: socket path too long: " + newSettings.socketPath);
+            return false;
+        }
+
+        std::strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+
+        // A stale socket from a previous run would make bind fail
+        if (!removeStaleSocket(path))
+        {
+            juce::Logger::writeToLog("Metrics exporter: " + newSettings.socketPath + " exists and isn't a removable socket");
+            settings = {};
+            return false;
+        }
+
+        // Owner only, like the segment handshake socket; chmod after bind, since the
+        // umask is process wide
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd != -1 && (bind(listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1
+                               || chmod(path, 0600) == -1))
+        {
+            close(listenFd);
+            listenFd = -1;
+        }
+    }
+    else
+    {
+        // Loopback only: the metrics are for the local machine's monitoring agent
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(newSettings.port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        if (listenFd != -1)
+            setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        if (listenFd != -1 && bind(listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1)
+        {
+            close(listenFd);
+            listenFd = -1;
+        }
+    }
+
+    if (listenFd == -1 || listen(listenFd, 4) == -1)
+    {
+        juce::Logger::writeToLog("Metrics exporter: failed to listen: " + juce::String(strerror(errno)));
+        stop();
+        return false;
+    }
+
+    source = std::move(newSource);
+    lastBlocksProcessed = 0;
+    lastRequestMs = 0.0;
+
+    juce::Logger::writeToLog("Metrics exporter listening on "
+                             + (settings.socketPath.isNotEmpty() ? settings.socketPath : "127.0.0.1:" + juce::String(settings.port)));
+
+    return startThread(juce::Thread::Priority::low);
+}
+
+void MetricsExporter::stop()
+{
+    stopThread(2000);
+
+    if (listenFd != -1)
+    {
+        close(listenFd);
+        listenFd = -1;
+
+        if (settings.socketPath.isNotEmpty())
+            removeStaleSocket(settings.socketPath.toRawUTF8());
+    }
+
+    source = nullptr;
+}
+
+void MetricsExporter::run()
+{
+    while (!threadShouldExit())
+    {
+        // Wake up regularly so stop() never waits on a quiet socket
+        pollfd listening { listenFd, POLLIN, 0 };
+        if (poll(&listening, 1, POLL_MS) <= 0 || (listening.revents & POLLIN) == 0)
+            continue;
+
+        const int clientFd = accept(listenFd, nullptr, nullptr);
+        if (clientFd == -1)
+            continue;
+
+        serveClient(clientFd);
+        close(clientFd);
+    }
+}
+
+void MetricsExporter::serveClient(int clientFd)
+{
+    // A client hanging up mid-response must not raise SIGPIPE in the host
+   #if defined (MSG_NOSIGNAL)
+    constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+   #else
+    constexpr int SEND_FLAGS = 0;
+    int noSigPipe = 1;
+    setsockopt(clientFd, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+   #endif
+
+    // One deadline for the whole exchange, so a client trickling bytes can't hold the
+    // only exporter thread, and stop() is never kept waiting past a poll interval
+    const double deadlineMs = juce::Time::getMillisecondCounterHiRes() + REQUEST_TIMEOUT_MS;
+    auto waitFor = [&] (short events)
+    {
+        for (;;)
+        {
+            const auto remainingMs = static_cast<int>(deadlineMs - juce::Time::getMillisecondCounterHiRes());
+            if (remainingMs <= 0 || threadShouldExit())
+                return false;
+
+            pollfd client { clientFd, events, 0 };
+            const int ready = poll(&client, 1, juce::jmin(remainingMs, POLL_MS));
+            if (ready > 0)
+                return true;
+            if (ready == -1 && errno != EINTR)
+                return false;
+        }
+    };
+
+    // Read until the end of the request headers (or give up on a slow client)
+    char request[MAX_REQUEST_BYTES + 1] {};
+    int received = 0;
+
+    while (received < MAX_REQUEST_BYTES && std::strstr(request, "\r\n\r\n") == nullptr && std::strstr(request, "\n\n") == nullptr)
+    {
+        if (!waitFor(POLLIN))
+            break;
+
+        const auto bytes = recv(clientFd, request + received, static_cast<size_t>(MAX_REQUEST_BYTES - received), 0);
+        if (bytes <= 0)
+            break;
+
+        received += static_cast<int>(bytes);
+    }
+
+    const auto requestLine = juce::String::fromUTF8(request, received).upToFirstOccurrenceOf("\n", false, false).trim();
+    const auto target = requestLine.fromFirstOccurrenceOf(" ", false, false).upToFirstOccurrenceOf(" ", false, false);
+
+    juce::String status = "200 OK", contentType, body;
+
+    if (!requestLine.startsWith("GET "))
+    {
+        status = "405 Method Not Allowed";
+        contentType = "text/plain";
+        body = "GET only\n";
+    }
+    else if (target == "/metrics" || target == "/metrics.json" || target == "/")
+    {
+        TransportDiagnosticsSnapshot snapshot;
+        source(snapshot);
+
+        const double nowMs = juce::Time::getMillisecondCounterHiRes();
+        const double elapsedSeconds = (nowMs - lastRequestMs) * 0.001;
+        const double blockRate = lastRequestMs > 0.0 && elapsedSeconds > 0.0 && snapshot.blocksProcessed >= lastBlocksProcessed
+                                     ? static_cast<double>(snapshot.blocksProcessed - lastBlocksProcessed) / elapsedSeconds
+                                     : 0.0;
+        lastRequestMs = nowMs;
+        lastBlocksProcessed = snapshot.blocksProcessed;
+
+        if (target == "/metrics.json")
+        {
+            contentType = "application/json";
+            body = formatJson(snapshot, blockRate);
+        }
+        else
+        {
+            contentType = "text/plain; version=0.0.4";
+            body = formatPrometheus(snapshot, blockRate);
+        }
+    }
+    else
+    {
+        status = "404 Not Found";
+        contentType = "text/plain";
+        body = "Try /metrics or /metrics.json\n";
+    }
+
+    const auto bodyUtf8 = body.toStdString();
+    const auto response = "HTTP/1.0 " + status.toStdString() + "\r\nContent-Type: " + contentType.toStdString()
+                          + "\r\nContent-Length: " + std::to_string(bodyUtf8.size()) + "\r\nConnection: close\r\n\r\n" + bodyUtf8;
+
+    size_t sent = 0;
+    while (sent < response.size() && waitFor(POLLOUT))
+    {
+        // Non-blocking, so a client that stops reading can't stall us past the deadline
+        const auto bytes = send(clientFd, response.data() + sent, response.size() - sent, SEND_FLAGS | MSG_DONTWAIT);
+        if (bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            continue;
+        if (bytes <= 0)
+            break;
+        sent += static_cast<size_t>(bytes);
+    }
+}
+
+juce::String MetricsExporter::formatPrometheus(const TransportDiagnosticsSnapshot& s, double blockRate)
+{
+    juce::String text;
+
+    auto metric = [&text] (const char* name, const char* type, const char* help, const juce::String& value)
+    {
+        text << "# HELP audiosender_" << name << " " << help << "\n"
+             << "# TYPE audiosender_" << name << " " << type << "\n"
+             << "audiosender_" << name << " " << value << "\n";
+    };
+
+    auto integer = [] (uint64_t value) { return juce::String(static_cast<juce::int64>(value)); };
+
+    metric("connected", "gauge", "1 while the shared memory segment is active", s.connected ? "1" : "0");
+    metric("sample_rate_hz", "gauge", "Stream sample rate", juce::String(s.sampleRate));
+    metric("channels", "gauge", "Interleaved channels in the ring", juce::String(s.numChannels));
+    metric("block_size_frames", "gauge", "Most recent block size", juce::String(s.blockSize));
+    metric("sample_format_float64", "gauge", "1 if the ring carries float64 samples", s.float64 ? "1" : "0");
+    metric("target_latency_ms", "gauge", "Target latency chosen by adaptive buffering", juce::String(s.targetLatencyMs));
+    metric("ring_capacity_frames", "gauge", "Audio ring capacity", integer(s.ringCapacity));
+    metric("ring_queued_frames", "gauge", "Frames written but not yet read", integer(s.writeIndex - s.readIndex <= s.ringCapacity ? s.writeIndex - s.readIndex : 0));
+    metric("configuration_counter", "counter", "Configuration changes published to receivers", integer(s.configurationCounter));
+    metric("ring_generation", "counter", "Ring resize generation (odd while resizing)", integer(s.ringGeneration));
+    metric("blocks_total", "counter", "Blocks processed", integer(s.blocksProcessed));
+    metric("block_rate_hz", "gauge", "Blocks per second since the previous scrape", juce::String(blockRate, 2));
+    metric("overruns_total", "counter", "Blocks dropped because the ring was full", integer(s.overruns));
+    metric("underruns_total", "counter", "Receiver underruns", integer(s.underruns));
+    metric("return_underruns_total", "counter", "Return path blocks that arrived late", integer(s.returnUnderruns));
+    metric("event_overruns_total", "counter", "Events dropped because the event ring was full", integer(s.eventOverruns));
+    metric("callback_ms", "gauge", "Time spent in the last processBlock", juce::String(s.callbackMs, 4));
+    metric("callback_peak_ms", "gauge", "Worst processBlock time since the last reset", juce::String(s.callbackPeakMs, 4));
+    metric("callback_interval_ms", "gauge", "Time between the last two processBlock calls", juce::String(s.callbackIntervalMs, 4));
+    metric("receiver_heartbeat_age_ms", "gauge", "Time since the receiver last advanced readIndex (-1 = never)", juce::String(s.readerHeartbeatAgeMs, 1));
+    metric("receiver_present", "gauge", "1 while the receiver is reading or signalling its heartbeat", s.receiverPresent ? "1" : "0");
+    metric("idle_blocks_total", "counter", "Blocks not published because no receiver was present", integer(s.idleBlocks));
+    metric("resyncs_total", "counter", "Stream restarts when a receiver appeared", integer(s.resyncs));
+    metric("offline_drops_total", "counter", "Offline blocks dropped without waiting for a stalled receiver", integer(s.offlineDrops));
+    metric("aggregation_dropped_blocks_total", "counter", "Aggregation blocks behind another lane's cycle", integer(s.aggregationDroppedBlocks));
+    metric("aggregation_oversized_blocks_total", "counter", "Aggregation blocks too long for the lane", integer(s.aggregationOversizedBlocks));
+    metric("aggregation_truncated_channels", "gauge", "Channels left out of the aggregation lane", juce::String(s.aggregationTruncatedChannels));
+
+    // Loudness per input bus
+    auto loudness = [&text, &s] (const char* name, const char* help, float TransportDiagnosticsSnapshot::BusLoudness::* field)
+    {
+        text << "# HELP audiosender_" << name << " " << help << "\n"
+             << "# TYPE audiosender_" << name << " gauge\n";
+        for (int bus = 0; bus < s.loudnessBuses; ++bus)
+            text << "audiosender_" << name << "{bus=\"" << bus << "\"} " << juce::String(s.loudness[bus].*field, 1) << "\n";
+    };
+
+    loudness("momentary_loudness_lufs", "EBU R128 momentary loudness (400 ms)", &TransportDiagnosticsSnapshot::BusLoudness::momentaryLufs);
+    loudness("short_term_loudness_lufs", "EBU R128 short-term loudness (3 s)", &TransportDiagnosticsSnapshot::BusLoudness::shortTermLufs);
+    loudness("integrated_loudness_lufs", "EBU R128 gated integrated loudness since the last reset", &TransportDiagnosticsSnapshot::BusLoudness::integratedLufs);
+    loudness("true_peak_dbtp", "Highest 4x oversampled true peak since the last reset", &TransportDiagnosticsSnapshot::BusLoudness::truePeakDbtp);
+
+    // Queued latency as a cumulative Prometheus histogram
+    text << "# HELP audiosender_queued_latency_ms Queued ring latency per block\n"
+         << "# TYPE audiosender_queued_latency_ms histogram\n";
+
+    uint64_t cumulative = 0;
+    for (int bin = 0; bin < TransportDiagnostics::LATENCY_BINS; ++bin)
+    {
+        cumulative += s.latencyHistogram[bin];
+        const auto bound = bin == TransportDiagnostics::LATENCY_BINS - 1 ? juce::String("+Inf")
+                                                                        : juce::String((bin + 1) * TransportDiagnostics::LATENCY_BIN_MS);
+        text << "audiosender_queued_latency_ms_bucket{le=\"" << bound << "\"} " << integer(cumulative) << "\n";
+    }
+    // Bins only keep counts, so the sum is estimated from the bin midpoints
+    double sum = 0.0;
+    for (int bin = 0; bin < TransportDiagnostics::LATENCY_BINS; ++bin)
+        sum += static_cast<double>(s.latencyHistogram[bin]) * (bin + 0.5) * TransportDiagnostics::LATENCY_BIN_MS;
+
+    text << "audiosender_queued_latency_ms_sum " << juce::String(sum, 1) << "\n"
+         << "audiosender_queued_latency_ms_count " << integer(cumulative) << "\n";
+
+    text << "# HELP audiosender_queued_latency_percentile_ms Queued latency percentiles (bin upper edges)\n"
+         << "# TYPE audiosender_queued_latency_percentile_ms gauge\n";
+    for (const auto quantile : { 0.5, 0.9, 0.99 })
+        text << "audiosender_queued_latency_percentile_ms{quantile=\"" << juce::String(quantile) << "\"} "
+             << juce::String(s.latencyPercentileMs(quantile)) << "\n";
+
+    // processBlock stage timing, in seconds as Prometheus expects. Builds without it
+    // export the gauge alone, so scrapers can tell missing histograms from idle ones.
+    metric("instrumentation_enabled", "gauge", "Whether processBlock stage timing is compiled in", s.instrumented ? "1" : "0");
+    if (!s.instrumented)
+        return text;
+
+    auto histogram = [&text, &integer] (const juce::String& name, const juce::String& labels, const uint64_t* bins, uint64_t totalNs)
+    {
+        uint64_t count = 0;
+        for (int bin = 0; bin < BlockInstrumentation::TIME_BINS; ++bin)
+        {
+            count += bins[bin];
+            const auto bound = bin == BlockInstrumentation::TIME_BINS - 1
+                                   ? juce::String("+Inf")
+                                   : juce::String(static_cast<double>(BlockInstrumentation::timeBinUpperNs(bin)) * 1.0e-9, 9);
+            text << name << "_bucket{" << labels << (labels.isEmpty() ? "" : ",") << "le=\"" << bound << "\"} " << integer(count) << "\n";
+        }
+
+        const auto suffix = labels.isEmpty() ? juce::String() : "{" + labels + "}";
+        if (totalNs > 0)
+            text << name << "_sum" << suffix << " " << juce::String(static_cast<double>(totalNs) * 1.0e-9, 9) << "\n";
+        text << name << "_count" << suffix << " " << integer(count) << "\n";
+    };
+
+    text << "# HELP audiosender_stage_seconds processBlock time per stage\n"
+         << "# TYPE audiosender_stage_seconds histogram\n";
+    for (int stage = 0; stage < BlockInstrumentation::NUM_STAGES; ++stage)
+        histogram("audiosender_stage_seconds", "stage=\"" + juce::String(BlockInstrumentation::stageName(stage)) + "\"",
+                  s.stageHistogram[stage], s.stageTotalNs[stage]);
+
+    text << "# HELP audiosender_callback_seconds Whole processBlock time\n"
+         << "# TYPE audiosender_callback_seconds histogram\n";
+    histogram("audiosender_callback_seconds", {}, s.callbackHistogram, 0);
+
+    text << "# HELP audiosender_callback_interval_seconds Time between processBlock calls\n"
+         << "# TYPE audiosender_callback_interval_seconds histogram\n";
+    histogram("audiosender_callback_interval_seconds", {}, s.intervalHistogram, 0);
+
+    text << "# HELP audiosender_callback_load Callbacks by duration as a share of their deadline\n"
+         << "# TYPE audiosender_callback_load histogram\n";
+    uint64_t loadCount = 0;
+    for (int bin = 0; bin < BlockInstrumentation::LOAD_BINS; ++bin)
+    {
+        loadCount += s.loadHistogram[bin];
+        const auto bound = bin == BlockInstrumentation::LOAD_BINS - 1 ? juce::String("+Inf") : juce::String((bin + 1) * 0.1, 1);
+        text << "audiosender_callback_load_bucket{le=\"" << bound << "\"} " << integer(loadCount) << "\n";
+    }
+    text << "audiosender_callback_load_count " << integer(loadCount) << "\n";
+
+    metric("deadline_misses_total", "counter", "Callbacks that took longer than the audio they produced", integer(s.deadlineMisses));
+
+    return text;
+}
+
+juce::String MetricsExporter::formatJson(const TransportDiagnosticsSnapshot& s, double blockRate)
+{
+    auto* object = new juce::DynamicObject();
+    auto integer = [] (uint64_t value) { return juce::var(static_cast<juce::int64>(value)); };
+
+    object->setProperty("connected", s.connected);
+    object->setProperty("sampleRate", s.sampleRate);
+    object->setProperty("channels", s.numChannels);
+    object->setProperty("blockSize", s.blockSize);
+    object->setProperty("float64", s.float64);
+    object->setProperty("targetLatencyMs", s.targetLatencyMs);
+    object->setProperty("ringCapacityFrames", integer(s.ringCapacity));
+    object->setProperty("ringQueuedFrames", integer(s.writeIndex - s.readIndex <= s.ringCapacity ? s.writeIndex - s.readIndex : 0));
+    object->setProperty("configurationCounter", integer(s.configurationCounter));
+    object->setProperty("ringGeneration", integer(s.ringGeneration));
+    object->setProperty("blocks", integer(s.blocksProcessed));
+    object->setProperty("blockRateHz", blockRate);
+    object->setProperty("overruns", integer(s.overruns));
+    object->setProperty("underruns", integer(s.underruns));
+    object->setProperty("returnUnderruns", integer(s.returnUnderruns));
+    object->setProperty("eventOverruns", integer(s.eventOverruns));
+    object->setProperty("callbackMs", s.callbackMs);
+    object->setProperty("callbackPeakMs", s.callbackPeakMs);
+    object->setProperty("callbackIntervalMs", s.callbackIntervalMs);
+    object->setProperty("receiverHeartbeatAgeMs", s.readerHeartbeatAgeMs);
+    object->setProperty("receiverPresent", s.receiverPresent);
+    object->setProperty("idleBlocks", integer(s.idleBlocks));
+    object->setProperty("resyncs", integer(s.resyncs));
+    object->setProperty("offlineDrops", integer(s.offlineDrops));
+    object->setProperty("aggregationDroppedBlocks", integer(s.aggregationDroppedBlocks));
+    object->setProperty("aggregationOversizedBlocks", integer(s.aggregationOversizedBlocks));
+    object->setProperty("aggregationTruncatedChannels", s.aggregationTruncatedChannels);
+
+    juce::Array<juce::var> loudness;
+    for (int bus = 0; bus < s.loudnessBuses; ++bus)
+    {
+        auto* busObject = new juce::DynamicObject();
+        busObject->setProperty("momentaryLufs", s.loudness[bus].momentaryLufs);
+        busObject->setProperty("shortTermLufs", s.loudness[bus].shortTermLufs);
+        busObject->setProperty("integratedLufs", s.loudness[bus].integratedLufs);
+        busObject->setProperty("truePeakDbtp", s.loudness[bus].truePeakDbtp);
+        loudness.add(juce::var(busObject));
+    }
+    object->setProperty("loudness", loudness);
+    object->setProperty("latencyP50Ms", s.latencyPercentileMs(0.5));
+    object->setProperty("latencyP90Ms", s.latencyPercentileMs(0.9));
+    object->setProperty("latencyP99Ms", s.latencyPercentileMs(0.99));
+
+    // Mean time per stage, in microseconds; left out when instrumentation is compiled out
+    object->setProperty("instrumented", s.instrumented);
+    if (!s.instrumented)
+        return juce::JSON::toString(juce::var(object)) + "\n";
+
+    auto* stages = new juce::DynamicObject();
+    for (int stage = 0; stage < BlockInstrumentation::NUM_STAGES; ++stage)
+    {
+        uint64_t count = 0;
+        for (const auto bin : s.stageHistogram[stage])
+            count += bin;
+
+        stages->setProperty(BlockInstrumentation::stageName(stage),
+                            count > 0 ? static_cast<double>(s.stageTotalNs[stage]) * 1.0e-3 / static_cast<double>(count) : 0.0);
+    }
+
+    object->setProperty("stageMeanUs", juce::var(stages));
+    object->setProperty("instrumentedCallbacks", integer(s.instrumentedCallbacks));
+    object->setProperty("deadlineMisses", integer(s.deadlineMisses));
+
+    return juce::JSON::toString(juce::var(object)) + "\n";
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "TransportDiagnostics.h"
+
+//==============================================================================
+// Background exporter that serves stream health over a Unix domain socket or a
+// localhost TCP port, for hosts where nobody can open the plugin window.
+//
+// It answers plain HTTP/1.0 GETs: "/metrics" returns Prometheus text format and
+// "/metrics.json" returns the same values as JSON, e.g.
+//     curl --unix-socket /tmp/audiosender.sock http://localhost/metrics
+// Each request takes a fresh TransportDiagnosticsSnapshot from the source callback,
+// which only reads counters that are already published, so scraping adds no work
+// to processBlock.
+//==============================================================================
+class MetricsExporter : private juce::Thread
+{
+public:
+    struct Settings
+    {
+        juce::String socketPath;   // Unix domain socket to listen on...
+        int port = 0;              // ...or, if socketPath is empty, this 127.0.0.1 port
+    };
+
+    using Source = std::function<void (TransportDiagnosticsSnapshot&)>;
+
+    MetricsExporter();
+    ~MetricsExporter() override;
+
+    // The source is called from the exporter thread; the exporter must be stopped
+    // before whatever the source reads goes away.
+    bool start(const Settings& settings, Source source);
+    void stop();
+
+    bool isRunning() const { return isThreadRunning(); }
+
+    static juce::String formatPrometheus(const TransportDiagnosticsSnapshot& snapshot, double blockRate);
+    static juce::String formatJson(const TransportDiagnosticsSnapshot& snapshot, double blockRate);
+
+private:
+    void run() override;
+    void serveClient(int clientFd);
+
+    static constexpr int POLL_MS = 200;
+    static constexpr int MAX_REQUEST_BYTES = 2048;
+    static constexpr int REQUEST_TIMEOUT_MS = 1000;   // whole request, read and response
+
+    Settings settings;
+    Source source;
+    int listenFd = -1;
+
+    // Block rate between consecutive requests (exporter thread only)
+    uint64_t lastBlocksProcessed = 0;
+    double lastRequestMs = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MetricsExporter)
+};
@@ -0,0 +1,320 @@
+#include "NetworkAudioReceiver.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+
+NetworkAudioReceiver::NetworkAudioReceiver()
+    : juce::Thread("AudioReceiver network")
+{
+}
+
+NetworkAudioReceiver::~NetworkAudioReceiver()
+{
+    stop();
+}
+
+bool NetworkAudioReceiver::start(const juce::String& bindHost, int port, int channels, int packetFrames, int targetDepthPackets)
+{
+    stop();
+
+    if (channels <= 0 || channels > NetworkAudio::MAX_CHANNELS || packetFrames <= 0
+        || targetDepthPackets <= 0 || targetDepthPackets >= NUM_SLOTS / 2)
+        return false;
+
+    // Resolve like the sender does, so a receiver given "::1" or an IPv6-only name binds
+    // the family the sender will actually send from
+    addrinfo hints {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    addrinfo* result = nullptr;
+    if (getaddrinfo(bindHost.isEmpty() ? nullptr : bindHost.toRawUTF8(), juce::String(port).toRawUTF8(), &hints, &result) != 0
+        || result == nullptr)
+    {
+        juce::Logger::writeToLog("Network receiver: could not resolve " + bindHost);
+        return false;
+    }
+
+    // Without a host, prefer the IPv6 wildcard: with IPV6_V6ONLY off it takes IPv4 too
+    const addrinfo* address = result;
+    if (bindHost.isEmpty())
+        for (const addrinfo* candidate = result; candidate != nullptr; candidate = candidate->ai_next)
+            if (candidate->ai_family == AF_INET6)
+                address = candidate;
+
+    socketFd = socket(address->ai_family, SOCK_DGRAM, IPPROTO_UDP);
+    if (socketFd == -1)
+    {
+        juce::Logger::writeToLog("Network receiver: failed to create socket: " + juce::String(strerror(errno)));
+        freeaddrinfo(result);
+        return false;
+    }
+
+    if (address->ai_family == AF_INET6)
+    {
+        int v6Only = 0;
+        setsockopt(socketFd, IPPROTO_IPV6, IPV6_V6ONLY, &v6Only, sizeof(v6Only));
+    }
+
+    int receiveBufferBytes = 1 << 20;
+    setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, &receiveBufferBytes, sizeof(receiveBufferBytes));
+
+    // Wake up regularly so stop() doesn't hang on an idle socket
+    timeval timeout { 0, 100000 };
+    setsockopt(socketFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    const bool bound = bind(socketFd, address->ai_addr, address->ai_addrlen) == 0;
+    const int bindError = errno;
+    freeaddrinfo(result);
+
+    if (!bound)
+    {
+        juce::Logger::writeToLog("Network receiver: failed to bind port " + juce::String(port) + ": " + juce::String(strerror(bindError)));
+        close(socketFd);
+        socketFd = -1;
+        return false;
+    }
+
+    numChannels = channels;
+    framesPerPacket = packetFrames;
+    targetDepth = targetDepthPackets;
+
+    const size_t samplesPerPacket = static_cast<size_t>(framesPerPacket) * static_cast<size_t>(numChannels);
+    for (auto& slot : slots)
+    {
+        slot.tag.store(0);
+        slot.samples.calloc(samplesPerPacket);
+    }
+    currentPacket.calloc(samplesPerPacket);
+    lastGoodPacket.calloc(samplesPerPacket);
+
+    highestExtended = 0;
+    haveFirstPacket = false;
+    newestSequence.store(0);
+    streamStarted.store(false);
+    playCursor.store(0);
+    playbackActive.store(false);
+
+    playing = false;
+    playSequence = 0;
+    playOffset = framesPerPacket;
+    consecutiveLosses = 0;
+
+    packetsReceived.store(0);
+    packetsLost.store(0);
+    packetsLate.store(0);
+    framesConcealed.store(0);
+
+    startThread(juce::Thread::Priority::high);
+    return true;
+}
+
+void NetworkAudioReceiver::stop()
+{
+    stopThread(1000);
+
+    if (socketFd != -1)
+    {
+        close(socketFd);
+        socketFd = -1;
+    }
+}
+
+void NetworkAudioReceiver::run()
+{
+    const int datagramBytes = NetworkAudio::MAX_DATAGRAM_BYTES;
+    juce::HeapBlock<uint8_t> receiveData(static_cast<size_t>(MAX_BATCH) * datagramBytes);
+
+   #if defined (__linux__)
+    mmsghdr messages[MAX_BATCH] {};
+    iovec vectors[MAX_BATCH] {};
+
+    for (int i = 0; i < MAX_BATCH; ++i)
+    {
+        vectors[i].iov_base = receiveData.get() + static_cast<size_t>(i) * datagramBytes;
+        vectors[i].iov_len  = static_cast<size_t>(datagramBytes);
+        messages[i].msg_hdr.msg_iov    = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (!threadShouldExit())
+    {
+        // Block for the first datagram, then take whatever else is already queued
+        const int received = recvmmsg(socketFd, messages, MAX_BATCH, MSG_WAITFORONE, nullptr);
+
+        for (int i = 0; i < received; ++i)
+            storePacket(static_cast<const uint8_t*>(vectors[i].iov_base), static_cast<int>(messages[i].msg_len));
+    }
+   #else
+    while (!threadShouldExit())
+    {
+        const auto received = recv(socketFd, receiveData.get(), static_cast<size_t>(datagramBytes), 0);
+
+        if (received > 0)
+            storePacket(receiveData.get(), static_cast<int>(received));
+    }
+   #endif
+}
+
+void NetworkAudioReceiver::storePacket(const uint8_t* datagram, int numBytes)
+{
+    NetworkAudio::PacketHeader header;
+    if (!NetworkAudio::readHeader(datagram, numBytes, header)
+        || header.numChannels != numChannels || header.numFrames != framesPerPacket)
+        return;
+
+    // Extend the 16-bit RTP sequence number to 32 bits relative to the newest packet seen
+    uint32_t extended = header.sequence;
+    if (haveFirstPacket)
+    {
+        const auto delta = static_cast<int16_t>(header.sequence - static_cast<uint16_t>(highestExtended));
+        extended = highestExtended + static_cast<uint32_t>(static_cast<int32_t>(delta));
+
+        if (playbackActive.load(std::memory_order_acquire)
+            && static_cast<int32_t>(extended - playCursor.load(std::memory_order_acquire)) < 0)
+        {
+            // Already played out (or concealed)
+            packetsLate.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    // Seqlock-style slot update: invalidate, write, then publish the new tag
+    auto& slot = slots[extended & (NUM_SLOTS - 1)];
+    slot.tag.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    NetworkAudio::bigEndianToFloats(datagram + NetworkAudio::HEADER_BYTES, slot.samples.get(),
+                                    framesPerPacket * numChannels);
+    slot.tag.store(extended + 1, std::memory_order_release);
+
+    if (!haveFirstPacket || static_cast<int32_t>(extended - highestExtended) > 0)
+    {
+        highestExtended = extended;
+        newestSequence.store(extended, std::memory_order_release);
+    }
+
+    if (!haveFirstPacket)
+    {
+        haveFirstPacket = true;
+        firstSequence.store(extended, std::memory_order_relaxed);
+        streamStarted.store(true, std::memory_order_release);
+    }
+
+    packetsReceived.fetch_add(1, std::memory_order_relaxed);
+
+    const auto nowNs = NetworkAudio::monotonicNanos();
+    if (nowNs >= header.sendTimeNs)
+        lastTransitMs.store(static_cast<double>(nowNs - header.sendTimeNs) * 1.0e-6, std::memory_order_relaxed);
+}
+
+void NetworkAudioReceiver::concealPacket(float* dest)
+{
+    const int samplesPerPacket = framesPerPacket * numChannels;
+
+    // First loss: repeat the last good packet with a fade-out. Further losses: silence.
+    if (consecutiveLosses == 1)
+    {
+        for (int frame = 0; frame < framesPerPacket; ++frame)
+        {
+            const float fade = 1.0f - static_cast<float>(frame + 1) / static_cast<float>(framesPerPacket);
+            for (int channel = 0; channel < numChannels; ++channel)
+                dest[frame * numChannels + channel] = lastGoodPacket[frame * numChannels + channel] * fade;
+        }
+    }
+    else
+    {
+        std::fill(dest, dest + samplesPerPacket, 0.0f);
+    }
+
+    framesConcealed.fetch_add(static_cast<uint64_t>(framesPerPacket), std::memory_order_relaxed);
+}
+
+void NetworkAudioReceiver::pullInterleaved(float* dest, int numFrames)
+{
+    int framesWritten = 0;
+
+    while (framesWritten < numFrames)
+    {
+        if (!playing)
+        {
+            // Wait until the jitter buffer holds the target depth
+            if (!streamStarted.load(std::memory_order_acquire))
+                break;
+
+            const uint32_t newest = newestSequence.load(std::memory_order_acquire);
+            if (static_cast<int32_t>(newest - firstSequence.load(std::memory_order_relaxed)) + 1 < targetDepth)
+                break;
+
+            playSequence = newest - static_cast<uint32_t>(targetDepth - 1);
+            playOffset = framesPerPacket;
+            consecutiveLosses = 0;
+            playing = true;
+            playCursor.store(playSequence, std::memory_order_release);
+            playbackActive.store(true, std::memory_order_release);
+        }
+
+        if (playOffset == framesPerPacket)
+        {
+            const uint32_t newest = newestSequence.load(std::memory_order_acquire);
+
+            // Fell too far behind the network (e.g. the callback stalled): jump back to target depth
+            if (static_cast<int32_t>(newest - playSequence) >= NUM_SLOTS / 2)
+                playSequence = newest - static_cast<uint32_t>(targetDepth - 1);
+
+            auto& slot = slots[playSequence & (NUM_SLOTS - 1)];
+            const int samplesPerPacket = framesPerPacket * numChannels;
+
+            bool valid = slot.tag.load(std::memory_order_acquire) == playSequence + 1;
+            if (valid)
+            {
+                std::memcpy(currentPacket.get(), slot.samples.get(), static_cast<size_t>(samplesPerPacket) * sizeof(float));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                valid = slot.tag.load(std::memory_order_relaxed) == playSequence + 1;
+            }
+
+            if (valid)
+            {
+                std::memcpy(lastGoodPacket.get(), currentPacket.get(), static_cast<size_t>(samplesPerPacket) * sizeof(float));
+                consecutiveLosses = 0;
+            }
+            else
+            {
+                ++consecutiveLosses;
+                packetsLost.fetch_add(1, std::memory_order_relaxed);
+                concealPacket(currentPacket.get());
+            }
+
+            ++playSequence;
+            playOffset = 0;
+            playCursor.store(playSequence, std::memory_order_release);
+        }
+
+        const int framesToCopy = juce::jmin(numFrames - framesWritten, framesPerPacket - playOffset);
+        std::memcpy(dest + static_cast<size_t>(framesWritten) * static_cast<size_t>(numChannels),
+                    currentPacket.get() + static_cast<size_t>(playOffset) * static_cast<size_t>(numChannels),
+                    static_cast<size_t>(framesToCopy) * static_cast<size_t>(numChannels) * sizeof(float));
+
+        framesWritten += framesToCopy;
+        playOffset += framesToCopy;
+    }
+
+    // Still filling the jitter buffer
+    if (framesWritten < numFrames)
+        std::fill(dest + static_cast<size_t>(framesWritten) * static_cast<size_t>(numChannels),
+                  dest + static_cast<size_t>(numFrames) * static_cast<size_t>(numChannels), 0.0f);
+}
+
+NetworkAudioReceiver::Stats NetworkAudioReceiver::getStats() const
+{
+    Stats stats;
+    stats.packetsReceived = packetsReceived.load(std::memory_order_relaxed);
+    stats.packetsLost     = packetsLost.load(std::memory_order_relaxed);
+    stats.packetsLate     = packetsLate.load(std::memory_order_relaxed);
+    stats.framesConcealed = framesConcealed.load(std::memory_order_relaxed);
+    stats.lastTransitMs   = lastTransitMs.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "NetworkAudioTransport.h"
+
+//==============================================================================
+// Receiving end of the network transport, for receiver applications (and for
+// loopback testing against NetworkAudioSender on 127.0.0.1).
+//
+// A background thread pulls datagrams with recvmmsg() and drops them into a jitter
+// buffer indexed by sequence number. The playback side calls pullInterleaved() from
+// its audio callback; it starts playing once `targetDepthPackets` packets are buffered
+// and conceals lost or late packets by fading out a repeat of the last good packet.
+//==============================================================================
+class NetworkAudioReceiver : private juce::Thread
+{
+public:
+    NetworkAudioReceiver();
+    ~NetworkAudioReceiver() override;
+
+    // Binds to bindHost (resolved like the sender's destination, so an IPv6 address or
+    // name works too), or to every local address when it is empty.
+    bool start(const juce::String& bindHost, int port, int numChannels, int framesPerPacket, int targetDepthPackets);
+    void stop();
+
+    // Audio thread: fills numFrames interleaved frames. Never blocks.
+    void pullInterleaved(float* dest, int numFrames);
+
+    struct Stats
+    {
+        uint64_t packetsReceived = 0;
+        uint64_t packetsLost = 0;
+        uint64_t packetsLate = 0;
+        uint64_t framesConcealed = 0;
+        double lastTransitMs = 0.0;   // Send-to-receive time of the newest packet (same-host clocks only)
+    };
+
+    Stats getStats() const;
+
+private:
+    void run() override;
+    void storePacket(const uint8_t* datagram, int numBytes);
+    void concealPacket(float* dest);
+
+    static constexpr int NUM_SLOTS = 256;   // Power of two, must exceed the target depth
+    static constexpr int MAX_BATCH = 32;
+
+    struct Slot
+    {
+        std::atomic<uint32_t> tag { 0 };    // Extended sequence + 1 once the slot holds valid data
+        juce::HeapBlock<float> samples;
+    };
+
+    int socketFd = -1;
+    int numChannels = 0;
+    int framesPerPacket = 0;
+    int targetDepth = 0;
+
+    Slot slots[NUM_SLOTS];
+
+    // Receive thread only
+    uint32_t highestExtended = 0;
+    bool haveFirstPacket = false;
+
+    // Published by the receive thread, read by the audio thread
+    std::atomic<uint32_t> newestSequence { 0 };
+    std::atomic<uint32_t> firstSequence { 0 };
+    std::atomic<bool> streamStarted { false };
+
+    // Published by the audio thread so late packets can be discarded on arrival
+    std::atomic<uint32_t> playCursor { 0 };
+    std::atomic<bool> playbackActive { false };
+
+    // Audio thread only
+    bool playing = false;
+    uint32_t playSequence = 0;
+    int playOffset = 0;                      // Frames already consumed from currentPacket
+    int consecutiveLosses = 0;
+    juce::HeapBlock<float> currentPacket;
+    juce::HeapBlock<float> lastGoodPacket;
+
+    std::atomic<uint64_t> packetsReceived { 0 };
+    std::atomic<uint64_t> packetsLost { 0 };
+    std::atomic<uint64_t> packetsLate { 0 };
+    std::atomic<uint64_t> framesConcealed { 0 };
+    std::atomic<double> lastTransitMs { 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NetworkAudioReceiver)
+};
@@ -0,0 +1,264 @@
+#include "NetworkAudioSender.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cstring>
+
+NetworkAudioSender::NetworkAudioSender()
+    : juce::Thread("AudioSender network")
+{
+}
+
+NetworkAudioSender::~NetworkAudioSender()
+{
+    stop();
+}
+
+bool NetworkAudioSender::start(const juce::String& host, int port, double sampleRate, int channels, double packetMs)
+{
+    stop();
+
+    if (sampleRate <= 0.0 || channels <= 0 || channels > NetworkAudio::MAX_CHANNELS)
+        return false;
+
+    // Resolve the destination (numeric addresses like 127.0.0.1 resolve without a lookup)
+    addrinfo hints {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.toRawUTF8(), juce::String(port).toRawUTF8(), &hints, &result) != 0 || result == nullptr)
+    {
+        juce::Logger::writeToLog("Network transport: could not resolve " + host);
+        return false;
+    }
+
+    socketFd = socket(result->ai_family, SOCK_DGRAM, IPPROTO_UDP);
+    if (socketFd == -1)
+    {
+        juce::Logger::writeToLog("Network transport: failed to create socket: " + juce::String(strerror(errno)));
+        freeaddrinfo(result);
+        return false;
+    }
+
+    std::memcpy(&destination, result->ai_addr, result->ai_addrlen);
+    destinationLength = static_cast<socklen_t>(result->ai_addrlen);
+    freeaddrinfo(result);
+
+    int sendBufferBytes = 1 << 20;
+    setsockopt(socketFd, SOL_SOCKET, SO_SNDBUF, &sendBufferBytes, sizeof(sendBufferBytes));
+
+    numChannels = channels;
+    packetTimeMs = packetMs;
+    framesPerPacket = NetworkAudio::framesForPacketTime(packetMs, sampleRate, channels);
+
+    const int fifoFrames = juce::nextPowerOfTwo(juce::roundToInt(sampleRate * FIFO_SECONDS));
+    fifo.setTotalSize(fifoFrames);
+    fifo.reset();
+    fifoData.calloc(static_cast<size_t>(fifoFrames) * static_cast<size_t>(numChannels));
+    packetData.calloc(static_cast<size_t>(MAX_BATCH) * NetworkAudio::MAX_DATAGRAM_BYTES);
+    packetScratch.calloc(static_cast<size_t>(framesPerPacket) * static_cast<size_t>(numChannels));
+
+    gapFifo.reset();
+    framesQueued = 0;
+    unqueuedDroppedFrames = 0;
+
+    nextSequence = 0;
+    nextTimestamp = 0;
+    framesSent = 0;
+    droppedRemainder = 0;
+    ssrc = static_cast<uint32_t>(juce::Random::getSystemRandom().nextInt());
+    packetsSent.store(0);
+    droppedFrames.store(0);
+
+    running.store(true, std::memory_order_release);
+    startThread(juce::Thread::Priority::high);
+
+    juce::Logger::writeToLog("Network transport sending to " + host + ":" + juce::String(port)
+                             + " (" + juce::String(framesPerPacket) + " frames/packet)");
+    return true;
+}
+
+void NetworkAudioSender::stop()
+{
+    running.store(false, std::memory_order_release);
+    stopThread(1000);
+
+    if (socketFd != -1)
+    {
+        close(socketFd);
+        socketFd = -1;
+    }
+}
+
+template <typename SampleType>
+void NetworkAudioSender::pushBlock(const juce::AudioBuffer<SampleType>& buffer, int channels, int numSamples, float gain)
+{
+    if (!running.load(std::memory_order_acquire))
+        return;
+
+    const int framesToWrite = juce::jmin(numSamples, fifo.getFreeSpace());
+    if (framesToWrite < numSamples)
+    {
+        droppedFrames.fetch_add(static_cast<uint64_t>(numSamples - framesToWrite), std::memory_order_relaxed);
+        unqueuedDroppedFrames += static_cast<uint64_t>(numSamples - framesToWrite);
+    }
+
+    const int channelsToCopy = juce::jmin(channels, numChannels, buffer.getNumChannels());
+    const auto blockGain = static_cast<SampleType>(gain);
+    const auto scope = fifo.write(framesToWrite);
+
+    auto interleave = [&] (int fifoStart, int numFrames, int sourceOffset)
+    {
+        float* dest = fifoData.get() + static_cast<size_t>(fifoStart) * static_cast<size_t>(numChannels);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            if (channel < channelsToCopy)
+            {
+                const SampleType* source = buffer.getReadPointer(channel, sourceOffset);
+                for (int frame = 0; frame < numFrames; ++frame)
+                    dest[frame * numChannels + channel] = static_cast<float>(source[frame] * blockGain);
+            }
+            else
+            {
+                for (int frame = 0; frame < numFrames; ++frame)
+                    dest[frame * numChannels + channel] = 0.0f;
+            }
+        }
+    };
+
+    if (scope.blockSize1 > 0) interleave(scope.startIndex1, scope.blockSize1, 0);
+    if (scope.blockSize2 > 0) interleave(scope.startIndex2, scope.blockSize2, scope.blockSize1);
+
+    framesQueued += static_cast<uint64_t>(framesToWrite);
+
+    // The dropped frames are the tail of the block, so the gap sits after what was
+    // written. With gapFifo full the drop moves to a later gap; the total stays exact.
+    if (unqueuedDroppedFrames > 0 && gapFifo.getFreeSpace() > 0)
+    {
+        int start1, size1, start2, size2;
+        gapFifo.prepareToWrite(1, start1, size1, start2, size2);
+        gaps[start1] = { framesQueued, unqueuedDroppedFrames };
+        gapFifo.finishedWrite(1);
+        unqueuedDroppedFrames = 0;
+    }
+}
+
+template void NetworkAudioSender::pushBlock(const juce::AudioBuffer<float>&, int, int, float);
+template void NetworkAudioSender::pushBlock(const juce::AudioBuffer<double>&, int, int, float);
+
+void NetworkAudioSender::run()
+{
+    // Poll at half the packet time so a packet never waits more than ~half a period
+    const int pollMs = juce::jmax(1, juce::roundToInt(packetTimeMs * 0.5));
+
+    while (!threadShouldExit())
+    {
+        const int readyPackets = fifo.getNumReady() / framesPerPacket;
+
+        if (readyPackets > 0)
+            sendPackets(juce::jmin(readyPackets, MAX_BATCH));
+        else
+            wait(pollMs);
+    }
+}
+
+void NetworkAudioSender::sendPackets(int numPackets)
+{
+    const int samplesPerPacket = framesPerPacket * numChannels;
+    const int datagramBytes = NetworkAudio::HEADER_BYTES + samplesPerPacket * static_cast<int>(sizeof(float));
+
+    for (int packet = 0; packet < numPackets; ++packet)
+    {
+        skipDroppedFrames();
+
+        {
+            const auto scope = fifo.read(framesPerPacket);
+            const size_t firstSamples = static_cast<size_t>(scope.blockSize1) * static_cast<size_t>(numChannels);
+            std::memcpy(packetScratch.get(),
+                        fifoData.get() + static_cast<size_t>(scope.startIndex1) * static_cast<size_t>(numChannels),
+                        firstSamples * sizeof(float));
+            if (scope.blockSize2 > 0)
+                std::memcpy(packetScratch.get() + firstSamples,
+                            fifoData.get() + static_cast<size_t>(scope.startIndex2) * static_cast<size_t>(numChannels),
+                            static_cast<size_t>(scope.blockSize2) * static_cast<size_t>(numChannels) * sizeof(float));
+        }
+
+        NetworkAudio::PacketHeader header;
+        header.sequence    = nextSequence++;
+        header.timestamp   = nextTimestamp;
+        header.ssrc        = ssrc;
+        header.numChannels = static_cast<uint16_t>(numChannels);
+        header.numFrames   = static_cast<uint16_t>(framesPerPacket);
+        header.sendTimeNs  = NetworkAudio::monotonicNanos();
+        nextTimestamp += static_cast<uint32_t>(framesPerPacket);
+        framesSent += static_cast<uint64_t>(framesPerPacket);
+
+        uint8_t* datagram = packetData.get() + static_cast<size_t>(packet) * NetworkAudio::MAX_DATAGRAM_BYTES;
+        NetworkAudio::writeHeader(header, datagram);
+        NetworkAudio::floatsToBigEndian(packetScratch.get(), datagram + NetworkAudio::HEADER_BYTES, samplesPerPacket);
+    }
+
+   #if defined (__linux__)
+    // One syscall for the whole batch
+    mmsghdr messages[MAX_BATCH] {};
+    iovec vectors[MAX_BATCH] {};
+
+    for (int packet = 0; packet < numPackets; ++packet)
+    {
+        vectors[packet].iov_base = packetData.get() + static_cast<size_t>(packet) * NetworkAudio::MAX_DATAGRAM_BYTES;
+        vectors[packet].iov_len  = static_cast<size_t>(datagramBytes);
+        messages[packet].msg_hdr.msg_name    = &destination;
+        messages[packet].msg_hdr.msg_namelen = destinationLength;
+        messages[packet].msg_hdr.msg_iov     = &vectors[packet];
+        messages[packet].msg_hdr.msg_iovlen  = 1;
+    }
+
+    int sent = 0;
+    while (sent < numPackets)
+    {
+        const int result = sendmmsg(socketFd, messages + sent, static_cast<unsigned int>(numPackets - sent), 0);
+        if (result <= 0)
+            break;
+        sent += result;
+    }
+   #else
+    int sent = 0;
+    for (int packet = 0; packet < numPackets; ++packet)
+    {
+        const uint8_t* datagram = packetData.get() + static_cast<size_t>(packet) * NetworkAudio::MAX_DATAGRAM_BYTES;
+        if (sendto(socketFd, datagram, static_cast<size_t>(datagramBytes), 0,
+                   reinterpret_cast<const sockaddr*>(&destination), destinationLength) == datagramBytes)
+            ++sent;
+    }
+   #endif
+
+    packetsSent.fetch_add(static_cast<uint64_t>(sent), std::memory_order_relaxed);
+}
+
+void NetworkAudioSender::skipDroppedFrames()
+{
+    // A gap inside the packet about to be cut is applied at the packet's start, so the
+    // timestamp is off by less than a packet around a drop but exact after it.
+    while (gapFifo.getNumReady() > 0)
+    {
+        int start1, size1, start2, size2;
+        gapFifo.prepareToRead(1, start1, size1, start2, size2);
+        const Gap& gap = gaps[start1];
+
+        if (gap.fifoPosition >= framesSent + static_cast<uint64_t>(framesPerPacket))
+            break;
+
+        nextTimestamp += static_cast<uint32_t>(gap.frames);
+
+        // The receiver plays out one packet per sequence number, so skip as many as the
+        // dropped audio would have filled, carrying the remainder to the next gap
+        droppedRemainder += gap.frames;
+        nextSequence += static_cast<uint16_t>(droppedRemainder / static_cast<uint64_t>(framesPerPacket));
+        droppedRemainder %= static_cast<uint64_t>(framesPerPacket);
+
+        gapFifo.finishedRead(1);
+    }
+}
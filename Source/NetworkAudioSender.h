@@ -0,0 +1,88 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "NetworkAudioTransport.h"
+
+#include <sys/socket.h>
+
+//==============================================================================
+// Network transport backend, used alongside the shared memory ring.
+//
+// The audio thread only interleaves each block into a lock-free FIFO (pushBlock).
+// A background thread drains it, cuts the stream into fixed packet-time RTP packets
+// and sends them over UDP, batching several datagrams per sendmmsg() call on Linux.
+//==============================================================================
+class NetworkAudioSender : private juce::Thread
+{
+public:
+    NetworkAudioSender();
+    ~NetworkAudioSender() override;
+
+    // Opens the socket and starts the sender thread. Call from the message thread or
+    // prepareToPlay, never from processBlock.
+    bool start(const juce::String& host, int port, double sampleRate, int numChannels, double packetTimeMs);
+    void stop();
+
+    bool isRunning() const { return running.load(std::memory_order_acquire); }
+
+    // Audio thread: copies numSamples frames of the first numChannels channels, scaled
+    // by gain, into the FIFO. Never blocks or allocates; frames that don't fit are
+    // dropped and counted, and the stream skips ahead over them (see Gap).
+    template <typename SampleType>
+    void pushBlock(const juce::AudioBuffer<SampleType>& buffer, int numChannels, int numSamples, float gain = 1.0f);
+
+    uint64_t getPacketsSent() const   { return packetsSent.load(std::memory_order_relaxed); }
+    uint64_t getDroppedFrames() const { return droppedFrames.load(std::memory_order_relaxed); }
+    int getFramesPerPacket() const    { return framesPerPacket; }
+
+private:
+    void run() override;
+    void sendPackets(int numPackets);
+    void skipDroppedFrames();
+
+    static constexpr int MAX_BATCH = 32;          // Datagrams per sendmmsg() call
+    static constexpr double FIFO_SECONDS = 0.5;   // Headroom before the audio thread drops
+    static constexpr int MAX_GAPS = 64;
+
+    std::atomic<bool> running { false };
+    int socketFd = -1;
+    sockaddr_storage destination {};
+    socklen_t destinationLength = 0;
+
+    int numChannels = 0;
+    int framesPerPacket = 0;
+    double packetTimeMs = NetworkAudio::DEFAULT_PACKET_TIME_MS;
+
+    juce::AbstractFifo fifo { 1 };
+    juce::HeapBlock<float> fifoData;             // Interleaved frames, indexed by FIFO position
+
+    juce::HeapBlock<uint8_t> packetData;         // MAX_BATCH datagrams, MAX_DATAGRAM_BYTES each
+    juce::HeapBlock<float> packetScratch;        // One packet of interleaved frames
+
+    // Frames the audio thread dropped, just before the frame at fifoPosition (counted
+    // in frames ever written to the FIFO). The sender thread advances the RTP timestamp
+    // by the dropped frames and the sequence by the packets they would have filled, so
+    // a receiver sees lost packets instead of the stream silently closing up.
+    struct Gap
+    {
+        uint64_t fifoPosition = 0;
+        uint64_t frames = 0;
+    };
+
+    juce::AbstractFifo gapFifo { MAX_GAPS };
+    Gap gaps[MAX_GAPS];
+    uint64_t framesQueued = 0;                   // Audio thread only
+    uint64_t unqueuedDroppedFrames = 0;          // Audio thread only; waiting for room in gapFifo
+
+    // Sender thread only
+    uint16_t nextSequence = 0;
+    uint32_t nextTimestamp = 0;
+    uint32_t ssrc = 0;
+    uint64_t framesSent = 0;
+    uint64_t droppedRemainder = 0;               // Dropped frames short of a whole packet
+
+    std::atomic<uint64_t> packetsSent { 0 };
+    std::atomic<uint64_t> droppedFrames { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NetworkAudioSender)
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Wire format shared by NetworkAudioSender and NetworkAudioReceiver.
+//
+// Each UDP datagram is an RTP-style packet: a 12-byte RTP header (version 2, dynamic
+// payload type, 16-bit sequence number, 32-bit sample timestamp, SSRC) followed by a
+// small fixed extension and interleaved 32-bit float samples. All fields and samples
+// are big-endian.
+//==============================================================================
+namespace NetworkAudio
+{
+    static constexpr uint8_t  RTP_VERSION          = 2;
+    static constexpr uint8_t  PAYLOAD_TYPE_FLOAT32 = 96;    // First dynamic RTP payload type
+    static constexpr int      DEFAULT_PORT         = 47000;
+    static constexpr int      MAX_CHANNELS         = 64;    // Wide layouts just get fewer frames per packet
+    static constexpr int      MAX_DATAGRAM_BYTES   = 1400;  // Keep packets below a typical Ethernet MTU
+    static constexpr double   DEFAULT_PACKET_TIME_MS = 1.0;
+
+    struct PacketHeader
+    {
+        uint8_t  versionFlags = RTP_VERSION << 6;
+        uint8_t  payloadType  = PAYLOAD_TYPE_FLOAT32;
+        uint16_t sequence     = 0;    // Increments by one per packet, wraps at 2^16
+        uint32_t timestamp    = 0;    // Sample position of the first frame in the packet
+        uint32_t ssrc         = 0;    // Identifies the sending instance
+        uint16_t numChannels  = 0;
+        uint16_t numFrames    = 0;
+        uint64_t sendTimeNs   = 0;    // Sender's monotonic clock, for latency measurement
+    };
+
+    static constexpr int HEADER_BYTES = 24;
+
+    inline int maxFramesPerPacket (int numChannels)
+    {
+        return (MAX_DATAGRAM_BYTES - HEADER_BYTES) / (juce::jmax(1, numChannels) * static_cast<int>(sizeof(float)));
+    }
+
+    inline int framesForPacketTime (double packetTimeMs, double sampleRate, int numChannels)
+    {
+        const int frames = juce::roundToInt(packetTimeMs * sampleRate * 0.001);
+        return juce::jlimit(1, maxFramesPerPacket(numChannels), frames);
+    }
+
+    inline uint64_t monotonicNanos()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    inline void writeHeader (const PacketHeader& h, uint8_t* dest)
+    {
+        dest[0] = h.versionFlags;
+        dest[1] = h.payloadType;
+
+        auto put16 = [] (uint8_t* p, uint16_t v) { p[0] = uint8_t(v >> 8); p[1] = uint8_t(v); };
+        auto put32 = [] (uint8_t* p, uint32_t v) { for (int i = 0; i < 4; ++i) p[i] = uint8_t(v >> (24 - 8 * i)); };
+        auto put64 = [] (uint8_t* p, uint64_t v) { for (int i = 0; i < 8; ++i) p[i] = uint8_t(v >> (56 - 8 * i)); };
+        put16(dest + 2, h.sequence);
+        put32(dest + 4, h.timestamp);
+        put32(dest + 8, h.ssrc);
+        put16(dest + 12, h.numChannels);
+        put16(dest + 14, h.numFrames);
+        put64(dest + 16, h.sendTimeNs);
+    }
+
+    inline bool readHeader (const uint8_t* src, int numBytes, PacketHeader& h)
+    {
+        if (numBytes < HEADER_BYTES)
+            return false;
+
+        auto get16 = [] (const uint8_t* p) { return uint16_t((p[0] << 8) | p[1]); };
+        auto get32 = [] (const uint8_t* p) { uint32_t v = 0; for (int i = 0; i < 4; ++i) v = (v << 8) | p[i]; return v; };
+        auto get64 = [] (const uint8_t* p) { uint64_t v = 0; for (int i = 0; i < 8; ++i) v = (v << 8) | p[i]; return v; };
+
+        h.versionFlags = src[0];
+        h.payloadType  = src[1];
+        h.sequence     = get16(src + 2);
+        h.timestamp    = get32(src + 4);
+        h.ssrc         = get32(src + 8);
+        h.numChannels  = get16(src + 12);
+        h.numFrames    = get16(src + 14);
+        h.sendTimeNs   = get64(src + 16);
+
+        return (h.versionFlags >> 6) == RTP_VERSION
+            && h.payloadType == PAYLOAD_TYPE_FLOAT32
+            && h.numChannels > 0 && h.numChannels <= MAX_CHANNELS
+            && HEADER_BYTES + int(h.numFrames) * int(h.numChannels) * int(sizeof(float)) <= numBytes;
+    }
+
+    // Samples travel as big-endian IEEE floats.
+    inline void floatsToBigEndian (const float* src, uint8_t* dest, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, src + i, sizeof(bits));
+            bits = juce::ByteOrder::swapIfLittleEndian(bits);
+            std::memcpy(dest + i * 4, &bits, sizeof(bits));
+        }
+    }
+
+    inline void bigEndianToFloats (const uint8_t* src, float* dest, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, src + i * 4, sizeof(bits));
+            bits = juce::ByteOrder::swapIfLittleEndian(bits);
+            std::memcpy(dest + i, &bits, sizeof(bits));
+        }
+    }
+}
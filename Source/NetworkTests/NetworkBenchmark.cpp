@@ -0,0 +1,159 @@
+#include <JuceHeader.h>
+#include "NetworkAudioSender.h"
+#include "NetworkAudioReceiver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+//==============================================================================
+// Network transport benchmark over 127.0.0.1, NetworkAudioSender to NetworkAudioReceiver.
+//
+// Throughput: pushes audio as fast as the sender's FIFO takes it and reports how much
+// the sender thread gets onto the wire. Latency: pushes in real time, 256-frame blocks
+// at 48 kHz, while the receiver plays out, and reports the send-to-receive transit of
+// the packets (both ends share the monotonic clock) plus losses and concealment.
+//
+// Usage: NetworkBenchmark [channels] [seconds]
+//==============================================================================
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockFrames = 256;
+
+    using Clock = std::chrono::steady_clock;
+
+    // Two blocks of packets: one callback's worth in flight plus one of margin
+    int jitterDepthPackets (int framesPerPacket)
+    {
+        return 2 * blockFrames / framesPerPacket + 1;
+    }
+
+    int benchmarkPort()
+    {
+        return NetworkAudio::DEFAULT_PORT + 700;
+    }
+
+    void fillNoise (juce::AudioBuffer<float>& buffer, juce::Random& random)
+    {
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            for (int frame = 0; frame < buffer.getNumSamples(); ++frame)
+                buffer.getWritePointer(channel)[frame] = random.nextFloat() * 2.0f - 1.0f;
+    }
+
+    bool runThroughput (int numChannels, double seconds)
+    {
+        NetworkAudioSender sender;
+        NetworkAudioReceiver receiver;
+        if (!sender.start("127.0.0.1", benchmarkPort(), sampleRate, numChannels, NetworkAudio::DEFAULT_PACKET_TIME_MS)
+            || !receiver.start("127.0.0.1", benchmarkPort(), numChannels, sender.getFramesPerPacket(), jitterDepthPackets(sender.getFramesPerPacket())))
+            return false;
+
+        juce::Random random(1);
+        juce::AudioBuffer<float> block(numChannels, blockFrames);
+        fillNoise(block, random);
+
+        const auto totalFrames = static_cast<uint64_t>(seconds * sampleRate);
+        uint64_t pushed = 0;
+        const auto start = Clock::now();
+
+        // Only offer what fits, so nothing is dropped and the rate is the sender thread's
+        while (pushed < totalFrames)
+        {
+            if (pushed - sender.getPacketsSent() * static_cast<uint64_t>(sender.getFramesPerPacket()) < static_cast<uint64_t>(sampleRate * 0.25))
+            {
+                sender.pushBlock(block, numChannels, blockFrames);
+                pushed += blockFrames;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        const auto expectedPackets = pushed / static_cast<uint64_t>(sender.getFramesPerPacket());
+        while (sender.getPacketsSent() < expectedPackets && Clock::now() - start < std::chrono::seconds(30))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));   // Let the last datagrams land
+
+        const auto packets = sender.getPacketsSent();
+        const auto received = receiver.getStats().packetsReceived;
+        const double framesPerSecond = static_cast<double>(packets * static_cast<uint64_t>(sender.getFramesPerPacket())) / elapsed;
+        const double payloadBits = framesPerSecond * numChannels * sizeof(float) * 8.0;
+
+        std::printf("throughput: %d ch, %d frames/packet: %.0f packets/s, %.1f Mbit/s payload, %.1fx real time, "
+                    "%llu/%llu packets received, %llu frames dropped\n",
+                    numChannels, sender.getFramesPerPacket(), static_cast<double>(packets) / elapsed, payloadBits * 1.0e-6,
+                    framesPerSecond / sampleRate, static_cast<unsigned long long>(received),
+                    static_cast<unsigned long long>(packets), static_cast<unsigned long long>(sender.getDroppedFrames()));
+        return true;
+    }
+
+    bool runLatency (int numChannels, double seconds)
+    {
+        NetworkAudioSender sender;
+        NetworkAudioReceiver receiver;
+        if (!sender.start("127.0.0.1", benchmarkPort() + 1, sampleRate, numChannels, NetworkAudio::DEFAULT_PACKET_TIME_MS)
+            || !receiver.start("127.0.0.1", benchmarkPort() + 1, numChannels, sender.getFramesPerPacket(), jitterDepthPackets(sender.getFramesPerPacket())))
+            return false;
+
+        juce::Random random(2);
+        juce::AudioBuffer<float> block(numChannels, blockFrames);
+        std::vector<float> pulled(static_cast<size_t>(blockFrames * numChannels));
+        std::vector<double> transitMs;
+
+        const auto blockPeriod = std::chrono::duration<double>(blockFrames / sampleRate);
+        const auto numBlocks = static_cast<int>(seconds * sampleRate / blockFrames);
+        const auto start = Clock::now();
+
+        // Both ends on one thread, one block period apart, like a host callback and a
+        // receiver callback running at the same rate
+        for (int index = 0; index < numBlocks; ++index)
+        {
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(blockPeriod * index));
+
+            fillNoise(block, random);
+            sender.pushBlock(block, numChannels, blockFrames);
+            receiver.pullInterleaved(pulled.data(), blockFrames);
+
+            const double transit = receiver.getStats().lastTransitMs;
+            if (transit > 0.0)
+                transitMs.push_back(transit);
+        }
+
+        const auto stats = receiver.getStats();
+        std::sort(transitMs.begin(), transitMs.end());
+
+        auto percentile = [&] (double fraction)
+        {
+            return transitMs.empty() ? 0.0 : transitMs[static_cast<size_t>(fraction * static_cast<double>(transitMs.size() - 1))];
+        };
+
+        std::printf("latency: %d ch, %d blocks: transit p50 %.3f ms, p99 %.3f ms, max %.3f ms; jitter buffer %.2f ms; "
+                    "%llu lost, %llu late, %llu frames concealed\n",
+                    numChannels, numBlocks, percentile(0.5), percentile(0.99), percentile(1.0),
+                    jitterDepthPackets(sender.getFramesPerPacket()) * sender.getFramesPerPacket() * 1000.0 / sampleRate,
+                    static_cast<unsigned long long>(stats.packetsLost), static_cast<unsigned long long>(stats.packetsLate),
+                    static_cast<unsigned long long>(stats.framesConcealed));
+        return true;
+    }
+}
+
+int main (int argc, char** argv)
+{
+    const int numChannels = juce::jlimit(1, NetworkAudio::MAX_CHANNELS, argc > 1 ? std::atoi(argv[1]) : 2);
+    const double seconds = juce::jlimit(0.1, 600.0, argc > 2 ? std::atof(argv[2]) : 5.0);
+
+    if (!runThroughput(numChannels, seconds) || !runLatency(numChannels, seconds))
+    {
+        std::fprintf(stderr, "NetworkBenchmark: could not open the loopback sockets\n");
+        return 1;
+    }
+
+    return 0;
+}
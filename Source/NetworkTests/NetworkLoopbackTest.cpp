@@ -0,0 +1,229 @@
+#include <JuceHeader.h>
+#include "NetworkAudioSender.h"
+#include "NetworkAudioReceiver.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+//==============================================================================
+// Loopback test for the network transport: NetworkAudioSender to NetworkAudioReceiver
+// over 127.0.0.1 and ::1, checking that every frame comes out in order, and to a raw
+// socket, checking that RTP sequence numbers and timestamps skip over frames the
+// sender's FIFO dropped.
+//==============================================================================
+namespace
+{
+    int failures = 0;
+
+    #define EXPECT(condition) \
+        do { if (!(condition)) { std::fprintf(stderr, "%s:%d: EXPECT(%s) failed\n", __FILE__, __LINE__, #condition); ++failures; } } while (false)
+
+    constexpr double sampleRate = 48000.0;
+    constexpr int numChannels = 2;
+    constexpr int blockFrames = 480;
+
+    // Channel 0 carries the frame's stream position, channel 1 its negation
+    void fillRamp (juce::AudioBuffer<float>& buffer, int position)
+    {
+        for (int frame = 0; frame < buffer.getNumSamples(); ++frame)
+        {
+            buffer.getWritePointer(0)[frame] = static_cast<float>(position + frame);
+            buffer.getWritePointer(1)[frame] = -static_cast<float>(position + frame);
+        }
+    }
+
+    int testPort()
+    {
+        return NetworkAudio::DEFAULT_PORT + 100 + static_cast<int>(getpid() % 500);
+    }
+
+    template <typename Condition>
+    bool waitFor (Condition condition, int timeoutMs = 2000)
+    {
+        for (int elapsed = 0; elapsed < timeoutMs; ++elapsed)
+        {
+            if (condition())
+                return true;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return condition();
+    }
+
+    // Sender and receiver in lockstep, so the jitter buffer never runs dry or overflows
+    void testReceiverLoopback (const juce::String& host, bool required)
+    {
+        const int port = testPort();
+
+        NetworkAudioSender sender;
+        NetworkAudioReceiver receiver;
+
+        if (!sender.start(host, port, sampleRate, numChannels, NetworkAudio::DEFAULT_PACKET_TIME_MS)
+            || !receiver.start(host, port, numChannels, sender.getFramesPerPacket(), 16))
+        {
+            // Some machines (and containers) have no IPv6 loopback
+            EXPECT(!required);
+            std::printf("  %s: no socket for this address family here, skipped\n", host.toRawUTF8());
+            return;
+        }
+
+        const int framesPerPacket = sender.getFramesPerPacket();
+        const int packetsPerBlock = blockFrames / framesPerPacket;
+
+        juce::AudioBuffer<float> block(numChannels, blockFrames);
+        std::vector<float> pulled(static_cast<size_t>(blockFrames * numChannels));
+
+        int pushed = 0;
+        for (int primed = 0; primed < 2; ++primed, pushed += blockFrames)
+        {
+            fillRamp(block, pushed);
+            sender.pushBlock(block, numChannels, blockFrames);
+        }
+
+        float expected = -1.0f;
+        bool continuous = true;
+
+        for (int round = 0; round < 100; ++round)
+        {
+            const auto packets = static_cast<uint64_t>(pushed / framesPerPacket);
+            EXPECT(waitFor([&] { return receiver.getStats().packetsReceived >= packets; }));
+
+            receiver.pullInterleaved(pulled.data(), blockFrames);
+
+            for (int frame = 0; frame < blockFrames; ++frame)
+            {
+                const float left = pulled[static_cast<size_t>(frame * numChannels)];
+                const float right = pulled[static_cast<size_t>(frame * numChannels + 1)];
+
+                // Playback starts somewhere in the primed packets, then must not skip
+                if (expected >= 0.0f && left != expected)
+                    continuous = false;
+
+                continuous = continuous && right == -left;
+                expected = left + 1.0f;
+            }
+
+            fillRamp(block, pushed);
+            sender.pushBlock(block, numChannels, blockFrames);
+            pushed += blockFrames;
+        }
+
+        const auto stats = receiver.getStats();
+        EXPECT(continuous);
+        EXPECT(stats.packetsLost == 0);
+        EXPECT(stats.packetsLate == 0);
+        EXPECT(stats.framesConcealed == 0);
+        EXPECT(sender.getDroppedFrames() == 0);
+        EXPECT(stats.packetsReceived >= static_cast<uint64_t>(100 * packetsPerBlock));
+
+        std::printf("  %s: %llu packets, transit %.3f ms\n", host.toRawUTF8(),
+                    static_cast<unsigned long long>(stats.packetsReceived), stats.lastTransitMs);
+    }
+
+    // Overflows the sender's FIFO in one block, then reads the packets off a raw socket.
+    // A low rate and long packets keep the FIFO, and so the burst, within the default
+    // socket receive buffer.
+    void testDroppedFramesAdvanceRtp()
+    {
+        constexpr double lowRate = 8000.0;
+        constexpr double packetMs = 10.0;
+
+        const int port = testPort() + 1;
+
+        const int listener = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        int receiveBufferBytes = 4 << 20;
+        setsockopt(listener, SOL_SOCKET, SO_RCVBUF, &receiveBufferBytes, sizeof(receiveBufferBytes));
+        timeval timeout { 0, 200000 };
+        setsockopt(listener, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        EXPECT(bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+
+        NetworkAudioSender sender;
+        EXPECT(sender.start("127.0.0.1", port, lowRate, numChannels, packetMs));
+        const int framesPerPacket = sender.getFramesPerPacket();
+
+        // More than the FIFO holds: the tail of the block is dropped
+        juce::AudioBuffer<float> overflow(numChannels, 6000);
+        fillRamp(overflow, 0);
+        sender.pushBlock(overflow, numChannels, overflow.getNumSamples());
+
+        const auto dropped = sender.getDroppedFrames();
+        EXPECT(dropped > 0);
+
+        // Once the FIFO has drained, the stream continues after the gap without dropping again
+        const auto queuedBeforeGap = static_cast<uint64_t>(overflow.getNumSamples()) - dropped;
+        EXPECT(waitFor([&] { return sender.getPacketsSent() >= queuedBeforeGap / static_cast<uint64_t>(framesPerPacket); }));
+
+        juce::AudioBuffer<float> after(numChannels, 800);
+        fillRamp(after, overflow.getNumSamples());
+        sender.pushBlock(after, numChannels, after.getNumSamples());
+        EXPECT(sender.getDroppedFrames() == dropped);
+
+        const auto queued = static_cast<uint64_t>(overflow.getNumSamples() + after.getNumSamples()) - dropped;
+        const auto expectedPackets = queued / static_cast<uint64_t>(framesPerPacket);
+
+        std::vector<NetworkAudio::PacketHeader> headers;
+        std::vector<float> firstSamples;
+        uint8_t datagram[NetworkAudio::MAX_DATAGRAM_BYTES];
+
+        while (headers.size() < expectedPackets)
+        {
+            const auto received = recv(listener, datagram, sizeof(datagram), 0);
+            if (received <= 0)
+                break;
+
+            NetworkAudio::PacketHeader header;
+            EXPECT(NetworkAudio::readHeader(datagram, static_cast<int>(received), header));
+
+            float first = 0.0f;
+            NetworkAudio::bigEndianToFloats(datagram + NetworkAudio::HEADER_BYTES, &first, 1);
+            headers.push_back(header);
+            firstSamples.push_back(first);
+        }
+
+        sender.stop();
+        close(listener);
+
+        EXPECT(headers.size() == expectedPackets);
+        if (headers.empty())
+            return;
+
+        // The stream position the audio says against the one the header says: they only
+        // disagree in the packet the gap fell into
+        int mismatched = 0;
+        for (size_t packet = 0; packet < headers.size(); ++packet)
+            if (static_cast<uint32_t>(firstSamples[packet]) != headers[packet].timestamp - headers.front().timestamp)
+                ++mismatched;
+
+        EXPECT(mismatched <= 1);
+
+        // Timestamps cover the dropped frames exactly, sequence numbers the whole packets they would have filled
+        const auto& last = headers.back();
+        const auto packetFrames = static_cast<uint64_t>(framesPerPacket);
+        const auto sentPackets = static_cast<uint64_t>(headers.size() - 1);
+        EXPECT(last.timestamp - headers.front().timestamp == sentPackets * packetFrames + dropped);
+        EXPECT(static_cast<uint16_t>(last.sequence - headers.front().sequence) == static_cast<uint16_t>(sentPackets + dropped / packetFrames));
+
+        std::printf("  dropped %llu frames: %zu packets, sequence skipped %llu\n", static_cast<unsigned long long>(dropped),
+                    headers.size(), static_cast<unsigned long long>(dropped / packetFrames));
+    }
+}
+
+int main()
+{
+    testReceiverLoopback("127.0.0.1", true);
+    testReceiverLoopback("::1", false);
+    testDroppedFramesAdvanceRtp();
+
+    std::printf("NetworkLoopbackTest: %s (%d failed checks)\n", failures == 0 ? "passed" : "FAILED", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -4,8 +4,12 @@
 
 //==============================================================================
 SlaveAudioSenderAudioProcessorEditor::SlaveAudioSenderAudioProcessorEditor (SlaveAudioSenderAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), audioProcessor (p),
+      vBlankAttachment (this, [this] { updateFromProcessor(); })
 {
+    // paint() covers every pixel, so children repainting don't drag in anything behind us
+    setOpaque(true);
+
     //Monitor button:
     monitorButton.setButtonText("Monitor");
     monitorButton.setTooltip("Enable to monitor audio in sender DAW");
@@ -25,24 +29,54 @@ SlaveAudioSenderAudioProcessorEditor::SlaveAudioSenderAudioProcessorEditor (Slav
     statusLabel.setText("Checking connection...", juce::dontSendNotification);
     statusLabel.setColour(juce::Label::textColourId, juce::Colours::white);
 
-    
-    // Start timer for updating the meter
-    startTimerHz(24);
-    
+    // Diagnostics toggle; the panel itself is only added while it's open
+    diagnosticsButton.setButtonText("Diagnostics");
+    diagnosticsButton.setTooltip("Show ring fill, latency, overruns and callback timing");
+    diagnosticsButton.setClickingTogglesState(true);
+    diagnosticsButton.onClick = [this] { setDiagnosticsVisible(diagnosticsButton.getToggleState()); };
+    addAndMakeVisible(diagnosticsButton);
+    addChildComponent(diagnosticsPanel);
+
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (400, 300);
+    setSize (MAIN_WIDTH, MAIN_HEIGHT);
 }
 
 SlaveAudioSenderAudioProcessorEditor::~SlaveAudioSenderAudioProcessorEditor()
 {
-    stopTimer();
     meterFader.removeListener(this);
 }
 
 //==============================================================================
 void SlaveAudioSenderAudioProcessorEditor::paint (juce::Graphics& g)
 {
+    // Usually just a blit of the dirty region; the cache is only re-rendered after a
+    // resize or when the editor moves to a display with a different pixel scale
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (backgroundCache.isNull() || scale != backgroundCacheScale)
+        renderBackgroundCache(scale);
+
+    g.drawImage(backgroundCache, getLocalBounds().toFloat());
+}
+
+void SlaveAudioSenderAudioProcessorEditor::setDiagnosticsVisible (bool shouldBeVisible)
+{
+    diagnosticsPanel.setVisible(shouldBeVisible);
+    lastDiagnosticsUpdateMs = 0.0;
+    setSize(MAIN_WIDTH, shouldBeVisible ? MAIN_HEIGHT + DIAGNOSTICS_HEIGHT : MAIN_HEIGHT);
+}
+
+void SlaveAudioSenderAudioProcessorEditor::renderBackgroundCache (float scale)
+{
+    backgroundCacheScale = scale;
+    backgroundCache = juce::Image(juce::Image::RGB,
+                                  juce::jmax(1, juce::roundToInt(static_cast<float>(getWidth()) * scale)),
+                                  juce::jmax(1, juce::roundToInt(static_cast<float>(getHeight()) * scale)),
+                                  false);
+
+    juce::Graphics g(backgroundCache);
+    g.addTransform(juce::AffineTransform::scale(scale));
+
     // Gradient background (black to dark grey)
     juce::ColourGradient backgroundGradient(
         juce::Colour::fromRGB(30, 30, 30), // Top color
@@ -58,7 +92,7 @@ void SlaveAudioSenderAudioProcessorEditor::paint (juce::Graphics& g)
     // Title Text (centered at top)
     g.setColour(juce::Colours::goldenrod);
     g.setFont(juce::Font(18.0f, juce::Font::bold));
-    juce::Rectangle<int> titleArea = getLocalBounds().removeFromTop(40).reduced(0, 10);
+    juce::Rectangle<int> titleArea = getMainArea().removeFromTop(40).reduced(0, 10);
     g.drawFittedText("Audio Sender Plugin", titleArea, juce::Justification::centred, 1);
 
     // ===============================
@@ -77,7 +111,7 @@ void SlaveAudioSenderAudioProcessorEditor::paint (juce::Graphics& g)
     g.setFont(juce::Font(12.0f));
     g.setColour(juce::Colours::goldenrod);
 
-    auto bounds = getLocalBounds().reduced(10);
+    auto bounds = getMainArea().reduced(10);
     auto footerArea = bounds.removeFromBottom(30);
 
     juce::Rectangle<int> line1 = footerArea.removeFromTop(15);
@@ -90,7 +124,12 @@ void SlaveAudioSenderAudioProcessorEditor::paint (juce::Graphics& g)
 
 void SlaveAudioSenderAudioProcessorEditor::resized()
 {
-    auto area = getLocalBounds().reduced(10);
+    backgroundCache = {};
+
+    diagnosticsPanel.setBounds(getLocalBounds().withTrimmedTop(MAIN_HEIGHT));
+
+    const auto mainArea = getMainArea();
+    auto area = mainArea.reduced(10);
 
     // Reserve space for footer
     auto footerArea = area.removeFromBottom(30);
@@ -105,20 +144,23 @@ void SlaveAudioSenderAudioProcessorEditor::resized()
     int buttonWidth = 150;
     int buttonHeight = 24;
     monitorButton.setBounds(
-        (getWidth() - buttonWidth) / 2,
-        (getHeight() - buttonHeight) / 2,
+        (mainArea.getWidth() - buttonWidth) / 2,
+        (mainArea.getHeight() - buttonHeight) / 2,
         buttonWidth,
         buttonHeight
     );
 
+    // ===== Diagnostics toggle (bottom-left, mirroring the meter) =====
+    diagnosticsButton.setBounds(10, mainArea.getHeight() - 24 - 30 - 10, 90, 24);
+
     // ===== Meter/Fader in Bottom-Right =====
     int meterWidth = 70;
     int meterHeight = 110;
     int padding = 10;
 
     meterFader.setBounds(
-        getWidth() - meterWidth - padding,
-        getHeight() - meterHeight - 30 - padding, // keep it above the footer
+        mainArea.getWidth() - meterWidth - padding,
+        mainArea.getHeight() - meterHeight - 30 - padding, // keep it above the footer
         meterWidth,
         meterHeight
     );
@@ -135,14 +177,36 @@ void SlaveAudioSenderAudioProcessorEditor::sliderValueChanged(juce::Slider* slid
     }
 }
 
-void SlaveAudioSenderAudioProcessorEditor::timerCallback()
+void SlaveAudioSenderAudioProcessorEditor::updateFromProcessor()
 {
-    // Meter update
+    // Meter update (the meter repaints only its own bounds)
     float currentLevel = audioProcessor.getCurrentLevel();
-    meterFader.setLevel(currentLevel);
+    if (std::abs(currentLevel - lastMeterLevel) >= METER_EPSILON_DB)
+    {
+        lastMeterLevel = currentLevel;
+        meterFader.setLevel(currentLevel);
+    }
+
+    // Diagnostics refresh at a fixed low rate, and only while the panel is open
+    if (diagnosticsPanel.isVisible())
+    {
+        const double nowMs = juce::Time::getMillisecondCounterHiRes();
+        if (nowMs - lastDiagnosticsUpdateMs >= DIAGNOSTICS_INTERVAL_MS)
+        {
+            lastDiagnosticsUpdateMs = nowMs;
+            audioProcessor.getDiagnostics(diagnosticsSnapshot);
+            diagnosticsPanel.update(diagnosticsSnapshot, nowMs);
+        }
+    }
 
     // Connection status update
-    if (audioProcessor.isMemoryInitializedAndActive())
+    const int connectionState = audioProcessor.isMemoryInitializedAndActive() ? 1 : 0;
+    if (connectionState == lastConnectionState)
+        return;
+
+    lastConnectionState = connectionState;
+
+    if (connectionState == 1)
     {
         statusLabel.setText("Connected to AudioReceiver", juce::dontSendNotification);
         statusLabel.setColour(juce::Label::textColourId, juce::Colours::lime);
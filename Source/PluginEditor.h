@@ -3,10 +3,10 @@
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
 #include "AudioMeterFader.h"
+#include "DiagnosticsPanel.h"
 
 class SlaveAudioSenderAudioProcessorEditor : public juce::AudioProcessorEditor,
-                                          private juce::Slider::Listener,
-                                          private juce::Timer
+                                          private juce::Slider::Listener
 {
 public:
     SlaveAudioSenderAudioProcessorEditor (SlaveAudioSenderAudioProcessor&);
@@ -18,12 +18,32 @@ public:
     
     // Slider::Listener implementation
     void sliderValueChanged(juce::Slider* slider) override;
-    
-    // Timer callback to update the meter
-    void timerCallback() override;
 
 private:
 
+    // Called once per display refresh; only pushes the meter level and connection
+    // status when they have actually changed, so idle editors cost next to nothing
+    void updateFromProcessor();
+
+    // The gradient, title and footer never change between resizes, so they're
+    // rendered once into an image (at the display's pixel scale) and blitted in paint()
+    void renderBackgroundCache(float scale);
+    juce::Image backgroundCache;
+    float backgroundCacheScale = 0.0f;
+
+    // Meter changes smaller than this aren't visible, so they don't trigger a repaint
+    static constexpr float METER_EPSILON_DB = 0.1f;
+    float lastMeterLevel = -1000.0f;
+    int lastConnectionState = -1;   // -1 = not checked yet, 0 = not connected, 1 = connected
+
+    // Main controls area; the diagnostics panel (when open) extends the editor below it
+    static constexpr int MAIN_WIDTH = 400;
+    static constexpr int MAIN_HEIGHT = 300;
+    static constexpr int DIAGNOSTICS_HEIGHT = 220;
+    static constexpr double DIAGNOSTICS_INTERVAL_MS = 100.0;
+    juce::Rectangle<int> getMainArea() const { return getLocalBounds().removeFromTop(MAIN_HEIGHT); }
+    void setDiagnosticsVisible(bool shouldBeVisible);
+
     SlaveAudioSenderAudioProcessor& audioProcessor;
     
     // Monitor button (keep your existing control)
@@ -36,5 +56,14 @@ private:
     // Connection status label
     juce::Label statusLabel;
 
+    // Collapsible transport diagnostics
+    juce::TextButton diagnosticsButton;
+    DiagnosticsPanel diagnosticsPanel;
+    TransportDiagnosticsSnapshot diagnosticsSnapshot;
+    double lastDiagnosticsUpdateMs = 0.0;
+
+    // Declared last so it's detached before anything its callback touches is destroyed
+    juce::VBlankAttachment vBlankAttachment;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SlaveAudioSenderAudioProcessorEditor)
 };
@@ -1,12 +1,18 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
-#include "AudioLevelUtils.h"
+#include "Transport/SharedMemoryWait.h"
+#include "RingWriteKernels.h"
 
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #include <cstring>
+#include <cmath>
+
+#if defined (__linux__)
+ #include <sys/eventfd.h>
+#endif
 
 
 SlaveAudioSenderAudioProcessor::SlaveAudioSenderAudioProcessor()
@@ -30,6 +36,17 @@ parameters (*this, nullptr, "PARAMETERS", {
         juce::ParameterID("monitor", 1), //<-- jassert error fix
         "Monitor",
         false
+    ),
+    std::make_unique<juce::AudioParameterBool>(
+        juce::ParameterID("returnPath", 1),
+        "Return Path",
+        false
+    ),
+    std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("returnUnderrun", 1),
+        "Return Underrun",
+        juce::StringArray { "Silence", "Hold Last", "Dry Input" },
+        0
     )
 })
 #endif
@@ -42,55 +59,116 @@ parameters (*this, nullptr, "PARAMETERS", {
             DBG("Monitor parameter is NULL! Crash incoming.");
         else
             DBG("Monitor parameter connected.");
+
+        returnPathParameter = parameters.getRawParameterValue("returnPath");
+        returnUnderrunParameter = parameters.getRawParameterValue("returnUnderrun");
 }
 
 bool SlaveAudioSenderAudioProcessor::initializeSharedMemory()
 {
+    // The extension overlays the legacy arrays, so nothing still in use may follow them
+   #define AUDIOSENDER_FIELD_END(field) (offsetof(SharedAudioData, field) + sizeof(SharedAudioData::field))
+    static_assert (std::max({ AUDIOSENDER_FIELD_END(writeIndex), AUDIOSENDER_FIELD_END(readIndex), AUDIOSENDER_FIELD_END(isActive),
+                              AUDIOSENDER_FIELD_END(sampleRate), AUDIOSENDER_FIELD_END(numChannels), AUDIOSENDER_FIELD_END(bufferSize),
+                              AUDIOSENDER_FIELD_END(maxBufferSize), AUDIOSENDER_FIELD_END(preferredBufferSize),
+                              AUDIOSENDER_FIELD_END(configurationCounter), AUDIOSENDER_FIELD_END(sequenceCounter),
+                              AUDIOSENDER_FIELD_END(targetLatency), AUDIOSENDER_FIELD_END(adaptiveBuffering),
+                              AUDIOSENDER_FIELD_END(metrics) }) <= LEGACY_ARRAYS_OFFSET,
+                   "A SharedAudioData field the plugin uses lies inside the extension");
+   #undef AUDIOSENDER_FIELD_END
+
     // Clean up any existing resources first
     cleanupSharedMemory();
 
-    // First try to unlink any existing shared memory with this name
-    // This helps if a previous instance crashed without cleanup
-    shm_unlink(SHARED_MEMORY_NAME);
+    anonymousRequested = static_cast<bool>(parameters.state.getProperty("anonymousSegment", false));
+    requestedSocketPath = parameters.state.getProperty("handshakeSocketPath").toString();
+    anonymousSegment = false;
+
+   #if defined (__linux__)
+    if (anonymousRequested)
+    {
+        // Listen before creating anything, so a socket name that's taken falls back to the
+        // named segment instead of leaving a segment nobody can reach
+        static std::atomic<int> instanceCounter { 0 };
+        handshakePath = requestedSocketPath.isNotEmpty()
+                            ? requestedSocketPath
+                            : "@audiosender-" + juce::String(static_cast<int>(getpid())) + "-" + juce::String(++instanceCounter);
+
+        anonymousSegment = segmentHandshake.start(handshakePath);
+        if (anonymousSegment)
+            shm_fd = memfd_create("audiosender", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        else
+            juce::Logger::writeToLog("Anonymous segment unavailable, using " + juce::String(SHARED_MEMORY_NAME));
+    }
+   #else
+    if (anonymousRequested)
+        juce::Logger::writeToLog("Anonymous segments need Linux, using " + juce::String(SHARED_MEMORY_NAME));
+   #endif
+
+    if (!anonymousSegment)
+    {
+        // First try to unlink any existing shared memory with this name
+        // This helps if a previous instance crashed without cleanup
+        shm_unlink(SHARED_MEMORY_NAME);
 
-    // Create or open shared memory
-    shm_fd = shm_open(SHARED_MEMORY_NAME, O_CREAT | O_RDWR, 0666);
+        // Create or open shared memory
+        shm_fd = shm_open(SHARED_MEMORY_NAME, O_CREAT | O_RDWR, 0666);
+    }
 
     if (shm_fd == -1)
     {
         juce::Logger::writeToLog("Failed to create shared memory: " + juce::String(strerror(errno)));
+        segmentHandshake.stop();
         return false;
     }
 
+    // Size the segment for the negotiated format up front (some platforms only allow
+    // a shared memory object to be sized once)
+    transportFloat64 = static_cast<bool>(parameters.state.getProperty("transportFloat64", false));
+    diagnostics.float64.store(transportFloat64, std::memory_order_relaxed);
+    const auto layout = computeRingLayout(currentNumChannels, currentSampleRate, currentBlockSize);
+
     // Set the size of the shared memory segment
-    if (ftruncate(shm_fd, MAX_BUFFER_SIZE) == -1)
+    if (ftruncate(shm_fd, static_cast<off_t>(layout.segment_bytes)) == -1)
     {
         juce::Logger::writeToLog("Failed to set shared memory size: " + juce::String(strerror(errno)));
         close(shm_fd);
         shm_fd = -1;
+        segmentHandshake.stop();
         return false;
     }
 
     // Map the shared memory into our address space
-    void* mappedMemory = mmap(0, MAX_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    void* mappedMemory = mmap(0, layout.segment_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
 
     if (mappedMemory == MAP_FAILED)
     {
         juce::Logger::writeToLog("Failed to map shared memory: " + juce::String(strerror(errno)));
         close(shm_fd);
         shm_fd = -1;
+        segmentHandshake.stop();
         return false;
     }
 
+   #if defined (__linux__)
+    // Receivers map the memfd at its current size, so it may grow (growSegment) but never
+    // shrink under them, and nobody can lift that later
+    if (anonymousSegment && fcntl(shm_fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_SEAL) == -1)
+        juce::Logger::writeToLog("Failed to seal the anonymous segment: " + juce::String(strerror(errno)));
+   #endif
+
     // Cast to shared data structure
     sharedData = static_cast<SharedAudioData*>(mappedMemory);
+    segmentBytes = static_cast<size_t>(layout.segment_bytes);
 
     // Initialize the shared memory structure with default values
     new (&sharedData->writeIndex) std::atomic<uint64_t>(0);
     new (&sharedData->readIndex) std::atomic<uint64_t>(0);
     new (&sharedData->isActive) std::atomic<bool>(true);
-    new (&sharedData->numChannels) std::atomic<int>(currentNumChannels);
-    new (&sharedData->bufferSize) std::atomic<int>(currentBlockSize);
+    // Legacy receivers would read audioData/blockHeaders, which no longer carry audio:
+    // zero channels and frames tells them there is nothing to read
+    new (&sharedData->numChannels) std::atomic<int>(0);
+    new (&sharedData->bufferSize) std::atomic<int>(0);
     new (&sharedData->sampleRate) std::atomic<double>(currentSampleRate);
     new (&sharedData->sequenceCounter) std::atomic<uint64_t>(0);
     new (&sharedData->maxBufferSize) std::atomic<int>(currentBlockSize);
@@ -104,16 +182,103 @@ bool SlaveAudioSenderAudioProcessor::initializeSharedMemory()
     new (&sharedData->metrics.bufferOverruns) std::atomic<uint64_t>(0);
     new (&sharedData->metrics.bufferUnderruns) std::atomic<uint64_t>(0);
 
-    // Clear the entire ring buffer
-    std::memset(sharedData->audioData, 0,
-               SharedAudioData::RING_BUFFER_SIZE * 10 * sizeof(float));
+    // Initialize the extension block that follows SharedAudioData
+    extension = reinterpret_cast<SharedSegmentExtension*>(static_cast<char*>(mappedMemory) + EXTENSION_OFFSET);
+    new (&extension->offlineMode) std::atomic<uint32_t>(isNonRealtime() ? 1 : 0);
+    new (&extension->readerNotify) std::atomic<uint32_t>(0);
+    new (&extension->writerNotify) std::atomic<uint32_t>(0);
+    new (&extension->reserved0) std::atomic<uint32_t>(0);
+    new (&extension->offlineWaits) std::atomic<uint64_t>(0);
+    new (&extension->offlineTimeouts) std::atomic<uint64_t>(0);
+    new (&extension->sampleFormat) std::atomic<uint32_t>(0);
+    new (&extension->ringStride) std::atomic<uint32_t>(0);
+    new (&extension->ringCapacityFrames) std::atomic<uint64_t>(0);
+    new (&extension->ringHeadersOffset) std::atomic<uint64_t>(0);
+    new (&extension->ringDataOffset) std::atomic<uint64_t>(0);
+    new (&extension->segmentBytes) std::atomic<uint64_t>(segmentBytes);
+    new (&extension->ringGeneration) std::atomic<uint64_t>(0);
+    new (&extension->channelMapSize) std::atomic<uint32_t>(0);
+    new (&extension->snapshotLatest) std::atomic<uint32_t>(0);
+    new (&extension->snapshotsPublished) std::atomic<uint64_t>(0);
+    for (auto& slot : extension->snapshots)
+        new (&slot.sequence) std::atomic<uint64_t>(0);
+    ringCapacity = 0;
+    diagnostics.ringCapacity.store(0, std::memory_order_relaxed);
+    new (&extension->eventWriteIndex) std::atomic<uint64_t>(0);
+    new (&extension->eventReadIndex) std::atomic<uint64_t>(0);
+    new (&extension->eventOverruns) std::atomic<uint64_t>(0);
+    std::memset(extension->events, 0, sizeof(extension->events));
+    lastTransportValid = false;
+
+    new (&extension->returnWriteIndex) std::atomic<uint64_t>(0);
+    new (&extension->returnNumChannels) std::atomic<uint32_t>(0);
+    new (&extension->returnActive) std::atomic<uint32_t>(0);
+    new (&extension->returnReadIndex) std::atomic<uint64_t>(0);
+    new (&extension->returnUnderruns) std::atomic<uint64_t>(0);
+    new (&extension->returnLatencyFrames) std::atomic<uint64_t>(0);
+    std::memset(extension->returnData, 0, sizeof(extension->returnData));
+    returnLagPeak = 0;
+    returnStarted = false;
+
+    // Where the protocol words live, for readers that don't have SharedAudioData
+    auto offsetOf = [mappedMemory] (const void* field)
+    {
+        return static_cast<uint64_t>(static_cast<const char*>(field) - static_cast<const char*>(mappedMemory));
+    };
+
+    new (&extension->writeIndexOffset) std::atomic<uint64_t>(offsetOf(&sharedData->writeIndex));
+    new (&extension->readIndexOffset) std::atomic<uint64_t>(offsetOf(&sharedData->readIndex));
+    new (&extension->activeOffset) std::atomic<uint64_t>(offsetOf(&sharedData->isActive));
+    new (&extension->overrunsOffset) std::atomic<uint64_t>(offsetOf(&sharedData->metrics.bufferOverruns));
+    new (&extension->underrunsOffset) std::atomic<uint64_t>(offsetOf(&sharedData->metrics.bufferUnderruns));
+
+    new (&extension->reblockFrames) std::atomic<uint32_t>(0);
+    new (&extension->readerHeartbeat) std::atomic<uint64_t>(0);
+    new (&extension->loudnessBuses) std::atomic<uint32_t>(0);
+    new (&extension->loudnessVersion) std::atomic<uint32_t>(0);
+    publishedLoudnessVersion = 0;
+    new (&extension->wakeupWaiters) std::atomic<uint32_t>(0);
+
+    // Nobody is reading a brand new segment yet
+    presenceReadIndex = 0;
+    presenceHeartbeat = 0;
+    readerLastSeenMs = 0.0;
+    receiverPresent = false;
+    resyncPending = false;
+    idleFrames = 0;
+
+    new (&extension->layoutVersion) std::atomic<uint32_t>(SharedSegmentExtension::LAYOUT_VERSION);
+    new (&extension->magic) std::atomic<uint32_t>(0);
+    extension->magic.store(SharedSegmentExtension::MAGIC, std::memory_order_release);
+
+    transportRing = ast_attach(mappedMemory, segmentBytes, EXTENSION_OFFSET);
+    if (transportRing == nullptr)
+    {
+        juce::Logger::writeToLog("Failed to attach the transport ring to shared memory");
+        cleanupSharedMemory();
+        return false;
+    }
+
+    // Lay out (and clear) just the part of the ring this format needs
+    configureRing(layout);
 
-    // Clear all block headers
-    std::memset(sharedData->blockHeaders, 0,
-               SharedAudioData::RING_BUFFER_SIZE * sizeof(SharedAudioData::AudioBlockHeader));
+   #if defined (__linux__)
+    if (anonymousSegment)
+    {
+        // Receivers without the eventfd still work; they just poll
+        wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeupFd == -1)
+            juce::Logger::writeToLog("Failed to create the wakeup eventfd: " + juce::String(strerror(errno)));
+        else
+            ast_set_wakeup_fd(transportRing, wakeupFd);
+
+        segmentHandshake.publish(shm_fd, wakeupFd, EXTENSION_OFFSET, segmentBytes);
+    }
+   #endif
 
     juce::Logger::writeToLog("Shared memory initialized successfully at address: " +
-                            juce::String(reinterpret_cast<uintptr_t>(sharedData)));
+                            juce::String(reinterpret_cast<uintptr_t>(sharedData))
+                            + (anonymousSegment ? " (anonymous, handshake on " + handshakePath + ")" : juce::String()));
 
     isMemoryInitialized = true;
     return true;
@@ -121,25 +286,61 @@ bool SlaveAudioSenderAudioProcessor::initializeSharedMemory()
 
 void SlaveAudioSenderAudioProcessor::cleanupSharedMemory()
 {
+    // The tap and the exporter read the mapping directly, so they have to go first, and
+    // the handshake must not hand out fds that are about to be closed
+    captureTap.stop();
+    metricsExporter.stop();
+    segmentHandshake.stop();
+
     if (sharedData != nullptr)
     {
         // Set inactive flag before unmapping to notify receivers
         if (isMemoryInitialized)
         {
             sharedData->isActive.store(false);
+
+            // Release any receiver blocked waiting for the next offline block
+            if (extension != nullptr)
+                SharedMemoryWait::notify(extension->writerNotify);
+
+            // ...or sleeping on the eventfd, which it keeps open past our close
+            if (wakeupFd != -1)
+            {
+                const uint64_t wake = 1;
+                (void) write(wakeupFd, &wake, sizeof(wake));
+            }
         }
 
-        munmap(sharedData, MAX_BUFFER_SIZE);
+        ast_detach(transportRing);
+        transportRing = nullptr;
+        packetPending = false;
+        pendingPacketFrames = 0;
+
+        munmap(sharedData, segmentBytes);
         sharedData = nullptr;
+        extension = nullptr;
+        ringCapacity = 0;
+        diagnostics.ringCapacity.store(0, std::memory_order_relaxed);
+        ringStride = 0;
+        segmentBytes = 0;
     }
 
+    if (wakeupFd != -1)
+    {
+        close(wakeupFd);
+        wakeupFd = -1;
+    }
+
+    // A memfd has no name to unlink; it goes away with the last fd or mapping
     if (shm_fd != -1)
     {
         close(shm_fd);
-        shm_unlink(SHARED_MEMORY_NAME);
+        if (!anonymousSegment)
+            shm_unlink(SHARED_MEMORY_NAME);
         shm_fd = -1;
     }
 
+    anonymousSegment = false;
     isMemoryInitialized = false;
 }
 
@@ -153,8 +354,8 @@ void SlaveAudioSenderAudioProcessor::updateBufferSizeIfNeeded()
         uint64_t overruns = sharedData->metrics.bufferOverruns.load();
         static uint64_t lastOverruns = 0;
 
-        if (overruns > lastOverruns) {
-            // Increase buffer size if we're getting overruns
+        if (overruns > lastOverruns && sharedData->targetLatency.load() + 5 <= MAX_TARGET_LATENCY_MS) {
+            // Increase buffer size if we're getting overruns (the ring is sized for MAX_TARGET_LATENCY_MS)
             int currentTarget = sharedData->targetLatency.load();
             sharedData->targetLatency.store(currentTarget + 5); // Add 5ms
 
@@ -167,9 +368,499 @@ void SlaveAudioSenderAudioProcessor::updateBufferSizeIfNeeded()
 }
 
 
+ast_layout SlaveAudioSenderAudioProcessor::computeRingLayout(int numChannels, double sampleRate, int maxBlockSize) const
+{
+    // Enough frames for the largest target latency plus two blocks in flight (the
+    // library rounds up to a power of two so positions can be masked)
+    const double rate = sampleRate > 0.0 ? sampleRate : 48000.0;
+    const auto latencyFrames = static_cast<uint64_t>(std::ceil(rate * MAX_TARGET_LATENCY_MS * 0.001));
+    const auto neededFrames = juce::jmax(MIN_RING_FRAMES, latencyFrames + 2 * static_cast<uint64_t>(juce::jmax(1, maxBlockSize)));
+
+    ast_layout layout {};
+    ast_compute_layout(EXTENSION_OFFSET, neededFrames + 2 * static_cast<uint64_t>(reblockFrames),
+                       static_cast<uint32_t>(juce::jlimit(1, MAX_SEND_CHANNELS, numChannels)),
+                       transportFloat64 ? AST_FORMAT_FLOAT64 : AST_FORMAT_FLOAT32, &layout);
+    layout.period_frames = static_cast<uint32_t>(reblockFrames);
+    return layout;
+}
+
+bool SlaveAudioSenderAudioProcessor::growSegment(size_t newBytes)
+{
+    // Linux can grow a shm object in place; on macOS this fails and the caller
+    // re-creates the segment instead
+    if (ftruncate(shm_fd, static_cast<off_t>(newBytes)) == -1)
+        return false;
+
+    void* mappedMemory = mmap(0, newBytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (mappedMemory == MAP_FAILED)
+        return false;
+
+    // The exporter reads through the old mapping; prepareToPlay restarts it
+    metricsExporter.stop();
+
+    munmap(sharedData, segmentBytes);
+
+    sharedData = static_cast<SharedAudioData*>(mappedMemory);
+    extension = reinterpret_cast<SharedSegmentExtension*>(static_cast<char*>(mappedMemory) + EXTENSION_OFFSET);
+    segmentBytes = newBytes;
+    extension->segmentBytes.store(newBytes, std::memory_order_relaxed);
+
+    if (anonymousSegment)
+        segmentHandshake.publish(shm_fd, wakeupFd, EXTENSION_OFFSET, newBytes);
+
+    // Point the transport handle at the new mapping (the layout itself is reloaded when
+    // the resize finishes)
+    ast_refresh(transportRing, mappedMemory, newBytes);
+    return true;
+}
+
+int SlaveAudioSenderAudioProcessor::buildChannelMap(ChannelMap& map) const
+{
+    // Ring channels are the enabled input buses' channels, in bus order
+    int numChannels = 0;
+
+    for (int bus = 0; bus < getBusCount(true); ++bus)
+    {
+        const auto layout = getChannelLayoutOfBus(true, bus);
+
+        for (int channel = 0; channel < layout.size() && numChannels < MAX_SEND_CHANNELS; ++channel)
+        {
+            auto& info = map[static_cast<size_t>(numChannels++)];
+            info.bus = static_cast<uint16_t>(bus);
+            info.busChannel = static_cast<uint16_t>(channel);
+            info.speaker = static_cast<uint32_t>(layout.getTypeOfChannel(channel));
+        }
+    }
+
+    return numChannels;
+}
+
+bool SlaveAudioSenderAudioProcessor::configureRing(const ast_layout& layout)
+{
+    ChannelMap channelMap {};
+    const int channelMapSize = juce::jmin(buildChannelMap(channelMap), static_cast<int>(layout.stride));
+
+    ast_layout current {};
+    ast_get_layout(transportRing, &current);
+
+    // Only called while processBlock isn't running (segment init / prepareToPlay)
+    if (layout.capacity_frames == current.capacity_frames && layout.stride == current.stride
+        && layout.sample_format == current.sample_format && layout.period_frames == current.period_frames
+        && layout.segment_bytes <= segmentBytes
+        && extension->channelMapSize.load() == static_cast<uint32_t>(channelMapSize)
+        && std::memcmp(extension->channelMap, channelMap.data(),
+                       static_cast<size_t>(channelMapSize) * sizeof(SharedSegmentExtension::ChannelInfo)) == 0)
+        return true;
+
+    // The tap caches the geometry; prepareToPlay restarts it afterwards
+    captureTap.stop();
+
+    // A partly filled packet belongs to the old layout
+    packetPending = false;
+    pendingPacketFrames = 0;
+
+    // The ring restarts, so a receiver that stalled the old one gets waited for again
+    offlineWaitSuspended = false;
+
+    // Receivers must not touch the ring until the new layout is published
+    ast_begin_configure(transportRing);
+
+    if (layout.segment_bytes > segmentBytes && !growSegment(static_cast<size_t>(layout.segment_bytes)))
+    {
+        ast_cancel_configure(transportRing);
+        return false;
+    }
+
+    // The channel map changes together with the layout
+    std::memcpy(extension->channelMap, channelMap.data(), sizeof(channelMap));
+    extension->channelMapSize.store(static_cast<uint32_t>(channelMapSize), std::memory_order_relaxed);
+
+    if (ast_finish_configure(transportRing, sharedData, segmentBytes, &layout) != AST_OK)
+    {
+        juce::Logger::writeToLog("Audio ring layout doesn't fit the shared memory segment");
+        ast_cancel_configure(transportRing);
+        return false;
+    }
+
+    ringCapacity = layout.capacity_frames;
+    diagnostics.ringCapacity.store(ringCapacity, std::memory_order_relaxed);
+    ringStride = static_cast<int>(layout.stride);
+    sharedData->configurationCounter.fetch_add(1, std::memory_order_release);
+
+    // Our own readIndex reset isn't a sign of a receiver
+    presenceReadIndex = sharedData->readIndex.load(std::memory_order_relaxed);
+
+    // The ring restarts at the current writeIndex; nothing before it can come back
+    returnOrigin = sharedData->writeIndex.load(std::memory_order_relaxed);
+
+    juce::Logger::writeToLog("Audio ring: " + juce::String(static_cast<juce::int64>(ringCapacity)) + " frames x "
+                             + juce::String(ringStride) + " channels (" + juce::String(static_cast<juce::int64>(segmentBytes)) + " byte segment)");
+    return true;
+}
+
+void SlaveAudioSenderAudioProcessor::setDoublePrecisionTransport(bool shouldUseFloat64)
+{
+    // Takes effect at the next prepareToPlay, which re-creates the segment
+    parameters.state.setProperty("transportFloat64", shouldUseFloat64, nullptr);
+}
+
+void SlaveAudioSenderAudioProcessor::setAnonymousSegment(bool shouldUseAnonymous, const juce::String& socketPath)
+{
+    // Takes effect at the next prepareToPlay, which re-creates the segment
+    parameters.state.setProperty("anonymousSegment", shouldUseAnonymous, nullptr);
+    parameters.state.setProperty("handshakeSocketPath", socketPath, nullptr);
+}
+
+bool SlaveAudioSenderAudioProcessor::segmentModeChanged() const
+{
+    const bool wantAnonymous = static_cast<bool>(parameters.state.getProperty("anonymousSegment", false));
+    return wantAnonymous != anonymousRequested
+           || (wantAnonymous && parameters.state.getProperty("handshakeSocketPath").toString() != requestedSocketPath);
+}
+
+void SlaveAudioSenderAudioProcessor::setIdleWithoutReceiver(bool shouldIdle)
+{
+    // Takes effect at the next prepareToPlay
+    parameters.state.setProperty("idleWithoutReceiver", shouldIdle, nullptr);
+}
+
+void SlaveAudioSenderAudioProcessor::setReblockPeriod(int frames)
+{
+    // Takes effect at the next prepareToPlay, which re-lays out the ring
+    parameters.state.setProperty("reblockFrames", frames, nullptr);
+}
+
+bool SlaveAudioSenderAudioProcessor::startNetworkTransport(const juce::String& host, int port, double packetTimeMs)
+{
+    parameters.state.setProperty("networkEnabled", true, nullptr);
+    parameters.state.setProperty("networkHost", host, nullptr);
+    parameters.state.setProperty("networkPort", port, nullptr);
+    parameters.state.setProperty("networkPacketTimeMs", packetTimeMs, nullptr);
+
+    // Before prepareToPlay we don't know the stream format yet; it starts from there
+    if (currentSampleRate <= 0.0)
+        return true;
+
+    // Make sure processBlock isn't pushing into the sender while it reconfigures
+    suspendProcessing(true);
+    const bool started = restartNetworkTransport();
+    suspendProcessing(false);
+    return started;
+}
+
+void SlaveAudioSenderAudioProcessor::stopNetworkTransport()
+{
+    parameters.state.setProperty("networkEnabled", false, nullptr);
+
+    suspendProcessing(true);
+    networkSender.stop();
+    suspendProcessing(false);
+}
+
+bool SlaveAudioSenderAudioProcessor::restartNetworkTransport()
+{
+    if (!static_cast<bool>(parameters.state.getProperty("networkEnabled", false)))
+    {
+        networkSender.stop();
+        return false;
+    }
+
+    return networkSender.start(parameters.state.getProperty("networkHost", "127.0.0.1").toString(),
+                               parameters.state.getProperty("networkPort", NetworkAudio::DEFAULT_PORT),
+                               currentSampleRate,
+                               getTotalNumInputChannels(),
+                               parameters.state.getProperty("networkPacketTimeMs", NetworkAudio::DEFAULT_PACKET_TIME_MS));
+}
+
+void SlaveAudioSenderAudioProcessor::restartLoudnessAnalyzer()
+{
+    // One meter per enabled input bus, over that bus's channels of the send buffer.
+    // BS.1770 weights the surround channels by 1.41 and leaves out the LFE.
+    LoudnessAnalyzer::Layout layout;
+
+    for (int busIndex = 0; busIndex < getBusCount(true) && layout.numBuses < LoudnessAnalyzer::MAX_BUSES; ++busIndex)
+    {
+        const auto* bus = getBus(true, busIndex);
+        if (bus == nullptr || !bus->isEnabled())
+            continue;
+
+        const auto channelSet = bus->getCurrentLayout();
+        const int channels = juce::jmin(channelSet.size(), LoudnessAnalyzer::MAX_CHANNELS - layout.numChannels);
+
+        for (int channel = 0; channel < channels; ++channel)
+        {
+            const auto type = channelSet.getTypeOfChannel(channel);
+            float weight = 1.0f;
+
+            if (type == juce::AudioChannelSet::LFE || type == juce::AudioChannelSet::LFE2)
+                weight = 0.0f;
+            else if (type == juce::AudioChannelSet::leftSurround || type == juce::AudioChannelSet::rightSurround
+                     || type == juce::AudioChannelSet::leftSurroundSide || type == juce::AudioChannelSet::rightSurroundSide
+                     || type == juce::AudioChannelSet::leftSurroundRear || type == juce::AudioChannelSet::rightSurroundRear)
+                weight = 1.41f;
+
+            layout.channelWeights[layout.numChannels + channel] = weight;
+        }
+
+        layout.busChannels[layout.numBuses++] = channels;
+        layout.numChannels += channels;
+    }
+
+    if (!loudnessAnalyzer.start(currentSampleRate, layout))
+        juce::Logger::writeToLog("Loudness analysis not running (" + juce::String(layout.numBuses) + " buses, "
+                                 + juce::String(layout.numChannels) + " channels)");
+}
+
+void SlaveAudioSenderAudioProcessor::publishLoudness()
+{
+    // Only every 100 ms, when the analyser has something new
+    const uint32_t version = loudnessAnalyzer.getResultsVersion();
+    if (version == publishedLoudnessVersion || extension == nullptr)
+        return;
+
+    publishedLoudnessVersion = version;
+
+    const int numBuses = loudnessAnalyzer.getNumBuses();
+    for (int bus = 0; bus < numBuses; ++bus)
+    {
+        const auto results = loudnessAnalyzer.getResults(bus);
+        auto& info = extension->loudness[bus];
+        info.momentaryLufs.store(results.momentaryLufs, std::memory_order_relaxed);
+        info.shortTermLufs.store(results.shortTermLufs, std::memory_order_relaxed);
+        info.integratedLufs.store(results.integratedLufs, std::memory_order_relaxed);
+        info.truePeakDbtp.store(results.truePeakDbtp, std::memory_order_relaxed);
+    }
+
+    extension->loudnessBuses.store(static_cast<uint32_t>(numBuses), std::memory_order_relaxed);
+    extension->loudnessVersion.store(extension->loudnessVersion.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+bool SlaveAudioSenderAudioProcessor::startAggregation(const juce::String& laneName)
+{
+    parameters.state.setProperty("aggregationEnabled", true, nullptr);
+    parameters.state.setProperty("aggregationLaneName", laneName, nullptr);
+
+    if (currentSampleRate <= 0.0)
+        return true;
+
+    // Make sure processBlock isn't writing into the lane while it is reclaimed
+    suspendProcessing(true);
+    const bool started = restartAggregation();
+    suspendProcessing(false);
+    return started;
+}
+
+void SlaveAudioSenderAudioProcessor::stopAggregation()
+{
+    parameters.state.setProperty("aggregationEnabled", false, nullptr);
+
+    suspendProcessing(true);
+    aggregateLane.close();
+    suspendProcessing(false);
+}
+
+bool SlaveAudioSenderAudioProcessor::restartAggregation()
+{
+    if (!static_cast<bool>(parameters.state.getProperty("aggregationEnabled", false)))
+    {
+        aggregateLane.close();
+        return false;
+    }
+
+    // The receiver wakes once per host block of whichever instance created the segment
+    return aggregateLane.open(parameters.state.getProperty("aggregationLaneName", getName()).toString(),
+                              getTotalNumInputChannels(), currentSampleRate, juce::nextPowerOfTwo(currentBlockSize));
+}
+
+bool SlaveAudioSenderAudioProcessor::startCaptureTap(const juce::File& directory, juce::int64 maxFileBytes, double maxFileSeconds)
+{
+    parameters.state.setProperty("captureEnabled", true, nullptr);
+    parameters.state.setProperty("captureDirectory", directory.getFullPathName(), nullptr);
+    parameters.state.setProperty("captureMaxFileBytes", maxFileBytes, nullptr);
+    parameters.state.setProperty("captureMaxFileSeconds", maxFileSeconds, nullptr);
+
+    // Without a segment there is nothing to tap yet; prepareToPlay starts it
+    return !isMemoryInitialized || restartCaptureTap();
+}
+
+void SlaveAudioSenderAudioProcessor::stopCaptureTap()
+{
+    parameters.state.setProperty("captureEnabled", false, nullptr);
+    captureTap.stop();
+}
+
+bool SlaveAudioSenderAudioProcessor::restartCaptureTap()
+{
+    captureTap.stop();
+
+    if (!isMemoryInitialized || !static_cast<bool>(parameters.state.getProperty("captureEnabled", false)))
+        return false;
+
+    CaptureTap::Settings settings;
+    settings.directory = juce::File(parameters.state.getProperty("captureDirectory").toString());
+    settings.maxFileBytes = parameters.state.getProperty("captureMaxFileBytes", settings.maxFileBytes);
+    settings.maxFileSeconds = parameters.state.getProperty("captureMaxFileSeconds", settings.maxFileSeconds);
+    settings.writeAheadFrames = static_cast<uint64_t>(juce::jmax(currentBlockSize, sharedData->maxBufferSize.load()) + reblockFrames);
+
+    if (!settings.directory.isAbsolute())
+        settings.directory = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("AudioSenderCapture");
+
+    return captureTap.start(sharedData, extension, settings);
+}
+
+bool SlaveAudioSenderAudioProcessor::startMetricsExporter(const juce::String& socketPath, int port)
+{
+    parameters.state.setProperty("metricsEnabled", true, nullptr);
+    parameters.state.setProperty("metricsSocketPath", socketPath, nullptr);
+    parameters.state.setProperty("metricsPort", port, nullptr);
+
+    return restartMetricsExporter();
+}
+
+void SlaveAudioSenderAudioProcessor::stopMetricsExporter()
+{
+    parameters.state.setProperty("metricsEnabled", false, nullptr);
+    metricsExporter.stop();
+}
+
+bool SlaveAudioSenderAudioProcessor::restartMetricsExporter()
+{
+    metricsExporter.stop();
+
+    if (!static_cast<bool>(parameters.state.getProperty("metricsEnabled", false)))
+        return false;
+
+    MetricsExporter::Settings settings;
+    settings.socketPath = parameters.state.getProperty("metricsSocketPath").toString();
+    settings.port = parameters.state.getProperty("metricsPort", 0);
+
+    // Reads only counters that are already published; stopped before the segment is unmapped
+    return metricsExporter.start(settings, [this] (TransportDiagnosticsSnapshot& snapshot) { getDiagnostics(snapshot); });
+}
+
+void SlaveAudioSenderAudioProcessor::publishEvents(const juce::MidiBuffer& midiMessages, uint64_t blockPosition, int numSamples)
+{
+    if (extension == nullptr)
+        return;
+
+    uint64_t eventWrite = extension->eventWriteIndex.load(std::memory_order_relaxed);
+    const uint64_t eventRead = extension->eventReadIndex.load(std::memory_order_acquire);
+    uint64_t dropped = 0;
+
+    auto push = [&] (const SharedEventRecord& record)
+    {
+        if (eventWrite - eventRead >= SharedSegmentExtension::EVENT_RING_SIZE)
+        {
+            ++dropped;
+            return;
+        }
+
+        extension->events[eventWrite & SharedSegmentExtension::EVENT_RING_MASK] = record;
+        ++eventWrite;
+    };
+
+    // Stream restart marker, ahead of everything else at the first block after idling
+    if (resyncPending)
+    {
+        SharedEventRecord::ResyncPayload resync { pendingResyncFrames };
+        SharedEventRecord record {};
+        record.samplePosition = blockPosition;
+        record.type = SharedEventRecord::RESYNC;
+        record.size = sizeof(resync);
+        std::memcpy(record.data, &resync, sizeof(resync));
+        push(record);
+        resyncPending = false;
+    }
+
+    // Host transport: sent at the block start whenever play state or tempo change, or
+    // the position jumps (locate, loop wrap).
+    if (auto* playHead = getPlayHead())
+    {
+        if (const auto position = playHead->getPosition())
+        {
+            SharedEventRecord::TransportPayload transport {};
+            transport.ppqPosition = position->getPpqPosition().orFallback(0.0);
+            transport.bpm = static_cast<float>(position->getBpm().orFallback(0.0));
+            transport.flags = (position->getIsPlaying()   ? SharedEventRecord::TransportPayload::PLAYING   : 0u)
+                            | (position->getIsRecording() ? SharedEventRecord::TransportPayload::RECORDING : 0u)
+                            | (position->getIsLooping()   ? SharedEventRecord::TransportPayload::LOOPING   : 0u);
+
+            const auto timeInSamples = position->getTimeInSamples();
+            const bool jumped = lastTransportValid && position->getIsPlaying()
+                                && timeInSamples.hasValue() && *timeInSamples != expectedTimeInSamples;
+
+            if (!lastTransportValid || jumped || transport.flags != lastTransport.flags || transport.bpm != lastTransport.bpm)
+            {
+                lastTransport = transport;
+                lastTransportValid = true;
+
+                if (jumped)
+                    transport.flags |= SharedEventRecord::TransportPayload::POSITION_JUMP;
+
+                SharedEventRecord record {};
+                record.samplePosition = blockPosition;
+                record.type = SharedEventRecord::TRANSPORT;
+                record.size = sizeof(transport);
+                std::memcpy(record.data, &transport, sizeof(transport));
+                push(record);
+            }
+
+            expectedTimeInSamples = timeInSamples.orFallback(0) + numSamples;
+        }
+    }
+
+    // Parameter changes, stamped at the block start (the host only gives us block-rate values)
+    const auto& processorParameters = getParameters();
+    if (static_cast<int>(lastParameterValues.size()) == processorParameters.size())
+    {
+        for (int i = 0; i < processorParameters.size(); ++i)
+        {
+            const float value = processorParameters[i]->getValue();
+            if (value == lastParameterValues[static_cast<size_t>(i)])
+                continue;
+
+            lastParameterValues[static_cast<size_t>(i)] = value;
+
+            SharedEventRecord::ParameterPayload parameter { static_cast<uint32_t>(i), value };
+            SharedEventRecord record {};
+            record.samplePosition = blockPosition;
+            record.type = SharedEventRecord::PARAMETER;
+            record.size = sizeof(parameter);
+            std::memcpy(record.data, &parameter, sizeof(parameter));
+            push(record);
+        }
+    }
+
+    // MIDI, at its exact sample within the block. Long SysEx doesn't fit a record.
+    for (const auto metadata : midiMessages)
+    {
+        if (metadata.numBytes > static_cast<int>(sizeof(SharedEventRecord::data)))
+        {
+            ++dropped;
+            continue;
+        }
+
+        SharedEventRecord record {};
+        record.samplePosition = blockPosition + static_cast<uint64_t>(juce::jlimit(0, juce::jmax(0, numSamples - 1), metadata.samplePosition));
+        record.type = SharedEventRecord::MIDI;
+        record.size = static_cast<uint32_t>(metadata.numBytes);
+        std::memcpy(record.data, metadata.data, static_cast<size_t>(metadata.numBytes));
+        push(record);
+    }
+
+    extension->eventWriteIndex.store(eventWrite, std::memory_order_release);
+
+    if (dropped > 0)
+        extension->eventOverruns.fetch_add(dropped, std::memory_order_relaxed);
+}
+
 //Destructor
 SlaveAudioSenderAudioProcessor::~SlaveAudioSenderAudioProcessor()
 {
+    cancelPendingUpdate();
+    networkSender.stop();
+    aggregateLane.close();
+    loudnessAnalyzer.stop();
     cleanupSharedMemory();
 }
 
@@ -243,21 +934,57 @@ void SlaveAudioSenderAudioProcessor::prepareToPlay (double sampleRate, int sampl
     currentBlockSize = samplesPerBlock;
     currentNumChannels = getTotalNumInputChannels();
 
+    // Fixed-period reblocking only works with power-of-two periods (packets must not wrap)
+    const int requestedPeriod = parameters.state.getProperty("reblockFrames", 0);
+    reblockFrames = juce::isPowerOfTwo(requestedPeriod) && requestedPeriod >= MIN_REBLOCK_FRAMES
+                        && requestedPeriod <= MAX_REBLOCK_FRAMES ? requestedPeriod : 0;
+
+    if (requestedPeriod != 0 && reblockFrames == 0)
+        juce::Logger::writeToLog("Ignoring reblock period of " + juce::String(requestedPeriod) + " frames (must be a power of two from "
+                                 + juce::String(MIN_REBLOCK_FRAMES) + " to " + juce::String(MAX_REBLOCK_FRAMES) + ")");
+
+    // Skip publishing while no receiver is attached (see SharedSegmentExtension::readerHeartbeat)
+    idleWithoutReceiver = static_cast<bool>(parameters.state.getProperty("idleWithoutReceiver", true));
+
+    // Parameter change tracking for the event channel; -1 forces an initial event per parameter
+    lastParameterValues.assign(static_cast<size_t>(getParameters().size()), -1.0f);
+
     // Initialize or reconfigure shared memory with the right parameters
-        if (!isMemoryInitialized) {
+        const bool wantFloat64 = static_cast<bool>(parameters.state.getProperty("transportFloat64", false));
+        if (!isMemoryInitialized || wantFloat64 != transportFloat64 || segmentModeChanged()) {
+            // A sample format change moves every frame in the ring, and receivers of the
+            // other segment mode couldn't find this one, so start a fresh segment
             initializeSharedMemory();
         } else {
             // Update configuration
             sharedData->sampleRate.store(sampleRate);
             sharedData->preferredBufferSize.store(samplesPerBlock);
-            sharedData->numChannels.store(currentNumChannels);
             sharedData->maxBufferSize.store(std::max(sharedData->maxBufferSize.load(), samplesPerBlock));
             sharedData->configurationCounter.fetch_add(1, std::memory_order_release);
+
+            // Resize the ring for the new format; if the segment can't grow in place,
+            // start a fresh one (receivers reattach when the old one goes inactive)
+            if (!configureRing(computeRingLayout(currentNumChannels, sampleRate, samplesPerBlock)))
+                initializeSharedMemory();
         }
+
+    // The network sender's FIFO and packet size depend on the format, so restart it
+    restartNetworkTransport();
+    restartAggregation();
+    restartLoudnessAnalyzer();
+
+    if (!captureTap.isRunning())
+        restartCaptureTap();
+
+    if (!metricsExporter.isRunning())
+        restartMetricsExporter();
 }
 
 void SlaveAudioSenderAudioProcessor::releaseResources()
 {
+    networkSender.stop();
+    aggregateLane.close();
+    loudnessAnalyzer.stop();
     cleanupSharedMemory();
 }
 
@@ -273,76 +1000,210 @@ bool SlaveAudioSenderAudioProcessor::isBusesLayoutSupported (const BusesLayout&
         layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
         return false;
 
-    // Check each input bus
-    for (int bus = 0; bus < getBusCount(true); ++bus)
-    {
-        auto inputSet = layouts.getChannelSet(true, bus);
-        if (bus == 0 || bus == 1)  // "1/2" and "3/4" must be stereo
-        {
-            if (inputSet != juce::AudioChannelSet::stereo())
-                return false;
-        }
-        else  // Buses "1", "2", "3", "4" must be mono
-        {
-            if (inputSet != juce::AudioChannelSet::mono())
-                return false;
-        }
-    }
-    return true;
+    // The main input must be enabled
+    if (layouts.getMainInputChannelSet().isDisabled())
+        return false;
+
+    // Any input layout (stereo/mono, surround, ambisonic or discrete) is fine, and the
+    // extra buses may be disabled, as long as everything fits in the ring's channel map
+    int totalInputChannels = 0;
+    for (const auto& inputSet : layouts.inputBuses)
+        totalInputChannels += inputSet.size();
+
+    return totalInputChannels <= MAX_SEND_CHANNELS;
 #endif
 }
 #endif
 
 
-void SlaveAudioSenderAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+template <typename SampleType>
+void SlaveAudioSenderAudioProcessor::processBlockInternal (juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
 
     // Get total channels and number of samples.
-    // With multiple buses, getTotalNumInputChannels() should equal 10
+    // All enabled input buses together, at most MAX_SEND_CHANNELS
     int totalNumInputChannels  = getTotalNumInputChannels();
     int totalNumOutputChannels = getTotalNumOutputChannels();
     int numSamples = buffer.getNumSamples();
 
+    // Per-stage timing; compiles to nothing without AUDIOSENDER_ENABLE_INSTRUMENTATION.
+    // It and the diagnostics below share the callback's start and end clock reads.
+    const uint64_t callbackStartNs = BlockInstrumentation::nowNs();
+    BlockInstrumentation::Scope timing(instrumentation, callbackStartNs, numSamples, currentSampleRate);
+
+    // Diagnostics for this callback are recorded on the way out, whichever path it takes.
+    const juce::ScopeGuard recordDiagnostics { [&]
+    {
+        const uint64_t callbackEndNs = BlockInstrumentation::nowNs();
+        timing.finish(callbackEndNs);
+
+        uint64_t queued = 0;
+        bool readerProgressed = false;
+
+        if (sharedData != nullptr && ringCapacity > 0)
+        {
+            const uint64_t written = sharedData->writeIndex.load(std::memory_order_relaxed);
+            const uint64_t read = sharedData->readIndex.load(std::memory_order_relaxed);
+            queued = written - read <= ringCapacity ? written - read : 0;
+            readerProgressed = read != lastSeenReadIndex;
+            lastSeenReadIndex = read;
+        }
+
+        diagnostics.recordBlock(ringCapacity > 0 ? static_cast<double>(queued) / static_cast<double>(ringCapacity) : 0.0,
+                                currentSampleRate > 0.0 ? static_cast<double>(queued) * 1000.0 / currentSampleRate : 0.0,
+                                static_cast<double>(callbackEndNs - callbackStartNs) * 1.0e-6,
+                                lastCallbackStartNs != 0 ? static_cast<double>(callbackStartNs - lastCallbackStartNs) * 1.0e-6 : 0.0,
+                                readerProgressed, static_cast<double>(callbackEndNs) * 1.0e-6);
+        lastCallbackStartNs = callbackStartNs;
+    }};
+
     // Clear any output channels that didn't contain input data.
     for (int i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, numSamples);
 
-    // Apply gain to the entire buffer if needed.
-    if (gain != 1.0f)
+    // The gain is never applied to the input in place: the ring, network and snapshot
+    // writes scale as they copy, so the block is read once and rendered straight into
+    // shared memory. Only the channels that reach the output are scaled here.
+    const float blockGain = gain;
+    auto applyOutputGain = [&]
     {
-        for (int channel = 0; channel < totalNumInputChannels; ++channel)
-        {
-            float* channelData = buffer.getWritePointer(channel);
-            for (int sample = 0; sample < numSamples; ++sample)
-                channelData[sample] *= gain;
-        }
-    }
+        if (blockGain != 1.0f)
+            for (int channel = 0; channel < juce::jmin(totalNumInputChannels, totalNumOutputChannels); ++channel)
+                buffer.applyGain(channel, 0, numSamples, static_cast<SampleType>(blockGain));
+    };
 
-    // Calculate and store the current audio level AFTER applying gain.
+    // Calculate and store the current (post-gain) audio level.
     {
         const juce::ScopedLock scopedLock(levelLock);
-        currentLevel = AudioLevelUtils::calculateRMSLevel(buffer);
+        currentLevel = calculateRMSLevel(buffer, blockGain);
+    }
+
+    // Loudness and true peak are measured off the audio thread (lock-free, no-op when stopped).
+    loudnessAnalyzer.pushBlock(buffer, totalNumInputChannels, numSamples, blockGain);
+    timing.lap(BlockInstrumentation::METERING);
+
+    // Hand the block to the network sender thread (lock-free, no-op when disabled).
+    networkSender.pushBlock(buffer, totalNumInputChannels, numSamples, blockGain);
+
+    // Same for the aggregation lane, at the block's host sample position.
+    if (aggregateLane.isOpen())
+    {
+        juce::int64 hostPosition = 0;
+        if (auto* playHead = getPlayHead())
+            if (const auto position = playHead->getPosition())
+                hostPosition = position->getTimeInSamples().orFallback(0);
+
+        aggregateLane.write(buffer, totalNumInputChannels, numSamples, hostPosition, blockGain);
     }
+    timing.lap(BlockInstrumentation::NETWORK);
 
     // Skip further processing if shared memory isn't initialized.
-    if (!isMemoryInitialized || sharedData == nullptr)
+    if (!isMemoryInitialized || sharedData == nullptr || transportRing == nullptr || ringCapacity == 0)
+    {
+        applyOutputGain();
         return;
+    }
+
+    // Receivers see loudness updates whether or not they read the audio.
+    publishLoudness();
+
+    // Without a receiver only the metering above runs (see shouldPublishBlock).
+    uint64_t blockPosition = packetPending ? pendingPacket.position + pendingPacketFrames
+                                           : sharedData->writeIndex.load(std::memory_order_relaxed);
+
+    if (shouldPublishBlock(numSamples))
+    {
+        blockPosition = publishToRing(buffer, midiMessages, numSamples, blockGain, timing);
+        timing.lap(BlockInstrumentation::RING_WRITE);
+
+        // Observers get the block whether or not the ring had room for it.
+        publishSnapshot(buffer, blockPosition, juce::jmin(totalNumInputChannels, ringStride), numSamples, blockGain);
+        timing.lap(BlockInstrumentation::SNAPSHOT);
+    }
+
+    // From here on the output carries the post-gain input unless something replaces it.
+    applyOutputGain();
+    timing.lap(BlockInstrumentation::GAIN);
+
+    // Return path: play the receiver's processed audio instead of the input/silence.
+    if (renderReturnPath(buffer, blockPosition, numSamples))
+    {
+        timing.lap(BlockInstrumentation::RETURN_PATH);
+        updateBufferSizeIfNeeded();
+        timing.lap(BlockInstrumentation::METRICS);
+        return;
+    }
+
+    // Monitor Button: if monitoring is off, clear the output channels.
+    if (monitorParameter != nullptr && monitorParameter->load() < 0.5f)
+    {
+        for (int i = 0; i < totalNumOutputChannels; ++i)
+            buffer.clear(i, 0, numSamples);
+    }
+    timing.lap(BlockInstrumentation::RETURN_PATH);
+
+    // Additional functionality: update buffer size if needed.
+    updateBufferSizeIfNeeded();
+    timing.lap(BlockInstrumentation::METRICS);
+}
 
-    // Update shared memory parameters.
-    sharedData->numChannels.store(totalNumInputChannels);
-    sharedData->bufferSize.store(numSamples);
+template <typename SampleType>
+uint64_t SlaveAudioSenderAudioProcessor::publishToRing (const juce::AudioBuffer<SampleType>& buffer, const juce::MidiBuffer& midiMessages,
+                                                        int numSamples, float blockGain, BlockInstrumentation::Scope& timing)
+{
+    // Update shared memory parameters. The channel count is the ring's stride; the legacy
+    // numChannels/bufferSize stay 0 (see SharedSegmentExtension).
     sharedData->sampleRate.store(currentSampleRate);
+    diagnostics.blockSize.store(reblockFrames > 0 ? reblockFrames : numSamples, std::memory_order_relaxed);
 
     // Get current write position in shared memory.
     uint64_t writeIndex = sharedData->writeIndex.load(std::memory_order_acquire);
 
+    // Publish whether the host is bouncing faster than real time.
+    const bool offline = isNonRealtime();
+    if (extension != nullptr && extension->offlineMode.load(std::memory_order_relaxed) != (offline ? 1u : 0u))
+        extension->offlineMode.store(offline ? 1 : 0, std::memory_order_release);
+
+    // With reblocking, this host block continues the packet that is still being filled.
+    const uint32_t period = static_cast<uint32_t>(reblockFrames);
+    const uint64_t blockPosition = packetPending ? pendingPacket.position + pendingPacketFrames : writeIndex;
+
+    // Frames of new ring space this block needs: the block itself, or with reblocking the
+    // whole packets it starts (the pending packet is already reserved).
+    uint64_t needed = static_cast<uint64_t>(numSamples);
+    if (period > 0)
+    {
+        const uint64_t pendingRoom = packetPending ? period - pendingPacketFrames : 0;
+        needed = needed > pendingRoom ? (needed - pendingRoom + period - 1) / period * period : 0;
+    }
+
     // Calculate available space in the ring buffer.
-    uint64_t readIndex = sharedData->readIndex.load(std::memory_order_acquire);
-    uint64_t available = SharedAudioData::RING_BUFFER_SIZE - (writeIndex - readIndex);
+    uint64_t available = ast_write_space(transportRing);
 
-    // Get a sequence number for this block.
-    uint64_t sequence = sharedData->sequenceCounter.fetch_add(1, std::memory_order_relaxed);
+    // Offline renders don't drop while the receiver keeps up: wait for it instead. Once a
+    // wait times out the receiver is taken as stalled, and blocks drop straight away
+    // (counted) until it reads again, rather than stalling the bounce for every block.
+    const uint64_t readIndex = sharedData->readIndex.load(std::memory_order_relaxed);
+    if (offlineWaitSuspended && (!offline || readIndex != offlineStalledReadIndex))
+        offlineWaitSuspended = false;
+
+    if (offline && needed > available)
+    {
+        if (offlineWaitSuspended)
+        {
+            diagnostics.offlineDrops.store(diagnostics.offlineDrops.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        else if (ast_wait_for_space(transportRing, static_cast<uint32_t>(needed), OFFLINE_WAIT_TIMEOUT_MS) == AST_OK)
+        {
+            available = ast_write_space(transportRing);
+        }
+        else
+        {
+            offlineWaitSuspended = true;
+            offlineStalledReadIndex = sharedData->readIndex.load(std::memory_order_relaxed);
+        }
+    }
 
     // Latency Tracking:
     double currentTime = juce::Time::getMillisecondCounterHiRes() * 0.001; // seconds
@@ -357,61 +1218,456 @@ void SlaveAudioSenderAudioProcessor::processBlock (juce::AudioBuffer<float>& buf
     if (bufferLatency > maxLatency)
         sharedData->metrics.maxLatency.store(bufferLatency);
     // ^ End Latency Tracking
+    timing.lap(BlockInstrumentation::METRICS);
 
-    // Ensure we have enough space to write all samples.
-    if (numSamples <= available)
+    auto reportOverrun = [&]
     {
-        // Instead of assuming a merged buffer, iterate over each input bus.
-        int channelOffset = 0; // Running offset into the interleaved output.
-        for (int bus = 0; bus < getBusCount(true); ++bus)
+        // Buffer overrun handling. Every overrun is counted in the segment; the log only
+        // gets a summary now and then, since a stalled receiver overruns every block.
+        ast_write_overrun(transportRing);
+        ++overrunsSinceLog;
+
+        const double nowMs = juce::Time::getMillisecondCounterHiRes();
+        if (nowMs - lastOverrunLogMs >= OVERRUN_LOG_INTERVAL_MS)
         {
-            // Retrieve the buffer for this input bus as a reference.
-            const auto& busBuffer = getBusBuffer(buffer, true, bus);
-            int numBusChannels = busBuffer.getNumChannels();
+            juce::Logger::writeToLog("Buffer overrun: needed " + juce::String(needed) + " frames but only "
+                                       + juce::String(available) + " available (" + juce::String(overrunsSinceLog)
+                                       + " overruns since the last report)");
+            lastOverrunLogMs = nowMs;
+            overrunsSinceLog = 0;
+        }
+    };
 
-            // Write this bus's samples into the shared memory buffer.
-            for (int sample = 0; sample < numSamples; ++sample)
+    if (period > 0)
+    {
+        // Events for this block go out before any packet that contains it, so a receiver
+        // that sees the audio also sees every event that applies to it.
+        publishEvents(midiMessages, blockPosition, numSamples);
+
+        // Fill fixed-size packets in place: each one is reserved when its first frame
+        // arrives, rendered into across as many host blocks as it takes, and published
+        // with a single header once full. A packet that can't be reserved drops the rest
+        // of the block; positions stay period-aligned since only whole packets commit.
+        int rendered = 0;
+        while (rendered < numSamples)
+        {
+            if (!packetPending)
             {
-                uint64_t frameIndex = (writeIndex + sample) & SharedAudioData::BUFFER_MASK;
-                for (int channel = 0; channel < numBusChannels; ++channel)
+                if (ast_write_reserve(transportRing, period, &pendingPacket) != AST_OK)
                 {
-                    int overallChannel = channelOffset + channel;
-                    int bufferIndex = (frameIndex * totalNumInputChannels) + overallChannel;
-                    sharedData->audioData[bufferIndex] = busBuffer.getSample(channel, sample);
+                    reportOverrun();
+                    break;
                 }
+
+                packetPending = true;
+                pendingPacketFrames = 0;
+            }
+
+            const uint32_t frames = juce::jmin(static_cast<uint32_t>(numSamples - rendered), period - pendingPacketFrames);
+            ast_span part {};
+            ast_span_slice(&pendingPacket, pendingPacketFrames, frames, &part);
+            renderInputIntoSpan(buffer, part, rendered, static_cast<SampleType>(blockGain));
+
+            pendingPacketFrames += frames;
+            rendered += static_cast<int>(frames);
+
+            if (pendingPacketFrames == period)
+            {
+                ast_write_commit(transportRing, &pendingPacket, sharedData->sequenceCounter.fetch_add(1, std::memory_order_relaxed),
+                                 juce::Time::getMillisecondCounterHiRes() * 0.001);
+                packetPending = false;
             }
-            channelOffset += numBusChannels;
         }
+    }
+    else
+    {
+        // Reserve the block in the ring; fails if there isn't room for all of it.
+        ast_span span {};
+        const int reserved = numSamples > 0 ? ast_write_reserve(transportRing, static_cast<uint32_t>(numSamples), &span) : AST_ERR_INVALID;
+
+        if (reserved == AST_OK)
+        {
+            renderInputIntoSpan(buffer, span, 0, static_cast<SampleType>(blockGain));
+
+            // Events for this block go out before the block itself, so a receiver that sees
+            // the audio also sees every event that applies to it.
+            publishEvents(midiMessages, writeIndex, numSamples);
+
+            // Writes the block header and publishes writeIndex (and wakes offline receivers).
+            ast_write_commit(transportRing, &span, sharedData->sequenceCounter.fetch_add(1, std::memory_order_relaxed),
+                             juce::Time::getMillisecondCounterHiRes() * 0.001);
+        }
+        else if (reserved == AST_FULL)
+        {
+            reportOverrun();
+
+            // The block's MIDI goes with it; parameter and transport changes are sent with
+            // the next block that gets through, since they are only marked sent when published
+            if (extension != nullptr && !midiMessages.isEmpty())
+                extension->eventOverruns.fetch_add(static_cast<uint64_t>(midiMessages.getNumEvents()), std::memory_order_relaxed);
+        }
+        else if (numSamples == 0)
+        {
+            // Empty blocks carry no audio, but hosts use them to flush MIDI
+            publishEvents(midiMessages, writeIndex, 0);
+        }
+    }
+
+    return blockPosition;
+}
+
+bool SlaveAudioSenderAudioProcessor::shouldPublishBlock (int numSamples)
+{
+    // A receiver is present while readIndex or its heartbeat keeps changing. Timed on
+    // the wall clock, since offline renders run far ahead of the audio they produce.
+    const double nowMs = juce::Time::getMillisecondCounterHiRes();
+    const uint64_t readIndex = sharedData->readIndex.load(std::memory_order_relaxed);
+    const uint64_t heartbeat = extension->readerHeartbeat.load(std::memory_order_relaxed);
+
+    if (readIndex != presenceReadIndex || heartbeat != presenceHeartbeat)
+    {
+        presenceReadIndex = readIndex;
+        presenceHeartbeat = heartbeat;
+        readerLastSeenMs = nowMs;
+    }
+
+    const bool present = readerLastSeenMs > 0.0 && nowMs - readerLastSeenMs < SharedSegmentExtension::READER_TIMEOUT_MS;
+    diagnostics.receiverPresent.store(present, std::memory_order_relaxed);
+
+    if (!idleWithoutReceiver)
+        return true;
+
+    if (!present)
+    {
+        receiverPresent = false;
+        idleFrames += static_cast<uint64_t>(numSamples);
+        diagnostics.idleBlocks.store(diagnostics.idleBlocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        // An occasional probe block lets receivers that only move readIndex show up. It
+        // stops once the ring is half full, so nothing overruns while nobody reads.
+        if (nowMs - lastProbeMs < SharedSegmentExtension::IDLE_PROBE_MS
+            || ast_write_space(transportRing) < ringCapacity / 2)
+            return false;
+
+        lastProbeMs = nowMs;
+        return true;
+    }
+
+    if (!receiverPresent)
+    {
+        // A receiver appeared: drop whatever sat in the ring while nobody was reading
+        // (probes, a half-filled packet) and start a fresh, marked stream
+        receiverPresent = true;
+        packetPending = false;
+        pendingPacketFrames = 0;
+
+        ast_write_restart(transportRing);
+        presenceReadIndex = sharedData->readIndex.load(std::memory_order_relaxed);
+        sharedData->sequenceCounter.store(0, std::memory_order_relaxed);
+
+        pendingResyncFrames = idleFrames;
+        resyncPending = true;
+        idleFrames = 0;
+
+        // Re-send the transport state and every parameter
+        lastTransportValid = false;
+        std::fill(lastParameterValues.begin(), lastParameterValues.end(), -1.0f);
+        diagnostics.resyncs.store(diagnostics.resyncs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    return true;
+}
+
+template <typename SampleType>
+void SlaveAudioSenderAudioProcessor::renderInputIntoSpan (const juce::AudioBuffer<SampleType>& buffer, const ast_span& span,
+                                                          int sourceOffset, SampleType blockGain)
+{
+    // Instead of assuming a merged buffer, iterate over each input bus.
+    int channelOffset = 0; // Running offset into the interleaved output.
+    for (int bus = 0; bus < getBusCount(true); ++bus)
+    {
+        // Retrieve the buffer for this input bus as a reference.
+        const auto& busBuffer = getBusBuffer(buffer, true, bus);
+        int numBusChannels = juce::jmin(busBuffer.getNumChannels(), ringStride - channelOffset);
+        if (numBusChannels <= 0)
+            break;
+
+        // Render this bus's samples into the span, applying the gain and converting to
+        // the ring's sample format on the way.
+        RingWriteKernels::interleaveIntoSpan(span, channelOffset, busBuffer.getArrayOfReadPointers(), numBusChannels,
+                                             sourceOffset, blockGain);
+
+        channelOffset += numBusChannels;
+    }
+}
+
+void SlaveAudioSenderAudioProcessor::getDiagnostics (TransportDiagnosticsSnapshot& snapshot) const
+{
+    const uint32_t written = diagnostics.fillHistoryWrite.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < TransportDiagnostics::FILL_HISTORY_SIZE; ++i)
+        snapshot.fillHistory[i] = diagnostics.fillHistory[(written + i) & TransportDiagnostics::FILL_HISTORY_MASK].load(std::memory_order_relaxed);
+
+    for (int bin = 0; bin < TransportDiagnostics::LATENCY_BINS; ++bin)
+        snapshot.latencyHistogram[bin] = diagnostics.latencyHistogram[bin].load(std::memory_order_relaxed);
+
+    snapshot.blocksProcessed    = diagnostics.blocksProcessed.load(std::memory_order_relaxed);
+    snapshot.callbackMs         = diagnostics.callbackMs.load(std::memory_order_relaxed);
+    snapshot.callbackPeakMs     = diagnostics.callbackPeakMs.load(std::memory_order_relaxed);
+    snapshot.callbackIntervalMs = diagnostics.callbackIntervalMs.load(std::memory_order_relaxed);
+
+    const double lastReaderProgress = diagnostics.lastReaderProgressMs.load(std::memory_order_relaxed);
+    snapshot.readerHeartbeatAgeMs = lastReaderProgress > 0.0 ? BlockInstrumentation::nowMs() - lastReaderProgress : -1.0;
+    snapshot.receiverPresent = diagnostics.receiverPresent.load(std::memory_order_relaxed);
+    snapshot.idleBlocks = diagnostics.idleBlocks.load(std::memory_order_relaxed);
+    snapshot.resyncs = diagnostics.resyncs.load(std::memory_order_relaxed);
+    snapshot.offlineDrops = diagnostics.offlineDrops.load(std::memory_order_relaxed);
+
+    snapshot.aggregationDroppedBlocks = aggregateLane.getDroppedBlocks();
+    snapshot.aggregationOversizedBlocks = aggregateLane.getOversizedBlocks();
+    snapshot.aggregationTruncatedChannels = aggregateLane.getTruncatedChannels();
+
+    snapshot.loudnessBuses = loudnessAnalyzer.getNumBuses();
+    for (int bus = 0; bus < snapshot.loudnessBuses; ++bus)
+    {
+        const auto results = loudnessAnalyzer.getResults(bus);
+        snapshot.loudness[bus] = { results.momentaryLufs, results.shortTermLufs, results.integratedLufs, results.truePeakDbtp };
+    }
+
+   #if AUDIOSENDER_ENABLE_INSTRUMENTATION
+    snapshot.instrumented = true;
 
-        // Store block metadata.
-        uint64_t headerIndex = writeIndex & SharedAudioData::BUFFER_MASK;
-        sharedData->blockHeaders[headerIndex].sequenceNumber = sequence;
-        sharedData->blockHeaders[headerIndex].timestamp = juce::Time::getMillisecondCounterHiRes() * 0.001;
-        sharedData->blockHeaders[headerIndex].blockSize = numSamples;
-        sharedData->blockHeaders[headerIndex].numChannels = totalNumInputChannels;
+    for (int stage = 0; stage < BlockInstrumentation::NUM_STAGES; ++stage)
+    {
+        for (int bin = 0; bin < BlockInstrumentation::TIME_BINS; ++bin)
+            snapshot.stageHistogram[stage][bin] = instrumentation.stageHistogram[stage][bin].load(std::memory_order_relaxed);
 
-        // Memory barrier ensures all writes complete before advancing the write index.
-        std::atomic_thread_fence(std::memory_order_release);
-        sharedData->writeIndex.store(writeIndex + numSamples, std::memory_order_release);
+        snapshot.stageTotalNs[stage] = instrumentation.stageTotalNs[stage].load(std::memory_order_relaxed);
+    }
+
+    for (int bin = 0; bin < BlockInstrumentation::TIME_BINS; ++bin)
+    {
+        snapshot.callbackHistogram[bin] = instrumentation.callbackHistogram[bin].load(std::memory_order_relaxed);
+        snapshot.intervalHistogram[bin] = instrumentation.intervalHistogram[bin].load(std::memory_order_relaxed);
+    }
+
+    for (int bin = 0; bin < BlockInstrumentation::LOAD_BINS; ++bin)
+        snapshot.loadHistogram[bin] = instrumentation.loadHistogram[bin].load(std::memory_order_relaxed);
+
+    snapshot.instrumentedCallbacks = instrumentation.callbacks.load(std::memory_order_relaxed);
+    snapshot.deadlineMisses = instrumentation.deadlineMisses.load(std::memory_order_relaxed);
+   #endif
+
+    snapshot.connected = isMemoryInitializedAndActive();
+    if (!snapshot.connected)
+        return;
+
+    snapshot.sampleRate           = sharedData->sampleRate.load(std::memory_order_relaxed);
+    snapshot.numChannels          = extension != nullptr ? static_cast<int>(extension->ringStride.load(std::memory_order_relaxed)) : 0;
+    snapshot.blockSize            = diagnostics.blockSize.load(std::memory_order_relaxed);
+    snapshot.float64              = diagnostics.float64.load(std::memory_order_relaxed);
+    snapshot.targetLatencyMs      = sharedData->targetLatency.load(std::memory_order_relaxed);
+    snapshot.ringCapacity         = diagnostics.ringCapacity.load(std::memory_order_relaxed);
+    snapshot.writeIndex           = sharedData->writeIndex.load(std::memory_order_relaxed);
+    snapshot.readIndex            = sharedData->readIndex.load(std::memory_order_relaxed);
+    snapshot.configurationCounter = sharedData->configurationCounter.load(std::memory_order_relaxed);
+    snapshot.overruns             = sharedData->metrics.bufferOverruns.load(std::memory_order_relaxed);
+    snapshot.underruns            = sharedData->metrics.bufferUnderruns.load(std::memory_order_relaxed);
+
+    if (extension != nullptr)
+    {
+        snapshot.ringGeneration  = extension->ringGeneration.load(std::memory_order_relaxed);
+        snapshot.returnUnderruns = extension->returnUnderruns.load(std::memory_order_relaxed);
+        snapshot.eventOverruns   = extension->eventOverruns.load(std::memory_order_relaxed);
+    }
+}
+
+template <typename SampleType>
+void SlaveAudioSenderAudioProcessor::publishSnapshot (const juce::AudioBuffer<SampleType>& buffer, uint64_t blockPosition,
+                                                      int numChannels, int numSamples, float gain)
+{
+    if (extension == nullptr || numChannels <= 0 || numSamples <= 0)
+        return;
+
+    // Write into the slot after the newest one; observers may still be copying that
+    const uint32_t slotIndex = (extension->snapshotLatest.load(std::memory_order_relaxed) + 1) % SharedSegmentExtension::SNAPSHOT_SLOTS;
+    auto& slot = extension->snapshots[slotIndex];
+
+    const uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const int decimation = (numSamples + SharedSegmentExtension::SNAPSHOT_MAX_FRAMES - 1) / SharedSegmentExtension::SNAPSHOT_MAX_FRAMES;
+    const int storedFrames = (numSamples + decimation - 1) / decimation;
+
+    if (decimation == 1)
+    {
+        RingWriteKernels::interleaveSpan(slot.samples, numChannels, buffer.getArrayOfReadPointers(), numChannels, 0, numSamples,
+                                         static_cast<SampleType>(gain));
     }
     else
     {
-        // Buffer overrun handling.
-        juce::Logger::writeToLog("Buffer overrun: needed " + juce::String(numSamples) +
-                                   " frames but only " + juce::String(available) + " available");
-        sharedData->metrics.bufferOverruns.fetch_add(1, std::memory_order_relaxed);
-        // Optionally, you could try to write partial data here.
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const SampleType* source = buffer.getReadPointer(channel);
+            for (int frame = 0; frame < storedFrames; ++frame)
+                slot.samples[frame * numChannels + channel] = static_cast<float>(source[frame * decimation]) * gain;
+        }
     }
 
-    // Monitor Button: if monitoring is off, clear the output channels.
-    if (monitorParameter != nullptr && monitorParameter->load() < 0.5f)
+    slot.position = blockPosition;
+    slot.sampleRate = currentSampleRate;
+    slot.numFrames = static_cast<uint32_t>(storedFrames);
+    slot.numChannels = static_cast<uint32_t>(numChannels);
+    slot.decimation = static_cast<uint32_t>(decimation);
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    extension->snapshotLatest.store(slotIndex, std::memory_order_release);
+    extension->snapshotsPublished.fetch_add(1, std::memory_order_release);
+}
+
+template <typename SampleType>
+bool SlaveAudioSenderAudioProcessor::renderReturnPath (juce::AudioBuffer<SampleType>& buffer, uint64_t blockPosition, int numSamples)
+{
+    const bool enabled = returnPathParameter != nullptr && returnPathParameter->load() >= 0.5f
+                         && extension != nullptr && extension->returnActive.load(std::memory_order_acquire) != 0;
+
+    if (!enabled || numSamples == 0)
     {
-        for (int i = 0; i < totalNumOutputChannels; ++i)
-            buffer.clear(i, 0, numSamples);
+        if (!enabled)
+        {
+            // The next activation starts from a primed returnWriteIndex again
+            returnStarted = false;
+            returnLagPeak = 0;
+        }
+
+        if (!enabled && returnLatency != 0)
+        {
+            // Return path switched off: no more delay to compensate
+            returnLatency = 0;
+            pendingLatencySamples.store(0, std::memory_order_relaxed);
+            triggerAsyncUpdate();
+        }
+        return false;
     }
 
-    // Additional functionality: update buffer size if needed.
-    updateBufferSizeIfNeeded();
+    const int numOutputChannels = getTotalNumOutputChannels();
+    const int returnChannels = juce::jlimit(1, SharedSegmentExtension::RETURN_MAX_CHANNELS,
+                                            static_cast<int>(extension->returnNumChannels.load(std::memory_order_relaxed)));
+    const uint64_t returned = extension->returnWriteIndex.load(std::memory_order_acquire);
+
+    // returnWriteIndex may still hold the previous session's position when returnActive
+    // flips, so it says nothing about the receiver until it moves
+    if (!returnStarted)
+    {
+        returnStarted = true;
+        returnAdvancing = false;
+        returnFirstSeen = returned;
+    }
+    else if (returned != returnFirstSeen)
+    {
+        returnAdvancing = true;
+    }
+
+    // Round-trip latency: one block (the receiver needs a full period to process it) plus
+    // a safety margin, plus the lag behind our write position seen at underruns. It only
+    // grows while the return path is on, so the host isn't asked to re-align on every
+    // fluctuation.
+    const int requiredLatency = static_cast<int>(returnLagPeak) + juce::jmax(currentBlockSize, numSamples) + RETURN_SAFETY_FRAMES;
+    if (requiredLatency > returnLatency)
+    {
+        returnLatency = requiredLatency;
+        extension->returnLatencyFrames.store(static_cast<uint64_t>(returnLatency), std::memory_order_relaxed);
+        pendingLatencySamples.store(returnLatency, std::memory_order_relaxed);
+        triggerAsyncUpdate();
+    }
+
+    const uint64_t readStart = blockPosition - static_cast<uint64_t>(returnLatency);
+    const uint64_t readEnd = readStart + static_cast<uint64_t>(numSamples);
+    const bool available = static_cast<int64_t>(readStart - returnOrigin) >= 0
+                           && static_cast<int64_t>(returned - readEnd) >= 0
+                           && returned - readStart <= SharedSegmentExtension::RETURN_RING_SIZE;
+
+    if (available)
+    {
+        for (int channel = 0; channel < numOutputChannels; ++channel)
+        {
+            SampleType* out = buffer.getWritePointer(channel);
+            const int returnChannel = channel % returnChannels;
+
+            for (int sample = 0; sample < numSamples; ++sample)
+            {
+                const uint64_t slot = (readStart + static_cast<uint64_t>(sample)) & SharedSegmentExtension::RETURN_RING_MASK;
+                out[sample] = static_cast<SampleType>(extension->returnData[slot * static_cast<uint64_t>(returnChannels) + static_cast<uint64_t>(returnChannel)]);
+            }
+
+            lastReturnSample[static_cast<size_t>(juce::jmin(channel, SharedSegmentExtension::RETURN_MAX_CHANNELS - 1))]
+                = static_cast<float>(out[numSamples - 1]);
+        }
+
+        extension->returnReadIndex.store(readEnd, std::memory_order_release);
+        return true;
+    }
+
+    extension->returnUnderruns.fetch_add(1, std::memory_order_relaxed);
+
+    // Late block: allow for the lag the receiver actually ran at, from the next block on.
+    // Positions wrap at 2^64, so they are compared through their signed difference.
+    const auto ahead = static_cast<int64_t>(blockPosition - returned);
+    if (returnAdvancing && ahead > 0)
+        returnLagPeak = juce::jmax(returnLagPeak, juce::jmin<uint64_t>(static_cast<uint64_t>(ahead), SharedSegmentExtension::RETURN_RING_SIZE / 2));
+
+    switch (returnUnderrunParameter != nullptr ? static_cast<int>(returnUnderrunParameter->load()) : 0)
+    {
+        case 1: // Hold the last returned value per channel
+            for (int channel = 0; channel < numOutputChannels; ++channel)
+                juce::FloatVectorOperations::fill(buffer.getWritePointer(channel),
+                                                  static_cast<SampleType>(lastReturnSample[static_cast<size_t>(juce::jmin(channel, SharedSegmentExtension::RETURN_MAX_CHANNELS - 1))]),
+                                                  numSamples);
+            break;
+
+        case 2: // Pass the (post-gain) input through
+            break;
+
+        default:
+            for (int channel = 0; channel < numOutputChannels; ++channel)
+                buffer.clear(channel, 0, numSamples);
+            break;
+    }
+
+    return true;
+}
+
+void SlaveAudioSenderAudioProcessor::handleAsyncUpdate()
+{
+    // setLatencySamples notifies the host, so keep it off the audio thread
+    setLatencySamples(pendingLatencySamples.load(std::memory_order_relaxed));
+}
+
+void SlaveAudioSenderAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processBlockInternal(buffer, midiMessages);
+}
+
+void SlaveAudioSenderAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processBlockInternal(buffer, midiMessages);
+}
+
+template <typename SampleType>
+float SlaveAudioSenderAudioProcessor::calculateRMSLevel (const juce::AudioBuffer<SampleType>& buffer, float gain)
+{
+    // Same scale as AudioLevelUtils (mean RMS over channels in dB, floored at -60 dB),
+    // computed in the buffer's own precision. RMS is linear in gain, so the post-gain
+    // level comes straight from the unscaled input.
+    const int numChannels = buffer.getNumChannels();
+    if (numChannels == 0 || buffer.getNumSamples() == 0)
+        return -60.0f;
+
+    double sum = 0.0;
+    for (int channel = 0; channel < numChannels; ++channel)
+        sum += static_cast<double>(buffer.getRMSLevel(channel, 0, buffer.getNumSamples()));
+
+    return juce::Decibels::gainToDecibels(static_cast<float>(sum / numChannels) * std::abs(gain), -60.0f);
 }
 
 
@@ -439,7 +1695,19 @@ void SlaveAudioSenderAudioProcessor::setStateInformation (const void* data, int
     std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
     if (xmlState.get() != nullptr)
         if (xmlState->hasTagName(parameters.state.getType()))
+        {
             parameters.replaceState(juce::ValueTree::fromXml(*xmlState));
+
+            if (currentSampleRate > 0.0)
+            {
+                suspendProcessing(true);
+                restartNetworkTransport();
+                suspendProcessing(false);
+            }
+
+            restartCaptureTap();
+            restartMetricsExporter();
+        }
 }
 
 //==============================================================================
@@ -2,9 +2,19 @@
 
 #include <JuceHeader.h>
 #include "SharedMemoryManager.h"
+#include "Transport/SharedSegmentExtension.h"
+#include "Transport/audiosender_transport.h"
+#include "NetworkAudioSender.h"
+#include "AggregateLane.h"
+#include "LoudnessAnalyzer.h"
+#include "CaptureTap.h"
+#include "TransportDiagnostics.h"
+#include "MetricsExporter.h"
+#include "SegmentHandshake.h"
 
 
-class SlaveAudioSenderAudioProcessor : public juce::AudioProcessor, public SharedMemoryManager
+class SlaveAudioSenderAudioProcessor : public juce::AudioProcessor, public SharedMemoryManager,
+                                       private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -20,6 +30,8 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override { return true; }
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -78,16 +90,267 @@ public:
             return isMemoryInitialized && sharedData != nullptr && sharedData->isActive.load();
         }
 
+        // Transport float64 samples end to end instead of float32 (see
+        // SharedSegmentExtension::sampleFormat). Saved with the plugin state.
+        void setDoublePrecisionTransport(bool shouldUseFloat64);
+
+        bool isDoublePrecisionTransport() const
+        {
+            return diagnostics.float64.load(std::memory_order_relaxed);
+        }
+
+        // Fixed-period reblocking: publish packets of exactly this many frames (a power
+        // of two, MIN_REBLOCK_FRAMES..MAX_REBLOCK_FRAMES) whatever block sizes the host
+        // delivers, or 0 to publish host blocks as they come (see
+        // SharedSegmentExtension::reblockFrames). Saved with the plugin state.
+        void setReblockPeriod(int frames);
+
+        int getReblockPeriod() const
+        {
+            return static_cast<int>(parameters.state.getProperty("reblockFrames", 0));
+        }
+
+        // While no receiver is attached, skip the ring, event and snapshot writes (metering,
+        // the network sender and the output keep running) and restart the stream with a
+        // RESYNC event when one appears. On by default; saved with the plugin state.
+        void setIdleWithoutReceiver(bool shouldIdle);
+
+        bool getIdleWithoutReceiver() const
+        {
+            return static_cast<bool>(parameters.state.getProperty("idleWithoutReceiver", true));
+        }
+
+        // Anonymous segment mode (Linux): keep the segment in a sealed memfd instead of
+        // under SHARED_MEMORY_NAME, and hand it and a wakeup eventfd to receivers of the
+        // same user over a Unix socket (see ast_connect()). An empty socketPath picks an
+        // abstract "@audiosender-<pid>-<n>" name. Takes effect at the next prepareToPlay,
+        // which re-creates the segment; saved with the plugin state.
+        void setAnonymousSegment(bool shouldUseAnonymous, const juce::String& socketPath = {});
+
+        bool isAnonymousSegment() const
+        {
+            return anonymousSegment;
+        }
+
+        // Where receivers connect while the anonymous segment is live, otherwise empty
+        juce::String getHandshakeSocketPath() const
+        {
+            return anonymousSegment && isMemoryInitialized ? handshakePath : juce::String();
+        }
+
+        // Network transport (UDP/RTP), runs alongside the shared memory ring.
+        // The settings are saved with the plugin state.
+        bool startNetworkTransport(const juce::String& host, int port, double packetTimeMs);
+        void stopNetworkTransport();
+
+        bool isNetworkTransportActive() const
+        {
+            return networkSender.isRunning();
+        }
+
+        // Aggregation: also write every block, aligned to the host sample position, into
+        // a lane of the segment shared by all instances (see SharedAggregateSegment.h),
+        // so one receiver reads every instance up to a single cursor. The settings are
+        // saved with the plugin state.
+        bool startAggregation(const juce::String& laneName);
+        void stopAggregation();
+
+        bool isAggregationActive() const
+        {
+            return aggregateLane.isOpen();
+        }
+
+        // Capture-to-disk tap of the published stream (background reader, debugging aid).
+        // The settings are saved with the plugin state.
+        bool startCaptureTap(const juce::File& directory, juce::int64 maxFileBytes, double maxFileSeconds);
+        void stopCaptureTap();
+
+        bool isCaptureTapActive() const
+        {
+            return captureTap.isRunning();
+        }
+
+        // Local metrics exporter (Prometheus text / JSON over a Unix socket, or a
+        // 127.0.0.1 port if socketPath is empty). The settings are saved with the plugin state.
+        bool startMetricsExporter(const juce::String& socketPath, int port);
+        void stopMetricsExporter();
+
+        bool isMetricsExporterActive() const
+        {
+            return metricsExporter.isRunning();
+        }
+
+        // Transport diagnostics for the editor and metrics exporter (lock-free reads only)
+        void getDiagnostics(TransportDiagnosticsSnapshot& snapshot) const;
+
+        void resetDiagnosticsPeaks()
+        {
+            diagnostics.callbackPeakMs.store(0.0, std::memory_order_relaxed);
+        }
+
+        // EBU R128 loudness and true peak per enabled input bus, analysed on a background
+        // thread; also published to receivers (SharedSegmentExtension::loudness).
+        int getNumLoudnessBuses() const                        { return loudnessAnalyzer.getNumBuses(); }
+        LoudnessAnalyzer::Results getLoudness(int bus) const   { return loudnessAnalyzer.getResults(bus); }
+
+        // Restarts integrated loudness and the true-peak hold
+        void resetLoudness()                                   { loudnessAnalyzer.reset(); }
+
 
 
 private:
 
     static constexpr const char* SHARED_MEMORY_NAME = "/my_shared_audio_buffer";
+
+    // The extension starts where SharedAudioData's legacy audioData/blockHeaders arrays
+    // did (layout version 13+): nothing reads them any more, so the segment no longer
+    // reserves them. initializeSharedMemory checks that every field still used lies before.
+    static constexpr size_t LEGACY_ARRAYS_OFFSET = std::min(offsetof(SharedAudioData, audioData), offsetof(SharedAudioData, blockHeaders));
+    static constexpr size_t EXTENSION_OFFSET = SharedSegmentExtension::offsetFor(LEGACY_ARRAYS_OFFSET);
+
+    // The ring holds at least this much audio at the negotiated format (see configureRing)
+    static constexpr int MAX_TARGET_LATENCY_MS = 200;
+    static constexpr uint64_t MIN_RING_FRAMES = 1024;
+
+    // Total input channels across all buses (e.g. 7.1.4 stems or third-order ambisonics)
+    static constexpr int MAX_SEND_CHANNELS = SharedSegmentExtension::MAX_CHANNELS;
+
+    static constexpr int MIN_REBLOCK_FRAMES = 16;
+    static constexpr int MAX_REBLOCK_FRAMES = 4096;
+
+    // Offline renders wait this long for the receiver to free space before dropping a block
+    static constexpr int OFFLINE_WAIT_TIMEOUT_MS = 2000;
+
+    // Overruns are logged at most this often, with the count since the last message
+    static constexpr double OVERRUN_LOG_INTERVAL_MS = 1000.0;
+
+    SharedSegmentExtension* extension = nullptr;
+
+    // Writer side of the ring protocol (see Source/Transport); attached whenever the segment is mapped
+    ast_ring* transportRing = nullptr;
+
+    // Audio ring layout inside the segment (see SharedSegmentExtension)
+    ast_layout computeRingLayout(int numChannels, double sampleRate, int maxBlockSize) const;
+    bool configureRing(const ast_layout& layout);
+    bool growSegment(size_t newBytes);
+
+    using ChannelMap = std::array<SharedSegmentExtension::ChannelInfo, SharedSegmentExtension::MAX_CHANNELS>;
+    int buildChannelMap(ChannelMap& map) const;
+
+    size_t segmentBytes = 0;
+    bool transportFloat64 = false;
+
+    // Anonymous segment mode: shm_fd is a memfd, and the handshake hands it out
+    bool anonymousSegment = false;
+    int wakeupFd = -1;                   // Eventfd the ring signals while a receiver sleeps on it
+    juce::String handshakePath;
+    SegmentHandshake segmentHandshake;
+    bool anonymousRequested = false;     // What the segment was created for, to notice changes
+    juce::String requestedSocketPath;
+    bool segmentModeChanged() const;
+    uint64_t ringCapacity = 0;
+    int ringStride = 0;
+
+    // Fixed-period reblocking; the packet being filled stays reserved across host blocks
+    int reblockFrames = 0;               // Set in prepareToPlay
+    ast_span pendingPacket {};           // Audio thread only
+    uint32_t pendingPacketFrames = 0;    // Audio thread only
+    bool packetPending = false;          // Audio thread only
+
+    // After an offline wait times out, blocks drop without waiting until the receiver
+    // moves readIndex again or the host leaves offline mode. Audio thread only.
+    bool offlineWaitSuspended = false;
+    uint64_t offlineStalledReadIndex = 0;
+
+    double lastOverrunLogMs = 0.0;       // Audio thread only
+    uint64_t overrunsSinceLog = 0;
+
+    // Receiver presence, from readIndex and SharedSegmentExtension::readerHeartbeat
+    bool idleWithoutReceiver = true;     // Set in prepareToPlay
+    bool receiverPresent = false;        // Audio thread only, like the rest of this group
+    uint64_t presenceReadIndex = 0;
+    uint64_t presenceHeartbeat = 0;
+    double readerLastSeenMs = 0.0;
+    double lastProbeMs = 0.0;
+    uint64_t idleFrames = 0;             // Stream frames skipped since the receiver left
+    bool resyncPending = false;
+    uint64_t pendingResyncFrames = 0;
+
+    bool shouldPublishBlock (int numSamples);
+
+    template <typename SampleType>
+    void processBlockInternal (juce::AudioBuffer<SampleType>&, juce::MidiBuffer&);
+
+    template <typename SampleType>
+    uint64_t publishToRing (const juce::AudioBuffer<SampleType>&, const juce::MidiBuffer&, int numSamples, float blockGain,
+                            BlockInstrumentation::Scope& timing);
+
+    template <typename SampleType>
+    void renderInputIntoSpan (const juce::AudioBuffer<SampleType>&, const ast_span& span, int sourceOffset, SampleType blockGain);
+
+    // Event side channel (MIDI, transport, parameters); audio thread only
+    void publishEvents(const juce::MidiBuffer& midiMessages, uint64_t blockPosition, int numSamples);
+    SharedEventRecord::TransportPayload lastTransport {};
+    bool lastTransportValid = false;
+    juce::int64 expectedTimeInSamples = 0;
+    std::vector<float> lastParameterValues;
+
+    // Latest-block snapshot mailbox for observers; audio thread only
+    template <typename SampleType>
+    void publishSnapshot (const juce::AudioBuffer<SampleType>&, uint64_t blockPosition, int numChannels, int numSamples, float gain);
+
+    // Return path (processed audio from the receiver back into our output)
+    template <typename SampleType>
+    bool renderReturnPath (juce::AudioBuffer<SampleType>&, uint64_t blockPosition, int numSamples);
+    void handleAsyncUpdate() override;
+
+    static constexpr int RETURN_SAFETY_FRAMES = 32;
+    std::atomic<float>* returnPathParameter = nullptr;
+    std::atomic<float>* returnUnderrunParameter = nullptr;
+    int returnLatency = 0;                         // Audio thread only
+    uint64_t returnLagPeak = 0;                    // Audio thread only; grows on underruns
+    uint64_t returnFirstSeen = 0;                  // returnWriteIndex when the return path came on
+    bool returnStarted = false;                    // Audio thread only
+    bool returnAdvancing = false;                  // returnWriteIndex has moved since returnFirstSeen
+    uint64_t returnOrigin = 0;                     // Ring position the return stream can start at
+    std::atomic<int> pendingLatencySamples { 0 };  // Handed to setLatencySamples on the message thread
+    std::array<float, SharedSegmentExtension::RETURN_MAX_CHANNELS> lastReturnSample {};
+
+    template <typename SampleType>
+    static float calculateRMSLevel (const juce::AudioBuffer<SampleType>&, float gain);
     double currentSampleRate = 0.0;
     int currentBlockSize = 0;
     int currentNumChannels = 0;
     void updateBufferSizeIfNeeded();
 
+    // Diagnostics, recorded once per block by the audio thread
+    TransportDiagnostics diagnostics;
+    BlockInstrumentation instrumentation;
+    uint64_t lastCallbackStartNs = 0;   // Audio thread only
+    uint64_t lastSeenReadIndex = 0;     // Audio thread only
+
+    // Network transport
+    NetworkAudioSender networkSender;
+    bool restartNetworkTransport();
+
+    // Loudness analysis; the audio thread copies new results into the segment
+    LoudnessAnalyzer loudnessAnalyzer;
+    void restartLoudnessAnalyzer();
+    void publishLoudness();
+    uint32_t publishedLoudnessVersion = 0;   // Audio thread only
+
+    // Aggregation lane
+    AggregateLane aggregateLane;
+    bool restartAggregation();
+
+    // Capture tap
+    CaptureTap captureTap;
+    bool restartCaptureTap();
+
+    // Metrics exporter
+    MetricsExporter metricsExporter;
+    bool restartMetricsExporter();
+
     // UI Parameters:
     juce::AudioProcessorValueTreeState parameters;
     std::atomic<float>* monitorParameter = nullptr;
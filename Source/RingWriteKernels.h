@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Transport/audiosender_transport.h"
+
+//==============================================================================
+// Kernels that copy planar host channels into the interleaved shared ring.
+//
+// The sample format conversion (e.g. double host buffers into a float ring, or float
+// host buffers into a float64 ring) and the plugin's gain are applied inside the same
+// loop, so a block is read and written exactly once. Each write goes into a span reserved from the transport
+// ring, which is split at the ring wrap into at most two contiguous runs, so the inner
+// loops have no masking and unit-stride reads, which lets the compiler vectorise them;
+// stereo gets its own loop since that is the common case and interleaves with a plain
+// zip. Wide layouts (surround stems, ambisonics) are written in tiles of frames so the
+// cost per sample stays flat as channels are added.
+//==============================================================================
+namespace RingWriteKernels
+{
+    static constexpr int WIDE_CHANNEL_THRESHOLD = 8;
+    static constexpr int TILE_FRAMES = 32;
+
+    template <typename RingSample, typename HostSample>
+    inline void interleaveSpan (RingSample* dest, int stride,
+                                const HostSample* const* channels, int numChannels,
+                                int sourceOffset, int numFrames, HostSample gain = HostSample (1))
+    {
+        if (numChannels == 2 && stride == 2)
+        {
+            const HostSample* left  = channels[0] + sourceOffset;
+            const HostSample* right = channels[1] + sourceOffset;
+
+            for (int frame = 0; frame < numFrames; ++frame)
+            {
+                dest[2 * frame]     = static_cast<RingSample>(left[frame] * gain);
+                dest[2 * frame + 1] = static_cast<RingSample>(right[frame] * gain);
+            }
+            return;
+        }
+
+        if (numChannels > WIDE_CHANNEL_THRESHOLD)
+        {
+            // One channel at a time would stream the whole destination span through the
+            // cache once per channel. A tile of TILE_FRAMES frames (at most 16 KB at 64
+            // channels of float64) stays in L1 while every channel is written into it.
+            for (int tileStart = 0; tileStart < numFrames; tileStart += TILE_FRAMES)
+            {
+                const int tileFrames = numFrames - tileStart < TILE_FRAMES ? numFrames - tileStart : TILE_FRAMES;
+                RingSample* tile = dest + static_cast<size_t>(tileStart) * static_cast<size_t>(stride);
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                {
+                    const HostSample* source = channels[channel] + sourceOffset + tileStart;
+                    RingSample* out = tile + channel;
+
+                    for (int frame = 0; frame < tileFrames; ++frame)
+                        out[static_cast<size_t>(frame) * static_cast<size_t>(stride)] = static_cast<RingSample>(source[frame] * gain);
+                }
+            }
+            return;
+        }
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const HostSample* source = channels[channel] + sourceOffset;
+            RingSample* out = dest + channel;
+
+            for (int frame = 0; frame < numFrames; ++frame)
+                out[static_cast<size_t>(frame) * static_cast<size_t>(stride)] = static_cast<RingSample>(source[frame] * gain);
+        }
+    }
+
+    // Writes span.frames frames of numChannels planar channels, starting at frame
+    // sourceOffset and scaled by gain, into channel slots [channelOffset, channelOffset +
+    // numChannels) of a span reserved from the transport ring (ast_write_reserve), in the
+    // span's sample format. The span is already split at the ring wrap.
+    template <typename HostSample>
+    inline void interleaveIntoSpan (const ast_span& span, int channelOffset,
+                                    const HostSample* const* channels, int numChannels,
+                                    int sourceOffset = 0, HostSample gain = HostSample (1))
+    {
+        const int stride = static_cast<int>(span.stride);
+
+        for (int run = 0; run < 2; ++run)
+        {
+            const int runFrames = static_cast<int>(span.run_frames[run]);
+            if (runFrames == 0)
+                continue;
+
+            if (span.bytes_per_sample == sizeof(double))
+                interleaveSpan(static_cast<double*>(span.data[run]) + channelOffset, stride, channels, numChannels, sourceOffset, runFrames, gain);
+            else
+                interleaveSpan(static_cast<float*>(span.data[run]) + channelOffset, stride, channels, numChannels, sourceOffset, runFrames, gain);
+
+            sourceOffset += runFrames;
+        }
+    }
+}
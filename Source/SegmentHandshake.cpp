@@ -0,0 +1,167 @@
+#include "SegmentHandshake.h"
+#include "Transport/SharedSegmentExtension.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+    // Same rule as ast_connect(): '@' names the abstract namespace on Linux only, and
+    // is an ordinary first character of a file path everywhere else
+    bool isAbstractPath (const char* path)
+    {
+       #if defined (__linux__)
+        return path[0] == '@';
+       #else
+        juce::ignoreUnused(path);
+        return false;
+       #endif
+    }
+
+    // Removes path only if it is a socket, so a mistyped setting can't delete a file.
+    // False if something else is there; a missing path is fine.
+    bool unlinkSocket (const char* path)
+    {
+        struct stat info;
+        if (lstat(path, &info) == -1)
+            return errno == ENOENT;
+
+        return S_ISSOCK(info.st_mode) && (unlink(path) == 0 || errno == ENOENT);
+    }
+}
+
+SegmentHandshake::SegmentHandshake()
+    : juce::Thread("AudioSender handshake")
+{
+}
+
+SegmentHandshake::~SegmentHandshake()
+{
+    stop();
+}
+
+bool SegmentHandshake::start(const juce::String& socketPath)
+{
+    stop();
+
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+
+    const auto rawPath = socketPath.toRawUTF8();
+    const size_t pathLength = std::strlen(rawPath);
+    if (pathLength == 0 || pathLength >= sizeof(address.sun_path))
+    {
+        juce::Logger::writeToLog("Segment handshake: bad socket path: " + socketPath);
+        return false;
+    }
+
+    std::memcpy(address.sun_path, rawPath, pathLength);
+    auto addressLength = static_cast<socklen_t>(sizeof(address));
+    const bool isAbstract = isAbstractPath(rawPath);
+
+    if (isAbstract)
+    {
+        // Same convention as ast_connect(): the name without the '@', after a zero byte
+        address.sun_path[0] = '\0';
+        addressLength = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + pathLength);
+    }
+    else if (!unlinkSocket(rawPath))
+    {
+        // Either a stale socket from a crashed run we couldn't remove, which would make
+        // bind fail, or not a socket at all and not ours to delete
+        juce::Logger::writeToLog("Segment handshake: " + socketPath + " exists and isn't a removable socket");
+        return false;
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd != -1)
+        fcntl(listenFd, F_SETFD, FD_CLOEXEC);
+
+    // Only the owner may connect to a file socket. The umask is process wide, so this
+    // chmods after bind instead; ast_handshake_send() checks the peer's uid regardless.
+    const bool bound = listenFd != -1 && bind(listenFd, reinterpret_cast<const sockaddr*>(&address), addressLength) == 0
+                       && (isAbstract || chmod(rawPath, 0600) == 0);
+
+    if (!bound || listen(listenFd, 8) == -1)
+    {
+        juce::Logger::writeToLog("Segment handshake: failed to listen on " + socketPath + ": " + juce::String(strerror(errno)));
+        if (listenFd != -1)
+            close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    path = socketPath;
+    juce::Logger::writeToLog("Segment handshake listening on " + path);
+    return startThread(juce::Thread::Priority::low);
+}
+
+void SegmentHandshake::stop()
+{
+    stopThread(2000);
+
+    if (listenFd != -1)
+    {
+        close(listenFd);
+        listenFd = -1;
+
+        if (!isAbstractPath(path.toRawUTF8()))
+            unlinkSocket(path.toRawUTF8());
+    }
+
+    const juce::ScopedLock scopedLock(lock);
+    segment = -1;
+    wakeup = -1;
+}
+
+void SegmentHandshake::publish(int segmentFd, int wakeupFd, uint64_t extensionOffset, uint64_t segmentBytes)
+{
+    const juce::ScopedLock scopedLock(lock);
+    info.magic = AST_HANDSHAKE_MAGIC;
+    info.layout_version = SharedSegmentExtension::LAYOUT_VERSION;
+    info.extension_offset = extensionOffset;
+    info.segment_bytes = segmentBytes;
+    segment = segmentFd;
+    wakeup = wakeupFd;
+}
+
+void SegmentHandshake::run()
+{
+    while (!threadShouldExit())
+    {
+        // Wake up regularly so stop() never waits on a quiet socket
+        pollfd listening { listenFd, POLLIN, 0 };
+        if (poll(&listening, 1, POLL_MS) <= 0 || (listening.revents & POLLIN) == 0)
+            continue;
+
+        const int clientFd = accept(listenFd, nullptr, nullptr);
+        if (clientFd == -1)
+            continue;
+
+        int result = AST_ERR_INVALID;
+        {
+            const juce::ScopedLock scopedLock(lock);
+            if (segment != -1)
+                result = ast_handshake_send(clientFd, &info, segment, wakeup);
+        }
+        close(clientFd);
+
+        if (result == AST_OK)
+        {
+            served.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            refused.fetch_add(1, std::memory_order_relaxed);
+            if (result == AST_ERR_DENIED)
+                juce::Logger::writeToLog("Segment handshake: refused a connection from another user");
+        }
+    }
+}
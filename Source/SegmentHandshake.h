@@ -0,0 +1,51 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Transport/audiosender_transport.h"
+
+//==============================================================================
+// Hands the anonymous segment to receivers (see ast_connect()).
+//
+// Listens on a Unix domain socket and answers every connection of the same user with
+// the segment's memfd, the wakeup eventfd and the layout, then hangs up. On Linux a
+// socket path starting with '@' lives in the abstract namespace and disappears with
+// the process; any other path (including '@' ones elsewhere) is a file, created mode
+// 0600 and removed by stop(). Only an existing socket is ever replaced or removed:
+// start() fails if something else is at the path.
+//==============================================================================
+class SegmentHandshake : private juce::Thread
+{
+public:
+    SegmentHandshake();
+    ~SegmentHandshake() override;
+
+    bool start(const juce::String& socketPath);
+    void stop();
+
+    bool isRunning() const { return isThreadRunning(); }
+
+    // What new receivers get from now on. The fds stay owned by the caller, who must
+    // stop() the handshake before closing them.
+    void publish(int segmentFd, int wakeupFd, uint64_t extensionOffset, uint64_t segmentBytes);
+
+    uint64_t getConnectionsServed() const  { return served.load(std::memory_order_relaxed); }
+    uint64_t getConnectionsRefused() const { return refused.load(std::memory_order_relaxed); }
+
+private:
+    void run() override;
+
+    static constexpr int POLL_MS = 200;
+
+    juce::String path;
+    int listenFd = -1;
+
+    juce::CriticalSection lock;
+    ast_handshake info {};
+    int segment = -1;
+    int wakeup = -1;
+
+    std::atomic<uint64_t> served { 0 };
+    std::atomic<uint64_t> refused { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SegmentHandshake)
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+//==============================================================================
+// Shared memory segment that aggregates the audio of several AudioSender instances.
+//
+// Every instance with aggregation enabled claims a lane in the one segment of its user
+// (see nameFor(); created mode 0600) and writes each block (float32, interleaved, numChannels per frame) at the position
+// the host gave it, so the blocks of one host cycle land in the same slots of every
+// lane. After each write the writing lane advances completePosition to the end of
+// what every live lane has written. A receiver therefore reads all lanes up to a
+// single cursor, with no per-instance polling and no alignment by timestamp:
+//
+//     uint32_t seen = segment->completeNotify.load();
+//     while (segment->completePosition.load() == readPosition)
+//     {
+//         segment->waiters.fetch_add(1);
+//         SharedMemoryWait::waitWhileEqual(segment->completeNotify, seen, 100);
+//         segment->waiters.fetch_sub(1);
+//         seen = segment->completeNotify.load();
+//     }
+//     // every live lane holds [readPosition, completePosition)
+//
+// Positions are host sample positions plus timelineOffset. When the host jumps back
+// (loop, locate) or stops moving its position, the first lane to notice raises the
+// offset so that positions never go backwards. The other lanes of the same cycle
+// pick up the new offset, so the lanes stay aligned.
+//
+// Lanes never wait for the receiver: frames older than CAPACITY_FRAMES are simply
+// overwritten. A lane that hasn't written for LANE_TIMEOUT_MS (bypassed, removed or
+// crashed) stops holding completePosition back until it writes again. The timeout is
+// longer than the ring at high rates, so a lane more than MAX_LANE_LAG_FRAMES behind the
+// furthest live lane is let go as well, before the others lap it.
+//
+// The segment's sample rate belongs to the instances that have it open (see format):
+// the first to open sets it, the rest must match, and the last to close clears it, so
+// the next session may run at another rate.
+//==============================================================================
+struct SharedAggregateSegment
+{
+    static constexpr const char* NAME_PREFIX = "/audiosender_aggregate-";
+    static constexpr uint32_t MAGIC          = 0x41534147; // 'ASAG'
+    static constexpr uint32_t LAYOUT_VERSION = 2;
+
+    static constexpr int MAX_LANES          = 16;
+    static constexpr int MAX_LANE_CHANNELS  = 8;
+    static constexpr uint64_t CAPACITY_FRAMES = 16384;   // Per lane, power of two
+    static constexpr uint64_t CAPACITY_MASK   = CAPACITY_FRAMES - 1;
+    static constexpr int LANE_TIMEOUT_MS    = 500;
+    static constexpr uint64_t MAX_LANE_LAG_FRAMES = CAPACITY_FRAMES / 2;
+
+    struct Lane
+    {
+        enum State : uint32_t
+        {
+            FREE    = 0,
+            CLAIMED = 1
+        };
+
+        alignas(64) std::atomic<uint32_t> state;
+        std::atomic<uint32_t> numChannels;        // Interleaved channels per frame
+        std::atomic<int32_t> ownerPid;            // Lanes of dead processes are reclaimed
+        std::atomic<uint32_t> sourceChannels;     // The instance's channels; more than numChannels if truncated
+        std::atomic<uint64_t> startPosition;      // First position the lane wrote
+        std::atomic<uint64_t> writtenPosition;    // End of the lane's audio (release store)
+        std::atomic<uint64_t> lastWriteNs;        // nowNs() of the last write; 0 until the first
+        char name[32];                            // Null-terminated, for the receiver's display
+    };
+
+    // NAME_PREFIX followed by the uid in decimal: one segment per user, so another user
+    // can neither read the audio nor squat the name
+    static void nameFor (uint32_t uid, char* dest, size_t size)
+    {
+        std::snprintf(dest, size, "%s%u", NAME_PREFIX, static_cast<unsigned>(uid));
+    }
+
+    // format packs the sample rate (float bits, high word) with the number of open
+    // lanes (low word), so setting the rate and joining it are one compare-and-swap
+    static uint64_t packFormat (double sampleRate, uint32_t openLanes)
+    {
+        const float rate = static_cast<float>(sampleRate);
+        uint32_t bits = 0;
+        std::memcpy(&bits, &rate, sizeof(bits));
+        return (static_cast<uint64_t>(bits) << 32) | openLanes;
+    }
+
+    static double sampleRateOf (uint64_t format)
+    {
+        const uint32_t bits = static_cast<uint32_t>(format >> 32);
+        float rate = 0.0f;
+        std::memcpy(&rate, &bits, sizeof(rate));
+        return rate;
+    }
+
+    static uint32_t openLanesOf (uint64_t format)
+    {
+        return static_cast<uint32_t>(format);
+    }
+
+    // steady_clock, i.e. CLOCK_MONOTONIC on Linux, which every process shares
+    static uint64_t nowNs()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    static bool isLive (const Lane& lane, uint64_t now)
+    {
+        const uint64_t lastWrite = lane.lastWriteNs.load(std::memory_order_acquire);
+        return lane.state.load(std::memory_order_acquire) == Lane::CLAIMED && lastWrite != 0
+               && now - lastWrite < static_cast<uint64_t>(LANE_TIMEOUT_MS) * 1000000;
+    }
+
+    // Frame at position in a lane's audio; numChannels floats follow it
+    float* laneFrame (int laneIndex, uint64_t position)
+    {
+        return laneData[laneIndex] + (position & CAPACITY_MASK) * static_cast<uint64_t>(lanes[laneIndex].numChannels.load(std::memory_order_relaxed));
+    }
+
+    std::atomic<uint32_t> magic;                  // Set (release) last, once the segment is initialised
+    std::atomic<uint32_t> layoutVersion;
+    std::atomic<uint32_t> periodFrames;           // Receiver wakeup period (0 = every block)
+    std::atomic<uint32_t> reserved;
+    std::atomic<uint64_t> format;                 // See packFormat(); 0 while no lane is open
+
+    alignas(64) std::atomic<uint64_t> timelineOffset;   // Added to host positions; only grows
+
+    // Every live lane has written up to here (exclusive). completeNotify is bumped each
+    // time the cursor crosses a multiple of periodFrames, and sleepers on it are woken
+    // only while waiters is nonzero, so lanes make no system calls without a receiver.
+    alignas(64) std::atomic<uint64_t> completePosition;
+    std::atomic<uint32_t> completeNotify;
+    std::atomic<uint32_t> waiters;
+
+    alignas(64) Lane lanes[MAX_LANES];
+
+    alignas(64) float laneData[MAX_LANES][CAPACITY_FRAMES * MAX_LANE_CHANNELS];
+};
+
+static_assert ((SharedAggregateSegment::CAPACITY_FRAMES & SharedAggregateSegment::CAPACITY_MASK) == 0,
+               "The aggregate capacity must be a power of two");
+static_assert (std::atomic<uint64_t>::is_always_lock_free && std::atomic<double>::is_always_lock_free,
+               "Shared atomics must be lock-free to work across processes");
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined (__linux__)
+ #include <linux/futex.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+ #include <ctime>
+#endif
+
+//==============================================================================
+// Cross-process wait/wake on a 32-bit word that lives in shared memory.
+//
+// On Linux this is a (non-private) futex, so the waiting thread sleeps in the kernel
+// until the other process wakes it. Other platforms have no public cross-process
+// futex, so the wait falls back to a short sleep before returning - the caller
+// re-checks its condition either way, so it never busy-spins.
+//==============================================================================
+namespace SharedMemoryWait
+{
+    // Sleeps while word == expected, for at most timeoutMs. Spurious returns are allowed.
+    inline void waitWhileEqual (std::atomic<uint32_t>& word, uint32_t expected, int timeoutMs)
+    {
+        if (word.load(std::memory_order_acquire) != expected || timeoutMs <= 0)
+            return;
+
+       #if defined (__linux__)
+        timespec timeout;
+        timeout.tv_sec  = timeoutMs / 1000;
+        timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+       #else
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+       #endif
+    }
+
+    // Wakes every thread (in any process) sleeping on word.
+    inline void wakeAll (std::atomic<uint32_t>& word)
+    {
+       #if defined (__linux__)
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+       #else
+        (void) word;
+       #endif
+    }
+
+    // Bumps word and wakes its waiters.
+    inline void notify (std::atomic<uint32_t>& word)
+    {
+        word.fetch_add(1, std::memory_order_release);
+        wakeAll(word);
+    }
+}
@@ -0,0 +1,352 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//==============================================================================
+// Fixed-size record carried by the event side channel (see SharedSegmentExtension).
+//
+// samplePosition is in the same frame units as writeIndex/readIndex, so an event
+// with position P applies to the audio frame at ring position P.
+//==============================================================================
+struct SharedEventRecord
+{
+    enum Type : uint32_t
+    {
+        MIDI      = 1,  // data = raw MIDI bytes (size bytes, at most 16)
+        TRANSPORT = 2,  // data = TransportPayload
+        PARAMETER = 3,  // data = ParameterPayload
+        RESYNC    = 4   // data = ResyncPayload (version 10+)
+    };
+
+    struct TransportPayload
+    {
+        enum Flags : uint32_t { PLAYING = 1, RECORDING = 2, LOOPING = 4, POSITION_JUMP = 8 };
+
+        double ppqPosition;
+        float  bpm;
+        uint32_t flags;
+    };
+
+    struct ParameterPayload
+    {
+        uint32_t parameterIndex;
+        float    value;          // Normalised 0..1
+    };
+
+    // The stream restarts at samplePosition after the sender sat idle without a
+    // receiver: the ring was emptied, sequence numbers start again from 0, and
+    // skippedFrames frames of host audio were never published.
+    struct ResyncPayload
+    {
+        uint64_t skippedFrames;
+    };
+
+    uint64_t samplePosition;
+    uint32_t type;
+    uint32_t size;
+    uint8_t  data[16];
+};
+
+//==============================================================================
+// Per-block metadata in the audio ring (version 8+; older layouts used
+// SharedAudioData::AudioBlockHeader). The header for a block that starts at ring
+// position P lives in header slot (P & (ringCapacityFrames - 1)).
+//==============================================================================
+struct SharedBlockHeader
+{
+    uint64_t sequenceNumber;
+    double   timestamp;       // Seconds, sender's Time::getMillisecondCounterHiRes() clock
+    uint32_t blockSize;       // Frames in the block
+    uint32_t numChannels;     // == ringStride
+};
+
+static_assert (sizeof (SharedBlockHeader) == 24, "Block headers are a fixed 24 bytes");
+static_assert (sizeof (SharedEventRecord) == 32, "Event records are a fixed 32 bytes");
+static_assert (sizeof (SharedEventRecord::TransportPayload) <= 16, "Payload must fit the record");
+static_assert (sizeof (SharedEventRecord::ResyncPayload) <= 16, "Payload must fit the record");
+
+//==============================================================================
+// Extra control block that lives in the same shared memory segment as
+// SharedAudioData, directly after its control fields. Since version 13 it starts where
+// the legacy SharedAudioData::audioData/blockHeaders arrays did (offsetFor() of the
+// first array's offset), so the segment no longer reserves them; before that it sat
+// at offsetFor(MAX_BUFFER_SIZE).
+//
+// Receivers that only know about SharedAudioData are no longer supported: the audio
+// moved out of SharedAudioData::audioData/blockHeaders into the ring region described
+// below. So that such a receiver reads nothing rather than stale memory, the sender
+// holds the legacy numChannels and bufferSize at 0; writeIndex, readIndex, isActive,
+// sampleRate and the metrics stay live, since the ring protocol uses them. Receivers
+// check magic/layoutVersion before using anything in here.
+//==============================================================================
+struct SharedSegmentExtension
+{
+    static constexpr uint32_t MAGIC          = 0x41534558; // 'ASEX'
+    static constexpr uint32_t LAYOUT_VERSION = 13;
+
+    // Offset of the extension from the start of the mapping, rounded up so the
+    // atomics below never share a cache line with the tail of SharedAudioData.
+    static constexpr size_t offsetFor (size_t baseSize)
+    {
+        return (baseSize + 63) & ~static_cast<size_t>(63);
+    }
+
+    // Offset of the dynamically sized audio ring region (version 5+), page aligned.
+    static constexpr size_t ringRegionOffsetFor (size_t baseSize)
+    {
+        return (offsetFor(baseSize) + sizeof(SharedSegmentExtension) + 4095) & ~static_cast<size_t>(4095);
+    }
+
+    std::atomic<uint32_t> magic;
+    std::atomic<uint32_t> layoutVersion;
+
+    //==============================================================================
+    // Offline (non-realtime) render flow control.
+    //
+    // While offlineMode is 1 the sender never drops blocks: when the ring is full it
+    // sleeps on readerNotify until the receiver frees space (or the timeout expires).
+    // Receivers should increment readerNotify and wake it (futex on Linux) after every
+    // readIndex update. Likewise the sender increments and wakes writerNotify after
+    // each published block while offline, so receivers can block instead of polling.
+    std::atomic<uint32_t> offlineMode;
+    std::atomic<uint32_t> readerNotify;
+    std::atomic<uint32_t> writerNotify;
+    std::atomic<uint32_t> reserved0;
+
+    std::atomic<uint64_t> offlineWaits;     // Blocks that had to wait for space
+    std::atomic<uint64_t> offlineTimeouts;  // Waits that gave up and dropped the block
+
+    //==============================================================================
+    // Audio ring geometry (version 2+, dynamically sized since version 5).
+    //
+    // The ring no longer lives in SharedAudioData::audioData/blockHeaders. It is a
+    // region after this block, sized from the channel count, sample rate and maximum
+    // target latency: ringCapacityFrames (a power of two) SharedBlockHeaders at
+    // ringHeadersOffset, followed by ringCapacityFrames * ringStride interleaved samples
+    // (float32 or float64, see sampleFormat) at ringDataOffset. Offsets are in bytes from
+    // the start of the segment; both arrays are indexed with
+    // (position & (ringCapacityFrames - 1)). segmentBytes is the size to map.
+    //
+    // Resize protocol: the sender makes ringGeneration odd, grows the segment if needed
+    // (ftruncate; it never shrinks in place), publishes the new geometry, sets
+    // readIndex = writeIndex so the ring restarts empty, then makes ringGeneration even
+    // and bumps configurationCounter. Receivers read ringGeneration before and after each
+    // read and discard the read (without storing readIndex) if it was odd or changed;
+    // on a change they remap segmentBytes and reload the geometry. Where the segment
+    // can't grow in place (macOS shm objects can only be sized once) the sender creates
+    // a fresh segment instead, and receivers reattach when they see isActive go false.
+    static constexpr uint32_t SAMPLE_FORMAT_FLOAT32 = 0;
+    static constexpr uint32_t SAMPLE_FORMAT_FLOAT64 = 1;
+
+    std::atomic<uint32_t> sampleFormat;
+    std::atomic<uint32_t> ringStride;
+    std::atomic<uint64_t> ringCapacityFrames;
+    std::atomic<uint64_t> ringHeadersOffset;
+    std::atomic<uint64_t> ringDataOffset;
+    std::atomic<uint64_t> segmentBytes;
+    alignas(64) std::atomic<uint64_t> ringGeneration;
+
+    //==============================================================================
+    // Event side channel (version 3+): a second single-producer/single-consumer ring
+    // of SharedEventRecords, published with the same index protocol as the audio ring.
+    // Events for a block are always published before that block's writeIndex store,
+    // so a receiver that has seen audio up to position P also sees every event < P.
+    static constexpr uint64_t EVENT_RING_SIZE = 4096;
+    static constexpr uint64_t EVENT_RING_MASK = EVENT_RING_SIZE - 1;
+
+    alignas(64) std::atomic<uint64_t> eventWriteIndex;
+    alignas(64) std::atomic<uint64_t> eventReadIndex;
+    std::atomic<uint64_t> eventOverruns;     // Events dropped because the event ring was full
+
+    SharedEventRecord events[EVENT_RING_SIZE];
+
+    //==============================================================================
+    // Return path (version 4+): processed audio coming back from the receiver.
+    //
+    // The receiver is the producer here. It writes the processed version of send-ring
+    // frame P into return slot (P & RETURN_RING_MASK), interleaved with
+    // returnNumChannels channels, then advances returnWriteIndex past it (release).
+    // Before setting returnActive it must prime returnWriteIndex to the send-ring position
+    // of the first frame it will return; the plugin takes the stream as started only once
+    // returnWriteIndex moves from the value it had when returnActive was set. The plugin
+    // reads a fixed latency behind its own writeIndex (one block plus a small margin,
+    // raised when blocks arrive late), reports that latency to the host, and publishes
+    // how far it has read in returnReadIndex.
+    static constexpr uint64_t RETURN_RING_SIZE = 16384;
+    static constexpr uint64_t RETURN_RING_MASK = RETURN_RING_SIZE - 1;
+    static constexpr int RETURN_MAX_CHANNELS = 8;
+
+    alignas(64) std::atomic<uint64_t> returnWriteIndex;
+    std::atomic<uint32_t> returnNumChannels;
+    std::atomic<uint32_t> returnActive;
+
+    alignas(64) std::atomic<uint64_t> returnReadIndex;
+    std::atomic<uint64_t> returnUnderruns;  // Blocks where the return stream hadn't arrived yet
+    std::atomic<uint64_t> returnLatencyFrames;
+
+    float returnData[RETURN_RING_SIZE * RETURN_MAX_CHANNELS];
+
+    //==============================================================================
+    // Channel map (version 6+): what each interleaved ring channel carries, in ring
+    // order, for the first channelMapSize (== ringStride) channels. It is rewritten
+    // together with the ring geometry, inside the same odd ringGeneration window, so a
+    // receiver that sees an even, unchanged generation has a map matching the ring.
+    static constexpr int MAX_CHANNELS = 64;
+
+    struct ChannelInfo
+    {
+        uint16_t bus;          // Input bus the channel comes from
+        uint16_t busChannel;   // Channel index within that bus
+        uint32_t speaker;      // juce::AudioChannelSet::ChannelType (discreteChannel0 + n for discrete layouts)
+    };
+
+    std::atomic<uint32_t> channelMapSize;
+    ChannelInfo channelMap[MAX_CHANNELS];
+
+    //==============================================================================
+    // Latest-block snapshot mailbox (version 7+), for meters, scopes and other observers
+    // that want the newest audio rather than a queue to drain.
+    //
+    // The sender copies every block (as float32, interleaved, decimated by an integer
+    // factor if it is longer than SNAPSHOT_MAX_FRAMES) into the slot after
+    // snapshotLatest, then points snapshotLatest at it. Each slot is a seqlock (its
+    // sequence is odd while being written), and with three slots a slot is only rewritten
+    // two blocks after it was published, so any number of observers can copy it at their
+    // own pace without ever touching readIndex or holding up the sender. Use
+    // readLatestSnapshot() below, which retries if the slot changed underneath it.
+    static constexpr int SNAPSHOT_SLOTS = 3;
+    static constexpr int SNAPSHOT_MAX_FRAMES = 1024;
+
+    struct SnapshotSlot
+    {
+        alignas(64) std::atomic<uint64_t> sequence;
+        uint64_t position;       // Ring position of the block's first frame
+        double   sampleRate;
+        uint32_t numFrames;      // Frames stored (after decimation)
+        uint32_t numChannels;
+        uint32_t decimation;     // Stored frame n is block frame n * decimation
+        uint32_t reserved;
+        float    samples[SNAPSHOT_MAX_FRAMES * MAX_CHANNELS];
+    };
+
+    struct SnapshotInfo
+    {
+        uint64_t position;
+        double   sampleRate;
+        int      numFrames;
+        int      numChannels;
+        int      decimation;
+    };
+
+    alignas(64) std::atomic<uint32_t> snapshotLatest;
+    std::atomic<uint64_t> snapshotsPublished;   // 0 until the first block
+
+    SnapshotSlot snapshots[SNAPSHOT_SLOTS];
+
+    //==============================================================================
+    // Protocol word locations (version 8+): byte offsets from the start of the segment
+    // of the SharedAudioData fields the ring protocol uses, so readers built without
+    // SharedMemoryManager.h (e.g. through Source/Transport/audiosender_transport.h) can
+    // find them. activeOffset points at a one-byte std::atomic<bool>.
+    std::atomic<uint64_t> writeIndexOffset;
+    std::atomic<uint64_t> readIndexOffset;
+    std::atomic<uint64_t> activeOffset;
+    std::atomic<uint64_t> overrunsOffset;
+    std::atomic<uint64_t> underrunsOffset;
+
+    //==============================================================================
+    // Fixed-period packets (version 9+). When reblockFrames is nonzero (a power of two,
+    // at most half of ringCapacityFrames) the sender regroups host blocks of any size
+    // into packets of exactly reblockFrames frames, each with one header, and every
+    // packet starts at a multiple of reblockFrames, so none straddles the ring wrap. A
+    // receiver whose device period matches consumes one packet per callback, in place.
+    // It only changes inside an odd ringGeneration window, together with the geometry.
+    std::atomic<uint32_t> reblockFrames;
+
+    //==============================================================================
+    // Receiver presence (version 10+). The sender only publishes while a receiver is
+    // present, i.e. readIndex or readerHeartbeat changed within the last
+    // READER_TIMEOUT_MS. Receivers should change readerHeartbeat (any new value) on
+    // every poll, so they count as present even while the ring is empty; the transport
+    // library does this in ast_read_acquire() and ast_wait_for_data(). While idle the
+    // sender still publishes one block every IDLE_PROBE_MS, so receivers that only move
+    // readIndex are noticed too. When a receiver appears the sender restarts the ring
+    // empty (like a resize, but with the same geometry), resets sequence numbers and
+    // sends a SharedEventRecord::RESYNC event at the first new block.
+    static constexpr int READER_TIMEOUT_MS = 1000;
+    static constexpr int IDLE_PROBE_MS = 250;
+
+    alignas(64) std::atomic<uint64_t> readerHeartbeat;
+
+    //==============================================================================
+    // Loudness per enabled input bus, in bus order (version 11+), from the sender's
+    // background EBU R128 analysis: momentary (400 ms), short-term (3 s) and gated
+    // integrated loudness in LUFS, and the 4x oversampled true peak in dBTP held since
+    // the last reset. LOUDNESS_FLOOR_DB means nothing has been measured yet.
+    // loudnessVersion changes (every 100 ms) after the values have been updated.
+    static constexpr int MAX_LOUDNESS_BUSES = 8;
+    static constexpr float LOUDNESS_FLOOR_DB = -120.0f;
+
+    struct LoudnessInfo
+    {
+        std::atomic<float> momentaryLufs;
+        std::atomic<float> shortTermLufs;
+        std::atomic<float> integratedLufs;
+        std::atomic<float> truePeakDbtp;
+    };
+
+    alignas(64) std::atomic<uint32_t> loudnessVersion;
+    std::atomic<uint32_t> loudnessBuses;
+    LoudnessInfo loudness[MAX_LOUDNESS_BUSES];
+
+    //==============================================================================
+    // Eventfd wakeups (version 12+). In the anonymous segment mode the sender hands the
+    // receiver an eventfd together with the segment (see ast_connect()). A receiver that
+    // wants to sleep on it increments wakeupWaiters, re-checks writeIndex, polls the
+    // eventfd, drains it and decrements wakeupWaiters again. The sender signals it after
+    // a commit only while wakeupWaiters is nonzero, so without a sleeping receiver commits make no system call.
+    alignas(64) std::atomic<uint32_t> wakeupWaiters;
+
+    // Copies the newest snapshot into dest, interleaved with info.numChannels channels
+    // (at most maxFrames x maxChannels samples). Returns false if nothing has been
+    // published yet or the writer kept overtaking the copy.
+    bool readLatestSnapshot (float* dest, int maxFrames, int maxChannels, SnapshotInfo& info) const
+    {
+        for (int attempt = 0; attempt < 4; ++attempt)
+        {
+            if (snapshotsPublished.load(std::memory_order_acquire) == 0)
+                return false;
+
+            const auto& slot = snapshots[snapshotLatest.load(std::memory_order_acquire) % SNAPSHOT_SLOTS];
+            const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+            if ((before & 1) != 0)
+                continue;
+
+            info.position    = slot.position;
+            info.sampleRate  = slot.sampleRate;
+            info.decimation  = static_cast<int>(slot.decimation);
+            const int storedChannels = slot.numChannels < static_cast<uint32_t>(MAX_CHANNELS) ? static_cast<int>(slot.numChannels) : MAX_CHANNELS;
+            const int storedFrames   = slot.numFrames < static_cast<uint32_t>(SNAPSHOT_MAX_FRAMES) ? static_cast<int>(slot.numFrames) : SNAPSHOT_MAX_FRAMES;
+            info.numChannels = storedChannels < maxChannels ? storedChannels : maxChannels;
+            info.numFrames   = storedFrames < maxFrames ? storedFrames : maxFrames;
+
+            for (int frame = 0; frame < info.numFrames; ++frame)
+                for (int channel = 0; channel < info.numChannels; ++channel)
+                    dest[frame * info.numChannels + channel] = slot.samples[frame * storedChannels + channel];
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == before)
+                return true;
+        }
+
+        return false;
+    }
+};
+
+static_assert (std::atomic<uint32_t>::is_always_lock_free, "Shared atomics must be lock free");
+static_assert (std::atomic<uint64_t>::is_always_lock_free, "Shared atomics must be lock free");
+static_assert (sizeof (std::atomic<uint32_t>) == sizeof (uint32_t), "Futex words must be plain 32-bit integers");
+static_assert (sizeof (std::atomic<bool>) == 1, "isActive is read as a single byte");
+static_assert (sizeof (SharedSegmentExtension::ChannelInfo) == 8, "Channel map entries are a fixed 8 bytes");
@@ -0,0 +1,214 @@
+#include "TestSegment.h"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <csignal>
+#include <cstring>
+#include <string>
+
+//==============================================================================
+// ast_connect() against a sender in a forked child on a file socket: a normal
+// handshake, a sender that passes more fds than a handshake carries (the extras must
+// be closed, not leaked), and, when run as root, a sender running as another user,
+// which must be refused before anything is received.
+//==============================================================================
+namespace
+{
+    std::string socketPath(const char* name)
+    {
+        return "/tmp/ast-handshake-test-" + std::to_string(getpid()) + "-" + name;
+    }
+
+    int listenOn(const std::string& path)
+    {
+        unlink(path.c_str());
+
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1 || bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1 || listen(fd, 1) == -1)
+            return -1;
+
+        // Lets the receiver connect to a sender that dropped privileges
+        chmod(path.c_str(), 0777);
+        return fd;
+    }
+
+    ast_handshake handshakeInfo()
+    {
+        ast_handshake info {};
+        info.magic = AST_HANDSHAKE_MAGIC;
+        info.layout_version = SharedSegmentExtension::LAYOUT_VERSION;
+        info.extension_offset = 4096;
+        info.segment_bytes = 65536;
+        return info;
+    }
+
+    // Sends the handshake plus extraFds more copies of the segment fd, bypassing
+    // ast_handshake_send() like a hostile sender would
+    void sendRaw(int connection, int segmentFd, int extraFds)
+    {
+        int fds[8];
+        const int numFds = 2 + extraFds;
+        for (int index = 0; index < numFds; ++index)
+            fds[index] = segmentFd;
+
+        ast_handshake message = handshakeInfo();
+        iovec payload { &message, sizeof(message) };
+
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] {};
+        msghdr header {};
+        header.msg_iov = &payload;
+        header.msg_iovlen = 1;
+        header.msg_control = control;
+        header.msg_controllen = CMSG_SPACE(static_cast<size_t>(numFds) * sizeof(int));
+
+        cmsghdr* rights = CMSG_FIRSTHDR(&header);
+        rights->cmsg_level = SOL_SOCKET;
+        rights->cmsg_type = SCM_RIGHTS;
+        rights->cmsg_len = CMSG_LEN(static_cast<size_t>(numFds) * sizeof(int));
+        std::memcpy(CMSG_DATA(rights), fds, static_cast<size_t>(numFds) * sizeof(int));
+        sendmsg(connection, &header, 0);
+    }
+
+    // Forks a sender that listens on path and answers one connection; runAs >= 0 drops
+    // to that uid first. The peer credentials of a connection are the listener's, so the
+    // child creates the socket itself. Returns once it is listening.
+    template <typename Answer>
+    pid_t forkSender(const std::string& path, int runAs, Answer answer)
+    {
+        int ready[2];
+        if (pipe(ready) == -1)
+            return -1;
+
+        const pid_t child = fork();
+        if (child != 0)
+        {
+            close(ready[1]);
+            char byte;
+            EXPECT(read(ready[0], &byte, 1) == 1);
+            close(ready[0]);
+            return child;
+        }
+
+        // The receiver may hang up before the answer goes out
+        signal(SIGPIPE, SIG_IGN);
+
+        if (runAs >= 0 && setuid(static_cast<uid_t>(runAs)) != 0)
+            _exit(2);
+
+        const int listenFd = listenOn(path);
+        if (listenFd == -1 || write(ready[1], "x", 1) != 1)
+            _exit(3);
+
+        const int connection = accept(listenFd, nullptr, nullptr);
+        answer(connection);
+
+        // Hold the connection until the receiver has hung up
+        char byte;
+        while (read(connection, &byte, 1) > 0)
+        {
+        }
+        _exit(0);
+    }
+
+    int countOpenFds()
+    {
+        int count = 0;
+        for (int fd = 0; fd < 1024; ++fd)
+            if (fcntl(fd, F_GETFD) != -1)
+                ++count;
+        return count;
+    }
+
+    int memoryFd()
+    {
+        char path[] = "/tmp/ast-handshake-test-XXXXXX";
+        const int fd = mkstemp(path);
+        unlink(path);
+        return fd;
+    }
+
+    void testHandshake()
+    {
+        const auto path = socketPath("ok");
+        const int segmentFd = memoryFd();
+        const pid_t child = forkSender(path, -1, [&] (int connection)
+        {
+            const auto info = handshakeInfo();
+            ast_handshake_send(connection, &info, segmentFd, segmentFd);
+        });
+
+        ast_handshake info {};
+        int receivedSegment = -1, receivedWakeup = -1;
+        EXPECT(ast_connect(path.c_str(), 2000, &info, &receivedSegment, &receivedWakeup) == AST_OK);
+        EXPECT(info.segment_bytes == 65536 && receivedSegment >= 0 && receivedWakeup >= 0);
+
+        close(receivedSegment);
+        close(receivedWakeup);
+        waitpid(child, nullptr, 0);
+        close(segmentFd);
+        unlink(path.c_str());
+    }
+
+    void testExtraFdsAreClosed()
+    {
+        const auto path = socketPath("extra");
+        const int segmentFd = memoryFd();
+        const pid_t child = forkSender(path, -1, [&] (int connection) { sendRaw(connection, segmentFd, 4); });
+
+        const int before = countOpenFds();
+
+        ast_handshake info {};
+        int receivedSegment = -1, receivedWakeup = -1;
+        const int result = ast_connect(path.c_str(), 2000, &info, &receivedSegment, &receivedWakeup);
+
+        // Six fds arrived: none of them may stay open unless handed to the caller
+        EXPECT(result == AST_ERR_DENIED);
+        EXPECT(receivedSegment == -1 && receivedWakeup == -1);
+        EXPECT(countOpenFds() == before);
+
+        waitpid(child, nullptr, 0);
+        close(segmentFd);
+        unlink(path.c_str());
+    }
+
+    void testOtherUserIsRefused()
+    {
+        if (getuid() != 0)
+        {
+            std::printf("  not root: other-user sender skipped\n");
+            return;
+        }
+
+        const auto path = socketPath("other");
+        const int segmentFd = memoryFd();
+        const pid_t child = forkSender(path, 65534, [&] (int connection) { sendRaw(connection, segmentFd, 0); });
+
+        ast_handshake info {};
+        int receivedSegment = -1, receivedWakeup = -1;
+        EXPECT(ast_connect(path.c_str(), 2000, &info, &receivedSegment, &receivedWakeup) == AST_ERR_DENIED);
+        EXPECT(receivedSegment == -1 && receivedWakeup == -1);
+
+        int status = 0;
+        waitpid(child, &status, 0);
+        EXPECT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+        close(segmentFd);
+        unlink(path.c_str());
+    }
+}
+
+int main()
+{
+    testHandshake();
+    testExtraFdsAreClosed();
+    testOtherUserIsRefused();
+    return TestCheck::finish("HandshakeTest");
+}
@@ -0,0 +1,163 @@
+#include "TestSegment.h"
+
+#include <random>
+
+//==============================================================================
+// Property tests of reserve/commit/acquire/release against a plain model of the two
+// indexes, starting right below the 2^64 wrap so every run crosses it. Each step
+// checks the library's space, spans and stats against what the model says.
+//==============================================================================
+namespace
+{
+    constexpr uint64_t top = ~uint64_t { 0 };
+
+    struct Model
+    {
+        uint64_t written = 0;
+        uint64_t read = 0;
+        uint64_t capacity = 0;
+
+        uint64_t queued() const { return written - read; }
+        uint64_t space() const  { return capacity - queued(); }
+    };
+
+    // Every span covers exactly frames slots, in order, starting at position's slot
+    void checkSpan(const TestSegment& segment, const ast_ring* ring, const ast_span& span, uint64_t position, uint32_t frames)
+    {
+        ast_layout layout;
+        ast_get_layout(ring, &layout);
+
+        const auto* data = static_cast<const char*>(segment.base) + layout.data_offset;
+        const size_t frameBytes = static_cast<size_t>(layout.stride) * sizeof(float);
+        const uint64_t slot = position & (layout.capacity_frames - 1);
+
+        EXPECT(span.position == position);
+        EXPECT(span.frames == frames);
+        EXPECT(span.run_frames[0] + span.run_frames[1] == frames);
+        EXPECT(span.data[0] == data + slot * frameBytes);
+        EXPECT(span.run_frames[0] == (frames < layout.capacity_frames - slot ? frames : layout.capacity_frames - slot));
+        EXPECT((span.run_frames[1] == 0) == (span.data[1] == nullptr));
+        EXPECT(span.run_frames[1] == 0 || span.data[1] == data);
+    }
+
+    void runRandomOperations(uint32_t seed, uint64_t capacityFrames, uint64_t start)
+    {
+        TestSegment segment(capacityFrames, 2);
+        ast_ring* writer = segment.attach();
+        EXPECT(segment.configure(writer, start));
+        ast_ring* reader = segment.attach();
+
+        Model model { start, start, capacityFrames };
+        std::mt19937_64 random(seed);
+        uint64_t sequence = 0;
+
+        for (int step = 0; step < 20000; ++step)
+        {
+            EXPECT(ast_write_space(writer) == model.space());
+
+            if (random() % 2 == 0)
+            {
+                // Anything from one frame to a bit more than the whole ring
+                const auto frames = static_cast<uint32_t>(1 + random() % (capacityFrames + capacityFrames / 4));
+                ast_span span;
+                const int result = ast_write_reserve(writer, frames, &span);
+
+                EXPECT((result == AST_FULL) == (frames > model.space()));
+                if (result != AST_OK)
+                    continue;
+
+                checkSpan(segment, writer, span, model.written, frames);
+                EXPECT(ast_write_commit(writer, &span, sequence++, 0.0) == AST_OK);
+                model.written += frames;
+            }
+            else
+            {
+                const auto maxFrames = static_cast<uint32_t>(random() % (capacityFrames + 8));
+                ast_span span;
+                const int result = ast_read_acquire(reader, maxFrames, &span);
+
+                EXPECT((result == AST_EMPTY) == (model.queued() == 0 || maxFrames == 0));
+                if (result != AST_OK)
+                    continue;
+
+                const auto frames = static_cast<uint32_t>(model.queued() < maxFrames ? model.queued() : maxFrames);
+                checkSpan(segment, reader, span, model.read, frames);
+
+                // Consume all of it or, through a slice, just the front
+                ast_span consumed = span;
+                if (random() % 3 == 0)
+                    EXPECT(ast_span_slice(&span, 0, static_cast<uint32_t>(random() % (frames + 1)), &consumed) == AST_OK);
+
+                EXPECT(ast_read_release(reader, &consumed) == AST_OK);
+                model.read += consumed.frames;
+            }
+
+            ast_stats stats;
+            ast_get_stats(reader, &stats);
+            EXPECT(stats.write_index == model.written && stats.read_index == model.read);
+        }
+
+        // The run did cross the wrap
+        EXPECT(model.written < start);
+
+        ast_detach(reader);
+        ast_detach(writer);
+    }
+
+    // Fixed periods: packets never straddle the end of the ring, also across the wrap
+    void runPeriodOperations(uint32_t seed, uint64_t start)
+    {
+        constexpr uint64_t capacityFrames = 1024;
+        constexpr uint32_t period = 64;
+
+        TestSegment segment(capacityFrames, 1);
+        ast_ring* writer = segment.attach();
+        EXPECT(segment.configure(writer, start, period));
+        ast_ring* reader = segment.attach();
+
+        // Restarts round up to a period boundary, which may be past the wrap
+        const uint64_t aligned = segment.header->writeIndex.load();
+        EXPECT(aligned % period == 0 && aligned - start < period);
+
+        std::mt19937 random(seed);
+        for (int step = 0; step < 5000; ++step)
+        {
+            ast_span span;
+            if (random() % 2 == 0)
+            {
+                if (ast_write_reserve(writer, period, &span) != AST_OK)
+                    continue;
+
+                EXPECT(span.data[1] == nullptr && span.position % period == 0);
+                EXPECT(ast_write_commit(writer, &span, 0, 0.0) == AST_OK);
+            }
+            else if (ast_read_acquire(reader, period, &span) == AST_OK)
+            {
+                EXPECT(span.frames == period && span.data[1] == nullptr);
+                EXPECT(ast_read_release(reader, &span) == AST_OK);
+            }
+        }
+
+        ast_span wrong;
+        if (ast_write_reserve(writer, period / 2, &wrong) == AST_OK)
+            EXPECT(ast_write_commit(writer, &wrong, 0, 0.0) == AST_ERR_INVALID);
+
+        ast_detach(reader);
+        ast_detach(writer);
+    }
+}
+
+int main()
+{
+    uint32_t seed = 1;
+
+    // From a few thousand frames below the wrap down to exactly on it
+    for (const uint64_t capacity : { 16ull, 256ull, 4096ull })
+        for (const uint64_t start : { top - 5000, top - capacity / 2, top - 1, top })
+            runRandomOperations(seed++, capacity, start);
+
+    for (const uint64_t start : { top - 5000, top - 100, top - 1, top })
+        runPeriodOperations(seed++, start);
+
+    return TestCheck::finish("IndexPropertyTest");
+}
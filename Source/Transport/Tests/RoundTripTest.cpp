@@ -0,0 +1,165 @@
+#include "TestSegment.h"
+
+#include <cstring>
+#include <vector>
+
+//==============================================================================
+// One writer and one reader handle on the same segment, driven step by step through
+// the C API: layout, attach, write/read with headers, restart and resize.
+//==============================================================================
+namespace
+{
+    void writeBlock(ast_ring* writer, uint32_t frames, uint32_t stride, uint64_t sequence, float first)
+    {
+        ast_span span;
+        EXPECT(ast_write_reserve(writer, frames, &span) == AST_OK);
+
+        float value = first;
+        for (int run = 0; run < 2; ++run)
+            for (uint32_t sample = 0; sample < span.run_frames[run] * stride; ++sample)
+                static_cast<float*>(span.data[run])[sample] = value++;
+
+        EXPECT(ast_write_commit(writer, &span, sequence, 0.5 * static_cast<double>(sequence)) == AST_OK);
+    }
+
+    void testLayout()
+    {
+        ast_layout layout;
+        EXPECT(ast_compute_layout(TestSegment::EXTENSION_OFFSET, 1000, 2, AST_FORMAT_FLOAT32, &layout) == AST_OK);
+        EXPECT(layout.capacity_frames == 1024);
+        EXPECT(layout.headers_offset % 4096 == 0);
+        EXPECT(layout.data_offset >= layout.headers_offset + 1024 * sizeof(ast_block_header));
+        EXPECT(layout.segment_bytes == layout.data_offset + 1024 * 2 * sizeof(float));
+
+        EXPECT(ast_compute_layout(TestSegment::EXTENSION_OFFSET, 16, 0, AST_FORMAT_FLOAT32, &layout) == AST_ERR_INVALID);
+        EXPECT(ast_compute_layout(TestSegment::EXTENSION_OFFSET, 16, 2, 7, &layout) == AST_ERR_INVALID);
+    }
+
+    void testAttach()
+    {
+        TestSegment segment(256, 2);
+        EXPECT(ast_attach(segment.base, segment.bytes, TestSegment::EXTENSION_OFFSET + 64) == nullptr);
+
+        segment.extension->magic.store(0);
+        EXPECT(segment.attach() == nullptr);
+        segment.extension->magic.store(SharedSegmentExtension::MAGIC);
+
+        ast_ring* ring = segment.attach();
+        EXPECT(ring != nullptr);
+
+        // Nothing laid out yet: empty, and no space to write into
+        ast_span span;
+        EXPECT(ast_read_acquire(ring, 16, &span) == AST_EMPTY);
+        EXPECT(ast_write_reserve(ring, 16, &span) == AST_FULL);
+        ast_detach(ring);
+    }
+
+    void testRoundTrip()
+    {
+        constexpr uint32_t stride = 3;
+        TestSegment segment(256, stride);
+        ast_ring* writer = segment.attach();
+        EXPECT(segment.configure(writer));
+        ast_ring* reader = segment.attach();
+        EXPECT(ast_refresh(reader, nullptr, 0) == AST_OK);
+
+        // Blocks of odd sizes, so some of them wrap
+        float expected = 0.0f;
+        uint64_t sequence = 0;
+        for (int round = 0; round < 40; ++round)
+        {
+            const uint32_t frames = 1 + static_cast<uint32_t>(round * 37) % 200;
+            const uint64_t position = segment.header->writeIndex.load();
+            writeBlock(writer, frames, stride, sequence, expected);
+
+            ast_block_header blockHeader;
+            EXPECT(ast_read_header(reader, position, &blockHeader) == AST_OK);
+            EXPECT(blockHeader.sequence == sequence && blockHeader.frames == frames && blockHeader.channels == stride);
+            EXPECT(blockHeader.timestamp == 0.5 * static_cast<double>(sequence));
+
+            ast_span span;
+            EXPECT(ast_read_acquire(reader, 4096, &span) == AST_OK);
+            EXPECT(span.frames == frames && span.position == position);
+            for (int run = 0; run < 2; ++run)
+                for (uint32_t sample = 0; sample < span.run_frames[run] * stride; ++sample)
+                    EXPECT(static_cast<float*>(span.data[run])[sample] == expected++);
+
+            EXPECT(ast_read_release(reader, &span) == AST_OK);
+            ++sequence;
+        }
+
+        // A restart drops what's queued, once
+        writeBlock(writer, 10, stride, sequence, 0.0f);
+        EXPECT(ast_write_restart(writer) == AST_OK);
+
+        ast_span span;
+        EXPECT(ast_read_acquire(reader, 64, &span) == AST_RECONFIGURED);
+        EXPECT(ast_refresh(reader, nullptr, 0) == AST_OK);
+        EXPECT(ast_read_acquire(reader, 64, &span) == AST_EMPTY);
+
+        // A restart that lands after release has checked the generation: the stale span
+        // must not move readIndex back behind the restart point
+        writeBlock(writer, 10, stride, sequence, 0.0f);
+        EXPECT(ast_read_acquire(reader, 64, &span) == AST_OK);
+        const uint64_t restartPoint = segment.header->writeIndex.load() + 5;
+        segment.header->readIndex.store(restartPoint);
+        EXPECT(ast_read_release(reader, &span) == AST_RECONFIGURED);
+        EXPECT(segment.header->readIndex.load() == restartPoint);
+        segment.header->readIndex.store(segment.header->writeIndex.load());
+
+        ast_stats stats;
+        EXPECT(ast_get_stats(reader, &stats) == AST_OK);
+        EXPECT(stats.write_index == stats.read_index && stats.capacity_frames == 256 && stats.stride == stride);
+        EXPECT((stats.flags & AST_STATS_ACTIVE) != 0);
+
+        ast_detach(reader);
+        ast_detach(writer);
+    }
+
+    void testResize()
+    {
+        TestSegment segment(1024, 4);
+        ast_ring* writer = segment.attach();
+        EXPECT(segment.configure(writer));
+        ast_ring* reader = segment.attach();
+
+        writeBlock(writer, 100, 4, 0, 0.0f);
+
+        // Narrower and shorter: fits in the same mapping
+        ast_layout smaller;
+        ast_compute_layout(TestSegment::EXTENSION_OFFSET, 128, 2, AST_FORMAT_FLOAT32, &smaller);
+        EXPECT(ast_begin_configure(writer) == AST_OK);
+        EXPECT(ast_refresh(reader, nullptr, 0) == AST_RECONFIGURED);
+        EXPECT(ast_finish_configure(writer, nullptr, 0, &smaller) == AST_OK);
+
+        ast_span span;
+        EXPECT(ast_read_acquire(reader, 64, &span) == AST_RECONFIGURED);
+        EXPECT(ast_refresh(reader, nullptr, 0) == AST_OK);
+
+        ast_layout seen;
+        EXPECT(ast_get_layout(reader, &seen) == AST_OK);
+        EXPECT(seen.capacity_frames == 128 && seen.stride == 2);
+        EXPECT(ast_read_acquire(reader, 64, &span) == AST_EMPTY);
+
+        // Larger than the mapping: refused, the old layout stays
+        ast_layout larger;
+        ast_compute_layout(TestSegment::EXTENSION_OFFSET, 1 << 20, 8, AST_FORMAT_FLOAT64, &larger);
+        EXPECT(ast_begin_configure(writer) == AST_OK);
+        EXPECT(ast_finish_configure(writer, nullptr, 0, &larger) == AST_ERR_LAYOUT);
+        EXPECT(ast_cancel_configure(writer) == AST_OK);
+        EXPECT(ast_refresh(reader, nullptr, 0) == AST_OK);
+        EXPECT(ast_get_layout(reader, &seen) == AST_OK && seen.capacity_frames == 128);
+
+        ast_detach(reader);
+        ast_detach(writer);
+    }
+}
+
+int main()
+{
+    testLayout();
+    testAttach();
+    testRoundTrip();
+    testResize();
+    return TestCheck::finish("RoundTripTest");
+}
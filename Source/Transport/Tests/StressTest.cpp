@@ -0,0 +1,226 @@
+#include "TestSegment.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+
+//==============================================================================
+// Seeded single-producer/single-consumer stress run, starting below the 2^64 wrap: a
+// writer commits blocks of random sizes while a reader acquires random amounts, each
+// on its own handle. The reader checks every sample against the value its position
+// and channel imply, and every block header against the writer's sequence.
+//
+// By default one thread drives both sides, interleaving reserve, commit, acquire and
+// release in an order drawn from the seed, so a failing seed replays step for step.
+// With "threads" each side runs on its own thread instead; build with
+// AUDIOSENDER_TRANSPORT_TSAN=ON to run that under ThreadSanitizer.
+//
+// Usage: TransportStressTest [seed] [frames] [threads]
+//==============================================================================
+namespace
+{
+    constexpr uint32_t stride = 3;
+
+    // Steps in a row in which neither side could move before the interleaved run gives up
+    constexpr int maxIdleSteps = 1000;
+
+    float sampleFor(uint64_t position, uint32_t channel)
+    {
+        return static_cast<float>((position * 31 + channel * 7) % 65521);
+    }
+
+    double timestampFor(uint64_t sequence)
+    {
+        return static_cast<double>(sequence) * 0.25;
+    }
+
+    // Each side counts its own failures, so EXPECT's counter isn't shared between threads
+    struct Writer
+    {
+        Writer(ast_ring* ringToUse, uint32_t seed, uint64_t startPosition, uint64_t frames)
+            : ring(ringToUse), random(seed), start(startPosition), totalFrames(frames), position(startPosition)
+        {
+        }
+
+        bool done() const { return position - start >= totalFrames; }
+
+        // Reserves and renders a block, or commits the reserved one; false if the ring was full
+        bool step()
+        {
+            if (!reserved)
+            {
+                frames = static_cast<uint32_t>(std::min<uint64_t>(1 + random() % 300, totalFrames - (position - start)));
+                if (ast_write_reserve(ring, frames, &span) != AST_OK)
+                    return false;
+
+                uint64_t framePosition = position;
+                for (int run = 0; run < 2; ++run)
+                    for (uint32_t frame = 0; frame < span.run_frames[run]; ++frame, ++framePosition)
+                        for (uint32_t channel = 0; channel < stride; ++channel)
+                            static_cast<float*>(span.data[run])[frame * stride + channel] = sampleFor(framePosition, channel);
+
+                reserved = true;
+                return true;
+            }
+
+            if (ast_write_commit(ring, &span, sequence, timestampFor(sequence)) != AST_OK)
+                ++failures;
+
+            ++sequence;
+            position += frames;
+            reserved = false;
+            return true;
+        }
+
+        ast_ring* ring;
+        std::mt19937 random;
+        uint64_t start, totalFrames, position, sequence = 0;
+        uint64_t failures = 0;
+        ast_span span {};
+        uint32_t frames = 0;
+        bool reserved = false;
+    };
+
+    struct Reader
+    {
+        Reader(ast_ring* ringToUse, uint32_t seed, uint64_t startPosition, uint64_t frames)
+            : ring(ringToUse), random(seed), start(startPosition), totalFrames(frames), position(startPosition), nextBlock(startPosition)
+        {
+        }
+
+        bool done() const { return position - start >= totalFrames; }
+
+        // Acquires some audio, or checks and releases the acquired span; false if the ring was empty
+        bool step()
+        {
+            if (!acquired)
+            {
+                if (ast_read_acquire(ring, static_cast<uint32_t>(1 + random() % 700), &span) != AST_OK)
+                    return false;
+
+                acquired = true;
+                return true;
+            }
+
+            if (span.position != position)
+                ++sampleErrors;
+
+            for (int run = 0; run < 2; ++run)
+            {
+                for (uint32_t frame = 0; frame < span.run_frames[run]; ++frame, ++position)
+                {
+                    // Blocks start where the previous one's header said it ends
+                    if (position == nextBlock)
+                    {
+                        ast_block_header header;
+                        if (ast_read_header(ring, position, &header) != AST_OK || header.sequence != sequence
+                            || header.frames == 0 || header.channels != stride || header.timestamp != timestampFor(sequence))
+                            ++headerErrors;
+
+                        nextBlock += header.frames;
+                        ++sequence;
+                    }
+
+                    for (uint32_t channel = 0; channel < stride; ++channel)
+                        if (static_cast<const float*>(span.data[run])[frame * stride + channel] != sampleFor(position, channel))
+                            ++sampleErrors;
+                }
+            }
+
+            if (ast_read_release(ring, &span) != AST_OK)
+                ++sampleErrors;
+
+            acquired = false;
+            return true;
+        }
+
+        ast_ring* ring;
+        std::mt19937 random;
+        uint64_t start, totalFrames, position, nextBlock, sequence = 0;
+        uint64_t sampleErrors = 0, headerErrors = 0;
+        ast_span span {};
+        bool acquired = false;
+    };
+
+    // Both sides on this thread; which one moves next comes from the seed
+    bool runInterleaved(Writer& writer, Reader& reader, uint32_t seed)
+    {
+        std::mt19937 random(seed ^ 0x85ebca6bu);
+        int idleSteps = 0;
+
+        while (!writer.done() || !reader.done())
+        {
+            const bool useWriter = reader.done() || (!writer.done() && random() % 2 == 0);
+            idleSteps = (useWriter ? writer.step() : reader.step()) ? 0 : idleSteps + 1;
+
+            if (idleSteps > maxIdleSteps)
+            {
+                std::fprintf(stderr, "stalled at writer %llu, reader %llu\n", static_cast<unsigned long long>(writer.position - writer.start),
+                             static_cast<unsigned long long>(reader.position - reader.start));
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void runThreaded(Writer& writer, Reader& reader)
+    {
+        std::thread writerThread ([&]
+        {
+            while (!writer.done())
+                if (!writer.step())
+                    std::this_thread::yield();
+        });
+
+        std::thread readerThread ([&]
+        {
+            while (!reader.done())
+                if (!reader.step())
+                    std::this_thread::yield();
+        });
+
+        writerThread.join();
+        readerThread.join();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t seed = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 12345;
+    const uint64_t totalFrames = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+    const bool threaded = argc > 3 && std::strcmp(argv[3], "threads") == 0;
+    const uint64_t start = ~uint64_t { 0 } - totalFrames / 2;
+
+    TestSegment segment(512, stride);
+    ast_ring* writerRing = segment.attach();
+    EXPECT(segment.configure(writerRing, start));
+    ast_ring* readerRing = segment.attach();
+
+    Writer writer(writerRing, seed, start, totalFrames);
+    Reader reader(readerRing, seed ^ 0x9e3779b9u, start, totalFrames);
+
+    if (threaded)
+        runThreaded(writer, reader);
+    else
+        EXPECT(runInterleaved(writer, reader, seed));
+
+    EXPECT(writer.failures == 0);
+    EXPECT(reader.sampleErrors == 0);
+    EXPECT(reader.headerErrors == 0);
+
+    ast_stats stats;
+    ast_get_stats(readerRing, &stats);
+    EXPECT(stats.write_index == start + totalFrames && stats.read_index == stats.write_index);
+    EXPECT(stats.write_index < start);   // Crossed the wrap
+
+    std::printf("seed %u (%s): %llu frames, %llu sample and %llu header errors\n", seed, threaded ? "threads" : "interleaved",
+                static_cast<unsigned long long>(totalFrames), static_cast<unsigned long long>(reader.sampleErrors),
+                static_cast<unsigned long long>(reader.headerErrors));
+
+    ast_detach(readerRing);
+    ast_detach(writerRing);
+    return TestCheck::finish("StressTest");
+}
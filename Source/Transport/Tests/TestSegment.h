@@ -0,0 +1,106 @@
+#pragma once
+
+#include "audiosender_transport.h"
+#include "SharedSegmentExtension.h"
+
+#include <sys/mman.h>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+//==============================================================================
+// Shared helpers for the transport tests: a tiny check macro and an anonymous mapping
+// laid out like the plugin's segment, so the library is exercised exactly as a
+// receiver would use it, minus the shm name.
+//==============================================================================
+namespace TestCheck
+{
+    inline int& failures()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    inline int finish(const char* name)
+    {
+        std::printf("%s: %s (%d failed checks)\n", name, failures() == 0 ? "passed" : "FAILED", failures());
+        return failures() == 0 ? 0 : 1;
+    }
+}
+
+#define EXPECT(condition) \
+    do { if (!(condition)) { std::fprintf(stderr, "%s:%d: EXPECT(%s) failed\n", __FILE__, __LINE__, #condition); ++TestCheck::failures(); } } while (false)
+
+// Stand-in for the plugin's SharedAudioData: only the words the extension points at
+struct TestHeader
+{
+    std::atomic<uint64_t> writeIndex;
+    std::atomic<uint64_t> readIndex;
+    std::atomic<uint64_t> overruns;
+    std::atomic<uint64_t> underruns;
+    std::atomic<bool> active;
+};
+
+class TestSegment
+{
+public:
+    static constexpr size_t EXTENSION_OFFSET = SharedSegmentExtension::offsetFor(sizeof(TestHeader));
+
+    // Maps enough for minFrames x stride of format and publishes an initialised
+    // extension; the ring itself is laid out by configure()
+    TestSegment(uint64_t minFrames, uint32_t stride, uint32_t format = AST_FORMAT_FLOAT32)
+    {
+        ast_compute_layout(EXTENSION_OFFSET, minFrames, stride, format, &layout);
+        bytes = static_cast<size_t>(layout.segment_bytes);
+
+        base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)
+        {
+            std::perror("mmap");
+            std::exit(2);
+        }
+
+        // Anonymous mappings are zeroed, so every counter starts at 0
+        header = new (base) TestHeader();
+        header->active.store(true);
+
+        extension = reinterpret_cast<SharedSegmentExtension*>(static_cast<char*>(base) + EXTENSION_OFFSET);
+        extension->writeIndexOffset.store(offsetof(TestHeader, writeIndex));
+        extension->readIndexOffset.store(offsetof(TestHeader, readIndex));
+        extension->overrunsOffset.store(offsetof(TestHeader, overruns));
+        extension->underrunsOffset.store(offsetof(TestHeader, underruns));
+        extension->activeOffset.store(offsetof(TestHeader, active));
+        extension->layoutVersion.store(SharedSegmentExtension::LAYOUT_VERSION);
+        extension->magic.store(SharedSegmentExtension::MAGIC, std::memory_order_release);
+    }
+
+    ~TestSegment()
+    {
+        munmap(base, bytes);
+    }
+
+    TestSegment(const TestSegment&) = delete;
+    TestSegment& operator=(const TestSegment&) = delete;
+
+    ast_ring* attach() const
+    {
+        return ast_attach(base, bytes, EXTENSION_OFFSET);
+    }
+
+    // Lays out the ring through the writer's handle, with both indexes at start
+    bool configure(ast_ring* writer, uint64_t start = 0, uint32_t periodFrames = 0)
+    {
+        header->writeIndex.store(start);
+        header->readIndex.store(start);
+
+        ast_layout wanted = layout;
+        wanted.period_frames = periodFrames;
+        return ast_begin_configure(writer) == AST_OK && ast_finish_configure(writer, nullptr, 0, &wanted) == AST_OK;
+    }
+
+    void* base = nullptr;
+    size_t bytes = 0;
+    ast_layout layout {};
+    TestHeader* header = nullptr;
+    SharedSegmentExtension* extension = nullptr;
+};
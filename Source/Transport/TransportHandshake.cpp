@@ -0,0 +1,220 @@
+#include "audiosender_transport.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static_assert (sizeof (ast_handshake) == 24, "The handshake message is a fixed 24 bytes");
+
+namespace
+{
+    // "@name" is name in the Linux abstract namespace: no file, gone with the socket
+    bool socketAddress (const char* path, sockaddr_un& address, socklen_t& length)
+    {
+        const size_t pathLength = std::strlen(path);
+        if (pathLength == 0 || pathLength >= sizeof(address.sun_path))
+            return false;
+
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path, pathLength);
+
+       #if defined (__linux__)
+        if (path[0] == '@')
+        {
+            address.sun_path[0] = '\0';
+            length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + pathLength);
+            return true;
+        }
+       #endif
+
+        length = static_cast<socklen_t>(sizeof(address));
+        return true;
+    }
+
+    void setCloseOnExec (int fd)
+    {
+        if (fd >= 0)
+            fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+    }
+
+    bool peerIsSameUser (int connection)
+    {
+       #if defined (__linux__)
+        ucred credentials {};
+        socklen_t length = sizeof(credentials);
+        return getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0
+               && credentials.uid == getuid();
+       #else
+        uid_t uid = 0;
+        gid_t gid = 0;
+        return getpeereid(connection, &uid, &gid) == 0 && uid == getuid();
+       #endif
+    }
+}
+
+extern "C" int ast_handshake_send (int connection_fd, const ast_handshake* info, int segment_fd, int wakeup_fd)
+{
+    if (connection_fd < 0 || info == nullptr || segment_fd < 0)
+        return AST_ERR_INVALID;
+
+    // The segment is writable, so it only goes to processes that could ptrace the sender anyway
+    if (!peerIsSameUser(connection_fd))
+        return AST_ERR_DENIED;
+
+    const int fds[2] = { segment_fd, wakeup_fd };
+    const int numFds = wakeup_fd >= 0 ? 2 : 1;
+
+    ast_handshake message = *info;
+    iovec payload { &message, sizeof(message) };
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] {};
+    msghdr header {};
+    header.msg_iov = &payload;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = CMSG_SPACE(numFds * sizeof(int));
+
+    cmsghdr* rights = CMSG_FIRSTHDR(&header);
+    rights->cmsg_level = SOL_SOCKET;
+    rights->cmsg_type = SCM_RIGHTS;
+    rights->cmsg_len = CMSG_LEN(numFds * sizeof(int));
+    std::memcpy(CMSG_DATA(rights), fds, numFds * sizeof(int));
+
+    // A receiver hanging up early must not raise SIGPIPE in the host
+   #if defined (MSG_NOSIGNAL)
+    constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+   #else
+    constexpr int SEND_FLAGS = 0;
+   #endif
+
+    ssize_t sent;
+    while ((sent = sendmsg(connection_fd, &header, SEND_FLAGS)) == -1 && errno == EINTR)
+    {
+    }
+
+    return sent == static_cast<ssize_t>(sizeof(message)) ? AST_OK : AST_ERR_SYSTEM;
+}
+
+extern "C" int ast_connect (const char* socket_path, int timeout_ms, ast_handshake* info, int* segment_fd, int* wakeup_fd)
+{
+    if (socket_path == nullptr || info == nullptr || segment_fd == nullptr || wakeup_fd == nullptr)
+        return AST_ERR_INVALID;
+
+    *segment_fd = -1;
+    *wakeup_fd = -1;
+
+    sockaddr_un address;
+    socklen_t addressLength = 0;
+    if (!socketAddress(socket_path, address, addressLength))
+        return AST_ERR_INVALID;
+
+    const int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connection == -1)
+        return AST_ERR_SYSTEM;
+
+    setCloseOnExec(connection);
+
+    if (connect(connection, reinterpret_cast<const sockaddr*>(&address), addressLength) == -1)
+    {
+        const int error = errno;
+        close(connection);
+        errno = error;
+        return AST_ERR_SYSTEM;
+    }
+
+    // Abstract socket names have no permissions, so another user could have bound the
+    // name first to hand out a segment of their own
+    if (!peerIsSameUser(connection))
+    {
+        close(connection);
+        return AST_ERR_DENIED;
+    }
+
+    // The sender answers as soon as it accepts, so one wait for the whole message is enough
+    pollfd reply { connection, POLLIN, 0 };
+    if (poll(&reply, 1, std::max(0, timeout_ms)) <= 0)
+    {
+        close(connection);
+        return AST_TIMEOUT;
+    }
+
+    ast_handshake message {};
+    iovec payload { &message, sizeof(message) };
+
+    // Room for more fds than a sender sends, so a peer passing extra ones can't make
+    // the kernel truncate the message; everything past the first two is closed below
+    constexpr int MAX_RECEIVED_FDS = 16;
+    int fds[MAX_RECEIVED_FDS];
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] {};
+    msghdr header {};
+    header.msg_iov = &payload;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+
+   #if defined (MSG_CMSG_CLOEXEC)
+    constexpr int RECEIVE_FLAGS = MSG_CMSG_CLOEXEC | MSG_WAITALL;
+   #else
+    constexpr int RECEIVE_FLAGS = MSG_WAITALL;
+   #endif
+
+    ssize_t received;
+    while ((received = recvmsg(connection, &header, RECEIVE_FLAGS)) == -1 && errno == EINTR)
+    {
+    }
+
+    const int error = errno;
+    close(connection);
+
+    // Every fd that arrived, across however many SCM_RIGHTS messages
+    int numFds = 0;
+    for (cmsghdr* rights = CMSG_FIRSTHDR(&header); rights != nullptr; rights = CMSG_NXTHDR(&header, rights))
+    {
+        if (rights->cmsg_level == SOL_SOCKET && rights->cmsg_type == SCM_RIGHTS)
+        {
+            const int count = static_cast<int>((rights->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            const int kept = std::min(count, MAX_RECEIVED_FDS - numFds);
+            std::memcpy(fds + numFds, CMSG_DATA(rights), static_cast<size_t>(kept) * sizeof(int));
+            numFds += kept;
+        }
+    }
+
+    // A handshake carries one or two; the rest are ours to close
+    for (int index = 2; index < numFds; ++index)
+        close(fds[index]);
+
+    if (received == -1)
+    {
+        for (int index = 0; index < std::min(numFds, 2); ++index)
+            close(fds[index]);
+
+        errno = error;
+        return AST_ERR_SYSTEM;
+    }
+
+    // Whatever arrived is ours to close if the message turns out to be no handshake
+    if (received != static_cast<ssize_t>(sizeof(message)) || message.magic != AST_HANDSHAKE_MAGIC
+        || numFds < 1 || numFds > 2 || (header.msg_flags & MSG_CTRUNC) != 0)
+    {
+        for (int index = 0; index < std::min(numFds, 2); ++index)
+            close(fds[index]);
+
+        return AST_ERR_DENIED;
+    }
+
+    setCloseOnExec(fds[0]);
+    setCloseOnExec(numFds > 1 ? fds[1] : -1);
+
+    *info = message;
+    *segment_fd = fds[0];
+    *wakeup_fd = numFds > 1 ? fds[1] : -1;
+    return AST_OK;
+}
@@ -0,0 +1,717 @@
+#include "audiosender_transport.h"
+
+#include "SharedSegmentExtension.h"
+#include "SharedMemoryWait.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+#include <poll.h>
+#include <unistd.h>
+
+static_assert (sizeof (ast_block_header) == sizeof (SharedBlockHeader), "C and C++ block headers must match");
+static_assert (offsetof (ast_block_header, sequence)  == offsetof (SharedBlockHeader, sequenceNumber), "C and C++ block headers must match");
+static_assert (offsetof (ast_block_header, timestamp) == offsetof (SharedBlockHeader, timestamp), "C and C++ block headers must match");
+static_assert (offsetof (ast_block_header, frames)    == offsetof (SharedBlockHeader, blockSize), "C and C++ block headers must match");
+static_assert (offsetof (ast_block_header, channels)  == offsetof (SharedBlockHeader, numChannels), "C and C++ block headers must match");
+static_assert (AST_FORMAT_FLOAT32 == SharedSegmentExtension::SAMPLE_FORMAT_FLOAT32
+               && AST_FORMAT_FLOAT64 == SharedSegmentExtension::SAMPLE_FORMAT_FLOAT64, "Sample format codes must match");
+
+//==============================================================================
+// One side's view of a segment: where the protocol words are, plus a cached copy of
+// the ring geometry that is only reloaded when ringGeneration says it changed.
+struct ast_ring
+{
+    char* base = nullptr;
+    size_t mappedBytes = 0;
+    size_t extensionOffset = 0;
+    SharedSegmentExtension* extension = nullptr;
+
+    std::atomic<uint64_t>* writeIndex = nullptr;
+    std::atomic<uint64_t>* readIndex = nullptr;
+    std::atomic<uint64_t>* overruns = nullptr;
+    std::atomic<uint64_t>* underruns = nullptr;
+    std::atomic<bool>* active = nullptr;
+    uint32_t layoutVersion = 0;
+
+    uint64_t heartbeat = 0;    // Reader side: last value stored to readerHeartbeat
+    int wakeupFd = -1;         // Eventfd shared with the other side (not owned), or -1
+
+    uint64_t generation = 0;
+    uint64_t capacity = 0;     // 0 until the writer has laid out a ring
+    uint64_t mask = 0;
+    uint32_t stride = 0;
+    uint32_t format = 0;
+    uint32_t bytesPerSample = 0;
+    uint32_t period = 0;       // Fixed packet length, or 0
+    uint64_t headersOffset = 0;
+    uint64_t dataOffset = 0;
+    SharedBlockHeader* headers = nullptr;
+    char* data = nullptr;
+};
+
+//==============================================================================
+// Index arithmetic. writeIndex and readIndex only ever grow and are allowed to wrap
+// past 2^64, so every distance is an unsigned difference and every slot a mask; the
+// static_asserts below pin that down for positions right at the wrap, and compile
+// into every build of the library.
+namespace RingIndex
+{
+    constexpr uint64_t queued (uint64_t written, uint64_t read)                   { return written - read; }
+    constexpr uint64_t space (uint64_t capacity, uint64_t written, uint64_t read) { return capacity - queued(written, read); }
+    constexpr uint64_t slot (uint64_t position, uint64_t mask)                    { return position & mask; }
+
+    // Frames of a span at position that fit before the end of the ring; the rest wrap to slot 0
+    constexpr uint64_t firstRun (uint64_t position, uint64_t frames, uint64_t capacity)
+    {
+        return frames < capacity - slot(position, capacity - 1) ? frames : capacity - slot(position, capacity - 1);
+    }
+
+    // Next multiple of period (a power of two) at or after position
+    constexpr uint64_t alignUp (uint64_t position, uint64_t period)
+    {
+        return (position + period - 1) & ~(period - 1);
+    }
+
+    constexpr uint64_t top = ~uint64_t { 0 };
+
+    // Distances survive the writer wrapping before the reader
+    static_assert (queued(5, top - 2) == 8, "");
+    static_assert (queued(0, top) == 1, "");
+    static_assert (space(1024, 100, top - 923) == 0, "");
+    static_assert (space(1024, top, top) == 1024, "");
+    static_assert (space(1024, 0, top - 1023) == 0, "A full ring straddling the wrap has no space");
+
+    // A writer that moved more than a ring ahead reads as "over capacity", never as short
+    static_assert (queued(1025, 0) > 1024 && queued(3, top - 1022) > 1024, "");
+
+    // Slots keep counting through the wrap: the last position before it and the first
+    // after it are neighbouring slots
+    static_assert (slot(top, 1023) == 1023 && slot(top + 1, 1023) == 0, "");
+    static_assert (slot(top - 1023, 1023) == 0, "");
+
+    // Spans split at the end of the ring, including one that starts just before the wrap
+    static_assert (firstRun(1020, 8, 1024) == 4, "");
+    static_assert (firstRun(1024, 8, 1024) == 8, "");
+    static_assert (firstRun(top - 3, 8, 1024) == 4, "");
+    static_assert (firstRun(top - 1023, 1024, 1024) == 1024, "A whole ring from slot 0 doesn't split");
+
+    // Fixed-period restarts: aligned positions stay put, and rounding up across the wrap
+    // lands on 0, which is itself aligned, so packets never straddle the end of the ring
+    static_assert (alignUp(4096, 256) == 4096 && alignUp(4097, 256) == 4352, "");
+    static_assert (alignUp(top - 9, 64) == 0, "");
+    static_assert (firstRun(alignUp(top - 200, 256), 256, 1024) == 256, "");
+}
+
+namespace
+{
+    uint32_t bytesPerSampleFor (uint32_t format)
+    {
+        return format == SharedSegmentExtension::SAMPLE_FORMAT_FLOAT64 ? sizeof(double) : sizeof(float);
+    }
+
+    bool fits (uint64_t offset, uint64_t bytes, size_t mappedBytes)
+    {
+        return offset <= mappedBytes && bytes <= mappedBytes - offset;
+    }
+
+    // Checks a layout against a mapping of mappedBytes
+    bool isValidLayout (const ast_layout& layout, size_t mappedBytes)
+    {
+        if (layout.capacity_frames == 0)
+            return true;
+
+        if ((layout.capacity_frames & (layout.capacity_frames - 1)) != 0
+            || layout.capacity_frames > (uint64_t { 1 } << 40)
+            || layout.stride == 0 || layout.stride > static_cast<uint32_t>(SharedSegmentExtension::MAX_CHANNELS)
+            || layout.sample_format > SharedSegmentExtension::SAMPLE_FORMAT_FLOAT64
+            || (layout.headers_offset % alignof(SharedBlockHeader)) != 0
+            || (layout.data_offset % sizeof(double)) != 0
+            || (layout.period_frames & (layout.period_frames - 1)) != 0
+            || layout.period_frames > layout.capacity_frames / 2)
+            return false;
+
+        return fits(layout.headers_offset, layout.capacity_frames * sizeof(SharedBlockHeader), mappedBytes)
+            && fits(layout.data_offset, layout.capacity_frames * layout.stride * bytesPerSampleFor(layout.sample_format), mappedBytes);
+    }
+
+    void applyLayout (ast_ring& ring, const ast_layout& layout)
+    {
+        ring.capacity = layout.capacity_frames;
+        ring.mask = layout.capacity_frames > 0 ? layout.capacity_frames - 1 : 0;
+        ring.stride = layout.stride;
+        ring.format = layout.sample_format;
+        ring.bytesPerSample = bytesPerSampleFor(layout.sample_format);
+        ring.period = layout.period_frames;
+        ring.headersOffset = layout.headers_offset;
+        ring.dataOffset = layout.data_offset;
+        ring.headers = reinterpret_cast<SharedBlockHeader*>(ring.base + layout.headers_offset);
+        ring.data = ring.base + layout.data_offset;
+    }
+
+    ast_layout currentLayout (const ast_ring& ring)
+    {
+        ast_layout layout {};
+        layout.capacity_frames = ring.capacity;
+        layout.stride = ring.stride;
+        layout.sample_format = ring.format;
+        layout.headers_offset = ring.headersOffset;
+        layout.data_offset = ring.dataOffset;
+        layout.segment_bytes = ring.dataOffset + ring.capacity * ring.stride * ring.bytesPerSample;
+        layout.period_frames = ring.period;
+        return layout;
+    }
+
+    // Resolves the protocol words of a (version 8+) segment mapped at base
+    bool bindSegment (ast_ring& ring, void* segment, size_t segmentBytes)
+    {
+        if (segment == nullptr || !fits(ring.extensionOffset, sizeof(SharedSegmentExtension), segmentBytes))
+            return false;
+
+        auto* base = static_cast<char*>(segment);
+        auto* extension = reinterpret_cast<SharedSegmentExtension*>(base + ring.extensionOffset);
+
+        if (extension->magic.load(std::memory_order_acquire) != SharedSegmentExtension::MAGIC
+            || extension->layoutVersion.load(std::memory_order_relaxed) < 8)
+            return false;
+
+        const uint64_t writeOffset     = extension->writeIndexOffset.load(std::memory_order_relaxed);
+        const uint64_t readOffset      = extension->readIndexOffset.load(std::memory_order_relaxed);
+        const uint64_t overrunsOffset  = extension->overrunsOffset.load(std::memory_order_relaxed);
+        const uint64_t underrunsOffset = extension->underrunsOffset.load(std::memory_order_relaxed);
+        const uint64_t activeOffset    = extension->activeOffset.load(std::memory_order_relaxed);
+
+        for (const uint64_t offset : { writeOffset, readOffset, overrunsOffset, underrunsOffset })
+            if (!fits(offset, sizeof(uint64_t), segmentBytes) || (offset % alignof(std::atomic<uint64_t>)) != 0)
+                return false;
+
+        if (!fits(activeOffset, 1, segmentBytes))
+            return false;
+
+        ring.base = base;
+        ring.mappedBytes = segmentBytes;
+        ring.extension = extension;
+        ring.writeIndex = reinterpret_cast<std::atomic<uint64_t>*>(base + writeOffset);
+        ring.readIndex  = reinterpret_cast<std::atomic<uint64_t>*>(base + readOffset);
+        ring.overruns   = reinterpret_cast<std::atomic<uint64_t>*>(base + overrunsOffset);
+        ring.underruns  = reinterpret_cast<std::atomic<uint64_t>*>(base + underrunsOffset);
+        ring.active     = reinterpret_cast<std::atomic<bool>*>(base + activeOffset);
+        ring.layoutVersion = extension->layoutVersion.load(std::memory_order_relaxed);
+        return true;
+    }
+
+    // Waits on word in short slices until done() or the deadline
+    template <typename Condition>
+    int waitFor (ast_ring& ring, std::atomic<uint32_t>& word, int timeoutMs, int sliceMs, Condition done)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(0, timeoutMs));
+
+        for (;;)
+        {
+            // Sample the notify word before re-checking, so a wake between the check and the
+            // wait below makes the wait return immediately instead of being lost.
+            const uint32_t seen = word.load(std::memory_order_acquire);
+
+            if (done())
+                return AST_OK;
+
+            if (!ring.active->load(std::memory_order_acquire))
+                return AST_INACTIVE;
+
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            if (remaining <= 0)
+                return AST_TIMEOUT;
+
+            SharedMemoryWait::waitWhileEqual(word, seen, static_cast<int>(std::min<long long>(sliceMs, remaining + 1)));
+        }
+    }
+
+    void fillSpan (const ast_ring& ring, uint64_t position, uint32_t frames, uint64_t generation, ast_span* span)
+    {
+        const uint64_t first = RingIndex::slot(position, ring.mask);
+        const uint32_t firstRun = static_cast<uint32_t>(RingIndex::firstRun(position, frames, ring.capacity));
+        const size_t frameBytes = static_cast<size_t>(ring.stride) * ring.bytesPerSample;
+
+        span->position = position;
+        span->generation = generation;
+        span->frames = frames;
+        span->stride = ring.stride;
+        span->bytes_per_sample = ring.bytesPerSample;
+        span->reserved = 0;
+        span->data[0] = ring.data + first * frameBytes;
+        span->run_frames[0] = firstRun;
+        span->data[1] = firstRun < frames ? ring.data : nullptr;
+        span->run_frames[1] = frames - firstRun;
+    }
+
+    void addRelaxed (std::atomic<uint64_t>& counter)
+    {
+        counter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Any new value tells the writer a reader is polling (see SharedSegmentExtension::readerHeartbeat)
+    void beat (ast_ring& ring)
+    {
+        if (ring.layoutVersion >= 10)
+            ring.extension->readerHeartbeat.store(++ring.heartbeat, std::memory_order_relaxed);
+    }
+
+    // Wakeup fd slices are long: the writer signals every commit, this only bounds how
+    // late an inactive writer or a timeout is noticed, and keeps the heartbeat going
+    constexpr int WAKEUP_SLICE_MS = 100;
+
+    // An eventfd wants exactly 8 bytes; a pipe standing in for one takes them as well
+    void signalWakeup (int fd)
+    {
+        const uint64_t one = 1;
+        while (write(fd, &one, sizeof(one)) == -1 && errno == EINTR)
+        {
+        }
+    }
+
+    // Reader side of the wakeupWaiters protocol (SharedSegmentExtension.h). Registering
+    // before the re-check, with a full fence on both sides, means the writer either
+    // sees this waiter and signals, or the re-check sees its commit.
+    template <typename Condition>
+    int waitForWakeup (ast_ring& ring, int timeoutMs, Condition done)
+    {
+        auto& waiters = ring.extension->wakeupWaiters;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(0, timeoutMs));
+
+        for (;;)
+        {
+            waiters.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            const int result = done() ? AST_OK
+                             : !ring.active->load(std::memory_order_acquire) ? AST_INACTIVE
+                             : remaining <= 0 ? AST_TIMEOUT
+                             : AST_EMPTY;
+
+            pollfd request { ring.wakeupFd, POLLIN, 0 };
+            if (result == AST_EMPTY)
+                poll(&request, 1, static_cast<int>(std::min<long long>(WAKEUP_SLICE_MS, remaining + 1)));
+
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+
+            if (result != AST_EMPTY)
+                return result;
+
+            // Reset the counter; only read when poll says so, in case the fd blocks
+            uint64_t count = 0;
+            if ((request.revents & POLLIN) != 0)
+                (void) read(ring.wakeupFd, &count, sizeof(count));
+        }
+    }
+}
+
+//==============================================================================
+extern "C" int ast_compute_layout (size_t extension_offset, uint64_t min_frames, uint32_t stride,
+                                   uint32_t sample_format, ast_layout* layout)
+{
+    if (layout == nullptr || stride == 0 || stride > static_cast<uint32_t>(SharedSegmentExtension::MAX_CHANNELS)
+        || sample_format > SharedSegmentExtension::SAMPLE_FORMAT_FLOAT64 || min_frames > (uint64_t { 1 } << 40))
+        return AST_ERR_INVALID;
+
+    uint64_t capacity = 1;
+    while (capacity < min_frames)
+        capacity <<= 1;
+
+    // Same placement as SharedSegmentExtension::ringRegionOffsetFor: page aligned after the extension
+    layout->capacity_frames = capacity;
+    layout->stride = stride;
+    layout->sample_format = sample_format;
+    layout->headers_offset = (extension_offset + sizeof(SharedSegmentExtension) + 4095) & ~static_cast<uint64_t>(4095);
+
+    const uint64_t headerBytes = capacity * sizeof(SharedBlockHeader);
+    layout->data_offset = layout->headers_offset + ((headerBytes + 63) & ~static_cast<uint64_t>(63));
+    layout->segment_bytes = layout->data_offset + capacity * stride * bytesPerSampleFor(sample_format);
+    layout->period_frames = 0;
+    layout->reserved = 0;
+    return AST_OK;
+}
+
+extern "C" int ast_span_slice (const ast_span* span, uint32_t offset, uint32_t frames, ast_span* slice)
+{
+    if (span == nullptr || slice == nullptr || offset > span->frames || frames > span->frames - offset)
+        return AST_ERR_INVALID;
+
+    const size_t frameBytes = static_cast<size_t>(span->stride) * span->bytes_per_sample;
+    ast_span result = *span;
+    result.position = span->position + offset;
+    result.frames = frames;
+
+    if (offset < span->run_frames[0])
+    {
+        result.data[0] = static_cast<char*>(span->data[0]) + offset * frameBytes;
+        result.run_frames[0] = std::min(frames, span->run_frames[0] - offset);
+        result.run_frames[1] = frames - result.run_frames[0];
+        result.data[1] = result.run_frames[1] > 0 ? span->data[1] : nullptr;
+    }
+    else
+    {
+        result.data[0] = static_cast<char*>(span->data[1]) + (offset - span->run_frames[0]) * frameBytes;
+        result.run_frames[0] = frames;
+        result.data[1] = nullptr;
+        result.run_frames[1] = 0;
+    }
+
+    *slice = result;
+    return AST_OK;
+}
+
+extern "C" ast_ring* ast_attach (void* segment, size_t segment_bytes, size_t extension_offset)
+{
+    auto* ring = new (std::nothrow) ast_ring();
+    if (ring == nullptr)
+        return nullptr;
+
+    ring->extensionOffset = extension_offset;
+
+    if (!bindSegment(*ring, segment, segment_bytes) || ast_refresh(ring, nullptr, 0) < 0)
+    {
+        delete ring;
+        return nullptr;
+    }
+
+    return ring;
+}
+
+extern "C" void ast_detach (ast_ring* ring)
+{
+    delete ring;
+}
+
+extern "C" int ast_refresh (ast_ring* ring, void* segment, size_t segment_bytes)
+{
+    if (ring == nullptr)
+        return AST_ERR_INVALID;
+
+    if (segment != nullptr && !bindSegment(*ring, segment, segment_bytes))
+        return AST_ERR_LAYOUT;
+
+    auto& extension = *ring->extension;
+    const uint64_t before = extension.ringGeneration.load(std::memory_order_acquire);
+    if ((before & 1) != 0)
+        return AST_RECONFIGURED;
+
+    ast_layout layout {};
+    layout.capacity_frames = extension.ringCapacityFrames.load(std::memory_order_relaxed);
+    layout.stride = extension.ringStride.load(std::memory_order_relaxed);
+    layout.sample_format = extension.sampleFormat.load(std::memory_order_relaxed);
+    layout.headers_offset = extension.ringHeadersOffset.load(std::memory_order_relaxed);
+    layout.data_offset = extension.ringDataOffset.load(std::memory_order_relaxed);
+    layout.period_frames = ring->layoutVersion >= 9 ? extension.reblockFrames.load(std::memory_order_relaxed) : 0;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (extension.ringGeneration.load(std::memory_order_relaxed) != before)
+        return AST_RECONFIGURED;
+
+    if (!isValidLayout(layout, ring->mappedBytes))
+        return AST_ERR_LAYOUT;
+
+    applyLayout(*ring, layout);
+    ring->generation = before;
+    return AST_OK;
+}
+
+extern "C" int ast_get_layout (const ast_ring* ring, ast_layout* layout)
+{
+    if (ring == nullptr || layout == nullptr)
+        return AST_ERR_INVALID;
+
+    *layout = currentLayout(*ring);
+    return AST_OK;
+}
+
+extern "C" int ast_get_stats (const ast_ring* ring, ast_stats* stats)
+{
+    if (ring == nullptr || stats == nullptr)
+        return AST_ERR_INVALID;
+
+    const auto& extension = *ring->extension;
+    stats->write_index      = ring->writeIndex->load(std::memory_order_acquire);
+    stats->read_index       = ring->readIndex->load(std::memory_order_acquire);
+    stats->capacity_frames  = ring->capacity;
+    stats->segment_bytes    = extension.segmentBytes.load(std::memory_order_relaxed);
+    stats->generation       = extension.ringGeneration.load(std::memory_order_relaxed);
+    stats->overruns         = ring->overruns->load(std::memory_order_relaxed);
+    stats->underruns        = ring->underruns->load(std::memory_order_relaxed);
+    stats->offline_waits    = extension.offlineWaits.load(std::memory_order_relaxed);
+    stats->offline_timeouts = extension.offlineTimeouts.load(std::memory_order_relaxed);
+    stats->stride           = ring->stride;
+    stats->sample_format    = ring->format;
+    stats->layout_version   = extension.layoutVersion.load(std::memory_order_relaxed);
+    stats->flags            = (ring->active->load(std::memory_order_relaxed) ? static_cast<uint32_t>(AST_STATS_ACTIVE) : 0u)
+                            | (extension.offlineMode.load(std::memory_order_relaxed) != 0 ? static_cast<uint32_t>(AST_STATS_OFFLINE) : 0u);
+    return AST_OK;
+}
+
+//==============================================================================
+extern "C" int ast_begin_configure (ast_ring* ring)
+{
+    if (ring == nullptr)
+        return AST_ERR_INVALID;
+
+    // Odd generation: readers must not touch the ring until it turns even again
+    ring->extension->ringGeneration.fetch_add(1, std::memory_order_acq_rel);
+    return AST_OK;
+}
+
+extern "C" int ast_finish_configure (ast_ring* ring, void* segment, size_t segment_bytes, const ast_layout* layout)
+{
+    if (ring == nullptr || layout == nullptr)
+        return AST_ERR_INVALID;
+
+    if (segment != nullptr && !bindSegment(*ring, segment, segment_bytes))
+        return AST_ERR_LAYOUT;
+
+    if (!isValidLayout(*layout, ring->mappedBytes))
+        return AST_ERR_LAYOUT;
+
+    auto& extension = *ring->extension;
+    applyLayout(*ring, *layout);
+
+    // Clear only what this layout uses
+    std::memset(ring->headers, 0, static_cast<size_t>(ring->capacity) * sizeof(SharedBlockHeader));
+    std::memset(ring->data, 0, static_cast<size_t>(ring->capacity) * ring->stride * ring->bytesPerSample);
+
+    extension.sampleFormat.store(layout->sample_format, std::memory_order_relaxed);
+    extension.ringStride.store(layout->stride, std::memory_order_relaxed);
+    extension.ringCapacityFrames.store(layout->capacity_frames, std::memory_order_relaxed);
+    extension.ringHeadersOffset.store(layout->headers_offset, std::memory_order_relaxed);
+    extension.ringDataOffset.store(layout->data_offset, std::memory_order_relaxed);
+    extension.segmentBytes.store(ring->mappedBytes, std::memory_order_relaxed);
+    extension.reblockFrames.store(layout->period_frames, std::memory_order_relaxed);
+
+    // Restart empty: the old contents don't match the new layout. Fixed-period packets
+    // also need the positions rounded up to a period boundary (readers ignore the
+    // indexes while the generation is odd).
+    uint64_t restart = ring->writeIndex->load(std::memory_order_relaxed);
+    if (layout->period_frames > 0)
+    {
+        restart = RingIndex::alignUp(restart, layout->period_frames);
+        ring->writeIndex->store(restart, std::memory_order_release);
+    }
+
+    ring->readIndex->store(restart, std::memory_order_release);
+
+    ring->generation = extension.ringGeneration.fetch_add(1, std::memory_order_release) + 1;
+    return AST_OK;
+}
+
+extern "C" int ast_cancel_configure (ast_ring* ring)
+{
+    if (ring == nullptr)
+        return AST_ERR_INVALID;
+
+    ring->generation = ring->extension->ringGeneration.fetch_add(1, std::memory_order_release) + 1;
+    return AST_OK;
+}
+
+//==============================================================================
+extern "C" uint64_t ast_write_space (const ast_ring* ring)
+{
+    if (ring == nullptr || ring->capacity == 0)
+        return 0;
+
+    const uint64_t written = ring->writeIndex->load(std::memory_order_relaxed);
+    const uint64_t read = ring->readIndex->load(std::memory_order_acquire);
+    return RingIndex::space(ring->capacity, written, read);
+}
+
+extern "C" int ast_write_reserve (ast_ring* ring, uint32_t frames, ast_span* span)
+{
+    if (ring == nullptr || span == nullptr || frames == 0)
+        return AST_ERR_INVALID;
+
+    if (frames > ast_write_space(ring))
+        return AST_FULL;
+
+    fillSpan(*ring, ring->writeIndex->load(std::memory_order_relaxed), frames, ring->generation, span);
+    return AST_OK;
+}
+
+extern "C" int ast_write_commit (ast_ring* ring, const ast_span* span, uint64_t sequence, double timestamp)
+{
+    if (ring == nullptr || span == nullptr || span->position != ring->writeIndex->load(std::memory_order_relaxed)
+        || (ring->period > 0 && span->frames != ring->period))
+        return AST_ERR_INVALID;
+
+    auto& header = ring->headers[RingIndex::slot(span->position, ring->mask)];
+    header.sequenceNumber = sequence;
+    header.timestamp = timestamp;
+    header.blockSize = span->frames;
+    header.numChannels = ring->stride;
+
+    // The release store orders the audio, the header and anything else written for this
+    // block (e.g. events) before the reader can see the new writeIndex
+    ring->writeIndex->store(span->position + span->frames, std::memory_order_release);
+
+    // Wake readers blocked on the next block. Realtime readers poll, so the syscall is
+    // only paid during offline renders.
+    if (ring->extension->offlineMode.load(std::memory_order_relaxed) != 0)
+        SharedMemoryWait::notify(ring->extension->writerNotify);
+
+    // A reader sleeping on the wakeup fd costs one write per commit; nobody sleeping, none
+    if (ring->wakeupFd >= 0)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ring->extension->wakeupWaiters.load(std::memory_order_relaxed) != 0)
+            signalWakeup(ring->wakeupFd);
+    }
+
+    return AST_OK;
+}
+
+extern "C" void ast_write_overrun (ast_ring* ring)
+{
+    if (ring != nullptr)
+        addRelaxed(*ring->overruns);
+}
+
+extern "C" int ast_write_restart (ast_ring* ring)
+{
+    if (ring == nullptr)
+        return AST_ERR_INVALID;
+
+    // Same window as a resize, so readers drop whatever they were reading, but nothing
+    // moves: only readIndex jumps to the (period-aligned) write position
+    auto& extension = *ring->extension;
+    extension.ringGeneration.fetch_add(1, std::memory_order_acq_rel);
+    ring->readIndex->store(ring->writeIndex->load(std::memory_order_relaxed), std::memory_order_release);
+    ring->generation = extension.ringGeneration.fetch_add(1, std::memory_order_release) + 1;
+    return AST_OK;
+}
+
+extern "C" int ast_wait_for_space (ast_ring* ring, uint32_t frames, int timeout_ms)
+{
+    // Only meant for non-realtime renders: block (without spinning) until the reader has
+    // consumed enough frames, so the render is lossless. The timeout keeps a vanished
+    // reader from deadlocking the host's bounce.
+    if (ring == nullptr || ring->capacity == 0 || frames > ring->capacity)
+        return AST_ERR_INVALID;
+
+    addRelaxed(ring->extension->offlineWaits);
+
+    // Readers that don't signal readerNotify are still picked up by the re-check after
+    // each short wait.
+    const int result = waitFor(*ring, ring->extension->readerNotify, timeout_ms, 10,
+                               [ring, frames] { return ast_write_space(ring) >= frames; });
+
+    if (result == AST_TIMEOUT)
+        addRelaxed(ring->extension->offlineTimeouts);
+
+    return result;
+}
+
+//==============================================================================
+extern "C" int ast_read_acquire (ast_ring* ring, uint32_t max_frames, ast_span* span)
+{
+    if (ring == nullptr || span == nullptr)
+        return AST_ERR_INVALID;
+
+    beat(*ring);
+
+    const uint64_t generation = ring->extension->ringGeneration.load(std::memory_order_acquire);
+    if (generation != ring->generation)
+        return AST_RECONFIGURED;
+
+    const uint64_t read = ring->readIndex->load(std::memory_order_relaxed);
+    const uint64_t written = ring->writeIndex->load(std::memory_order_acquire);
+
+    if (ring->capacity == 0 || written == read || max_frames == 0)
+        return AST_EMPTY;
+
+    // More than a ring's worth can only mean the writer restarted the ring under us
+    if (RingIndex::queued(written, read) > ring->capacity)
+        return AST_RECONFIGURED;
+
+    fillSpan(*ring, read, static_cast<uint32_t>(std::min<uint64_t>(RingIndex::queued(written, read), max_frames)), generation, span);
+    return AST_OK;
+}
+
+extern "C" int ast_read_header (const ast_ring* ring, uint64_t position, ast_block_header* header)
+{
+    if (ring == nullptr || header == nullptr || ring->capacity == 0)
+        return AST_ERR_INVALID;
+
+    std::memcpy(header, &ring->headers[RingIndex::slot(position, ring->mask)], sizeof(ast_block_header));
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return ring->extension->ringGeneration.load(std::memory_order_relaxed) == ring->generation ? AST_OK : AST_RECONFIGURED;
+}
+
+extern "C" int ast_read_release (ast_ring* ring, const ast_span* span)
+{
+    if (ring == nullptr || span == nullptr)
+        return AST_ERR_INVALID;
+
+    // A resize or restart moved readIndex while the span was being read: it is gone, and
+    // storing readIndex now would corrupt the new ring
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (ring->extension->ringGeneration.load(std::memory_order_relaxed) != span->generation)
+        return AST_RECONFIGURED;
+
+    // The writer may still restart between the check above and here. Its readIndex is
+    // always past the span, so only advancing from span->position keeps a stale release
+    // from dragging readIndex back behind the restart.
+    uint64_t expected = span->position;
+    if (!ring->readIndex->compare_exchange_strong(expected, span->position + span->frames,
+                                                  std::memory_order_acq_rel, std::memory_order_relaxed))
+        return AST_RECONFIGURED;
+
+    // Only an offline writer ever waits for space, so only then is the wake worth a syscall
+    if (ring->extension->offlineMode.load(std::memory_order_relaxed) != 0)
+        SharedMemoryWait::notify(ring->extension->readerNotify);
+    else
+        ring->extension->readerNotify.fetch_add(1, std::memory_order_release);
+
+    return AST_OK;
+}
+
+extern "C" void ast_read_underrun (ast_ring* ring)
+{
+    if (ring != nullptr)
+        addRelaxed(*ring->underruns);
+}
+
+extern "C" int ast_wait_for_data (ast_ring* ring, int timeout_ms)
+{
+    if (ring == nullptr)
+        return AST_ERR_INVALID;
+
+    if (ring->wakeupFd >= 0)
+        return waitForWakeup(*ring, timeout_ms,
+                             [ring]
+                             {
+                                 beat(*ring);
+                                 return ring->writeIndex->load(std::memory_order_acquire) != ring->readIndex->load(std::memory_order_relaxed);
+                             });
+
+    // Otherwise the writer only signals writerNotify while offline, so in real time this
+    // polls in 1 ms slices
+    return waitFor(*ring, ring->extension->writerNotify, timeout_ms,
+                   ring->extension->offlineMode.load(std::memory_order_relaxed) != 0 ? 10 : 1,
+                   [ring]
+                   {
+                       beat(*ring);
+                       return ring->writeIndex->load(std::memory_order_acquire) != ring->readIndex->load(std::memory_order_relaxed);
+                   });
+}
+
+extern "C" int ast_set_wakeup_fd (ast_ring* ring, int fd)
+{
+    if (ring == nullptr || fd < -1)
+        return AST_ERR_INVALID;
+
+    if (fd >= 0 && ring->layoutVersion < 12)
+        return AST_ERR_LAYOUT;
+
+    ring->wakeupFd = fd;
+    return AST_OK;
+}
@@ -0,0 +1,263 @@
+/*
+    AudioSender transport core: the shared memory ring protocol as a small C library.
+
+    This is the one implementation of the writer and reader sides of the audio ring
+    described in SharedSegmentExtension.h. The plugin links it as a static library,
+    and receivers, tools and benchmarks in any language can use the same code through
+    this C ABI. It has no JUCE dependency.
+
+    A segment is attached by pointing a handle at an existing mapping. Every protocol
+    word is then found through the extension block (layout version 8+) at
+    extension_offset. For segments created by the plugin under the shm name that offset
+    is SharedSegmentExtension::offsetFor() of the start of SharedAudioData's legacy
+    audioData/blockHeaders arrays (layout version 13+). Senders in the anonymous
+    segment mode have no shm name; ast_connect() fetches their segment, with the offset.
+
+    Threading: one writer and one reader per ring. Each side uses its own handle. The
+    reserve/commit and acquire/release calls never allocate, lock or make system calls.
+    The only exceptions are the wait functions, and commit while the host is rendering
+    offline or a reader sleeps on the wakeup fd, which wakes that reader.
+
+    Both sides work in place, without staging copies. A writer reserves frames, renders
+    straight into the (at most two, split at the wrap) runs of ring memory and commits;
+    a reader acquires, processes the runs where they are and releases:
+
+        ast_span span;
+        if (ast_write_reserve(ring, frames, &span) == AST_OK)
+        {
+            render(span.data[0], span.run_frames[0]);
+            render(span.data[1], span.run_frames[1]);
+            ast_write_commit(ring, &span, sequence, now);
+        }
+*/
+#ifndef AUDIOSENDER_TRANSPORT_H
+#define AUDIOSENDER_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AST_ABI_VERSION 1
+
+/* Return codes. Negative values are errors; positive values are expected outcomes. */
+enum
+{
+    AST_OK            = 0,
+    AST_ERR_INVALID   = -1,  /* Bad argument or handle */
+    AST_ERR_LAYOUT    = -2,  /* No valid extension block at the given offset, or too old a layout */
+    AST_ERR_SYSTEM    = -3,  /* A system call failed; errno says why */
+    AST_ERR_DENIED    = -4,  /* Handshake: the peer is another user, or not an AudioSender */
+    AST_FULL          = 1,   /* Writer: not enough free space */
+    AST_EMPTY         = 2,   /* Reader: nothing to read */
+    AST_RECONFIGURED  = 3,   /* The ring is being or has been resized; call ast_refresh() */
+    AST_TIMEOUT       = 4,
+    AST_INACTIVE      = 5    /* The writer has shut the segment down */
+};
+
+enum
+{
+    AST_FORMAT_FLOAT32 = 0,
+    AST_FORMAT_FLOAT64 = 1
+};
+
+typedef struct ast_ring ast_ring;
+
+/* Where the ring lives inside the segment; see ast_compute_layout(). */
+typedef struct ast_layout
+{
+    uint64_t capacity_frames;    /* Power of two */
+    uint32_t stride;             /* Interleaved channels per frame */
+    uint32_t sample_format;      /* AST_FORMAT_* */
+    uint64_t headers_offset;     /* Byte offsets from the start of the segment */
+    uint64_t data_offset;
+    uint64_t segment_bytes;      /* Smallest segment that holds this layout */
+    uint32_t period_frames;      /* 0, or a power of two: every block is exactly this long
+                                    and starts at a multiple of it, so it never wraps */
+    uint32_t reserved;
+} ast_layout;
+
+/* A run of frames in ring memory, split into at most two contiguous parts at the wrap. */
+typedef struct ast_span
+{
+    uint64_t position;           /* Ring position of the first frame */
+    uint64_t generation;         /* Ring generation the span belongs to */
+    uint32_t frames;             /* run_frames[0] + run_frames[1] */
+    uint32_t stride;
+    uint32_t bytes_per_sample;
+    uint32_t reserved;
+    void*    data[2];            /* data[1] is NULL unless the span wraps */
+    uint32_t run_frames[2];
+} ast_span;
+
+/* Per-block metadata, stored at header slot (position & (capacity_frames - 1)). */
+typedef struct ast_block_header
+{
+    uint64_t sequence;
+    double   timestamp;          /* Seconds, writer's clock */
+    uint32_t frames;
+    uint32_t channels;
+} ast_block_header;
+
+typedef struct ast_stats
+{
+    uint64_t write_index;
+    uint64_t read_index;
+    uint64_t capacity_frames;
+    uint64_t segment_bytes;      /* Size the writer wants mapped (see ast_refresh()) */
+    uint64_t generation;
+    uint64_t overruns;
+    uint64_t underruns;
+    uint64_t offline_waits;
+    uint64_t offline_timeouts;
+    uint32_t stride;
+    uint32_t sample_format;
+    uint32_t layout_version;
+    uint32_t flags;              /* AST_STATS_* */
+} ast_stats;
+
+enum
+{
+    AST_STATS_ACTIVE  = 1,       /* The writer's segment is live */
+    AST_STATS_OFFLINE = 2        /* The host is rendering faster than real time */
+};
+
+/* ---- Layout -------------------------------------------------------------------- */
+
+/* Computes the ring layout for at least min_frames frames of stride channels, with
+   period_frames 0 (blocks of any size). Set period_frames afterwards for fixed-period
+   packets; it must be a power of two no larger than half the capacity. */
+int ast_compute_layout(size_t extension_offset, uint64_t min_frames, uint32_t stride,
+                       uint32_t sample_format, ast_layout* layout);
+
+/* Narrows a span to frames [offset, offset + frames) of it, e.g. to render part of a
+   reserved packet. */
+int ast_span_slice(const ast_span* span, uint32_t offset, uint32_t frames, ast_span* slice);
+
+/* ---- Attach -------------------------------------------------------------------- */
+
+/* Returns NULL if there is no valid extension block at extension_offset. */
+ast_ring* ast_attach(void* segment, size_t segment_bytes, size_t extension_offset);
+void      ast_detach(ast_ring* ring);
+
+/* Reloads the geometry after AST_RECONFIGURED (or after the caller remapped the
+   segment, in which case segment/segment_bytes give the new mapping; pass NULL/0 to
+   keep the current one). Returns AST_RECONFIGURED while a resize is still in progress,
+   and AST_ERR_LAYOUT if the ring no longer fits the mapping: remap
+   ast_stats.segment_bytes and refresh again. */
+int ast_refresh(ast_ring* ring, void* segment, size_t segment_bytes);
+
+int ast_get_layout(const ast_ring* ring, ast_layout* layout);
+int ast_get_stats(const ast_ring* ring, ast_stats* stats);
+
+/* ---- Writer -------------------------------------------------------------------- */
+
+/* Resize protocol (writer only, never concurrently with reserve/commit):
+   ast_begin_configure() marks the ring as resizing. The caller then grows and remaps
+   the segment if layout->segment_bytes requires it, and rewrites anything that has to
+   change together with the layout (such as the channel map). ast_finish_configure()
+   clears and publishes the new layout, restarts the ring empty and marks it stable
+   again; ast_cancel_configure() keeps the old layout instead. */
+int ast_begin_configure(ast_ring* ring);
+int ast_finish_configure(ast_ring* ring, void* segment, size_t segment_bytes, const ast_layout* layout);
+int ast_cancel_configure(ast_ring* ring);
+
+uint64_t ast_write_space(const ast_ring* ring);
+
+/* Reserves frames at the write position. Returns AST_FULL (and counts nothing) if
+   there isn't room. Write the audio into span->data, then commit. */
+int ast_write_reserve(ast_ring* ring, uint32_t frames, ast_span* span);
+
+/* Writes the block header and publishes the span to the reader. With a nonzero
+   period_frames the span must be exactly one period long. */
+int ast_write_commit(ast_ring* ring, const ast_span* span, uint64_t sequence, double timestamp);
+
+/* Counts a block the writer had to drop. */
+void ast_write_overrun(ast_ring* ring);
+
+/* Drops everything queued and restarts the ring empty at the write position, keeping
+   the layout. Readers see AST_RECONFIGURED once and refresh. Cheap enough for the
+   audio thread. */
+int ast_write_restart(ast_ring* ring);
+
+/* Offline renders: sleeps until frames of space are free, the timeout expires
+   (AST_TIMEOUT) or the segment goes inactive (AST_INACTIVE). */
+int ast_wait_for_space(ast_ring* ring, uint32_t frames, int timeout_ms);
+
+/* ---- Reader -------------------------------------------------------------------- */
+
+/* Acquires up to max_frames of unread audio (and signals the reader's presence).
+   Returns AST_EMPTY, or AST_RECONFIGURED if the ring was resized or restarted (call
+   ast_refresh()). The writer leaves the data alone until release, unless it resizes
+   or restarts the ring meanwhile: then release returns AST_RECONFIGURED and whatever
+   was read from the span may be torn and has to be discarded. With a nonzero
+   period_frames, acquiring period_frames yields exactly one packet in a single run. */
+int ast_read_acquire(ast_ring* ring, uint32_t max_frames, ast_span* span);
+
+int ast_read_header(const ast_ring* ring, uint64_t position, ast_block_header* header);
+
+/* Marks the span as consumed and wakes a writer waiting for space. Returns
+   AST_RECONFIGURED (and consumes nothing) if the ring was resized or restarted
+   meanwhile, even if that happens during the call. */
+int ast_read_release(ast_ring* ring, const ast_span* span);
+
+/* Counts a period the reader couldn't fill. */
+void ast_read_underrun(ast_ring* ring);
+
+/* Sleeps until audio is available beyond the read position, or the timeout expires,
+   signalling the reader's presence while it waits. With a wakeup fd set it sleeps on
+   that, otherwise it polls (or waits on a futex while offline). */
+int ast_wait_for_data(ast_ring* ring, int timeout_ms);
+
+/* ---- Anonymous segments ------------------------------------------------------------ */
+
+/* In the anonymous segment mode the sender keeps its segment in a sealed memfd (it can
+   grow, never shrink) and listens on a Unix domain socket. Each connection is answered
+   with one ast_handshake plus, as SCM_RIGHTS, the segment fd and an eventfd for
+   wakeups, then closed. Both ends check that the other runs as the same user, so a
+   name squatted by another user is refused as well. Socket paths starting with '@'
+   are in the Linux abstract namespace, so nothing is left on disk either.
+
+       ast_handshake info;
+       int segment_fd, wakeup_fd;
+       if (ast_connect("@audiosender-1234-1", 1000, &info, &segment_fd, &wakeup_fd) == AST_OK)
+       {
+           void* segment = mmap(NULL, info.segment_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, segment_fd, 0);
+           ast_ring* ring = ast_attach(segment, info.segment_bytes, info.extension_offset);
+           ast_set_wakeup_fd(ring, wakeup_fd);
+       }
+
+   The fds stay valid for as long as the receiver keeps them, however the sender exits.
+   After a resize remap ast_stats.segment_bytes of the same segment_fd. */
+#define AST_HANDSHAKE_MAGIC 0x41534853u  /* 'ASHS' */
+
+typedef struct ast_handshake
+{
+    uint32_t magic;              /* AST_HANDSHAKE_MAGIC */
+    uint32_t layout_version;     /* SharedSegmentExtension::LAYOUT_VERSION of the sender */
+    uint64_t extension_offset;   /* Pass to ast_attach() */
+    uint64_t segment_bytes;      /* Current size of the segment */
+} ast_handshake;
+
+/* Receiver: connects to the sender's socket and receives the segment. Returns
+   AST_ERR_DENIED, taking nothing, if the socket belongs to another user (anyone can
+   bind an abstract name first) or the reply isn't a handshake. *wakeup_fd is -1 if
+   the sender has no eventfd. Both fds are close-on-exec and belong to the caller. */
+int ast_connect(const char* socket_path, int timeout_ms, ast_handshake* info, int* segment_fd, int* wakeup_fd);
+
+/* Sender: answers an accepted connection. Returns AST_ERR_DENIED, sending nothing, if
+   the peer runs as another user. wakeup_fd may be -1. */
+int ast_handshake_send(int connection_fd, const ast_handshake* info, int segment_fd, int wakeup_fd);
+
+/* Either side. The writer signals fd after each commit while a reader sleeps on it, and
+   ast_wait_for_data() sleeps on it (see SharedSegmentExtension::wakeupWaiters). Needs
+   layout version 12+. The handle doesn't own fd; pass -1 to stop using it. */
+int ast_set_wakeup_fd(ast_ring* ring, int fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
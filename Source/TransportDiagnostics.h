@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "BlockInstrumentation.h"
+#include "Transport/SharedSegmentExtension.h"
+
+//==============================================================================
+// Lock-free transport diagnostics, written by the audio thread once per block and
+// sampled by the editor's diagnostics view.
+//
+// Every field is a relaxed atomic that only the audio thread writes, so recording
+// costs a handful of plain stores and the UI can read at any rate without locks.
+// A reader may see a history entry or histogram bin from one block and a counter from
+// the next, which is fine for a display.
+//==============================================================================
+struct TransportDiagnostics
+{
+    // Ring fill (0..1) of the most recent blocks, oldest overwritten first
+    static constexpr uint32_t FILL_HISTORY_SIZE = 256;
+    static constexpr uint32_t FILL_HISTORY_MASK = FILL_HISTORY_SIZE - 1;
+
+    // Queued latency histogram: LATENCY_BIN_MS wide bins, the last one catches everything above
+    static constexpr int LATENCY_BINS = 40;
+    static constexpr double LATENCY_BIN_MS = 5.0;
+
+    std::atomic<float> fillHistory[FILL_HISTORY_SIZE] {};
+    std::atomic<uint32_t> fillHistoryWrite { 0 };
+
+    std::atomic<uint64_t> latencyHistogram[LATENCY_BINS] {};
+
+    std::atomic<uint64_t> blocksProcessed { 0 };
+    std::atomic<int> blockSize { 0 };             // Frames per published block (the reblock period if set)
+    std::atomic<uint64_t> ringCapacity { 0 };     // Copies of the ring's format, set when it is configured
+    std::atomic<bool> float64 { false };
+
+    // Callback times come from the same clock reads as BlockInstrumentation's, so the
+    // stage timings add up to callbackMs
+    std::atomic<double> callbackMs { 0.0 };       // Time spent in the last processBlock
+    std::atomic<double> callbackPeakMs { 0.0 };   // Worst processBlock time since the last reset
+    std::atomic<double> callbackIntervalMs { 0.0 };
+
+    // Last time (BlockInstrumentation::nowMs) the receiver was seen advancing readIndex
+    std::atomic<double> lastReaderProgressMs { 0.0 };
+
+    // Receiver presence (readIndex or heartbeat moving) and the idle mode it drives
+    std::atomic<bool> receiverPresent { false };
+    std::atomic<uint64_t> idleBlocks { 0 };   // Blocks not published for lack of a receiver
+    std::atomic<uint64_t> resyncs { 0 };      // Stream restarts when a receiver appeared
+
+    // Offline blocks dropped without waiting, while the receiver was stalled
+    std::atomic<uint64_t> offlineDrops { 0 };
+
+    void recordBlock (double fill, double queuedMs, double durationMs, double intervalMs, bool readerProgressed, double nowMs)
+    {
+        const uint32_t slot = fillHistoryWrite.load(std::memory_order_relaxed);
+        fillHistory[slot & FILL_HISTORY_MASK].store(static_cast<float>(fill), std::memory_order_relaxed);
+        fillHistoryWrite.store(slot + 1, std::memory_order_release);
+
+        int bin = static_cast<int>(queuedMs / LATENCY_BIN_MS);
+        bin = bin < 0 ? 0 : (bin >= LATENCY_BINS ? LATENCY_BINS - 1 : bin);
+        latencyHistogram[bin].store(latencyHistogram[bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        blocksProcessed.store(blocksProcessed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        callbackMs.store(durationMs, std::memory_order_relaxed);
+        if (durationMs > callbackPeakMs.load(std::memory_order_relaxed))
+            callbackPeakMs.store(durationMs, std::memory_order_relaxed);
+        callbackIntervalMs.store(intervalMs, std::memory_order_relaxed);
+
+        if (readerProgressed)
+            lastReaderProgressMs.store(nowMs, std::memory_order_relaxed);
+    }
+};
+
+//==============================================================================
+// Plain copy of everything the diagnostics view and metrics exporter show, taken
+// off the audio thread.
+struct TransportDiagnosticsSnapshot
+{
+    float fillHistory[TransportDiagnostics::FILL_HISTORY_SIZE] {};   // Oldest first
+    uint64_t latencyHistogram[TransportDiagnostics::LATENCY_BINS] {};
+
+    bool connected = false;
+    double sampleRate = 0.0;
+    int numChannels = 0;
+    int blockSize = 0;
+    bool float64 = false;
+    int targetLatencyMs = 0;
+    uint64_t ringCapacity = 0;
+    uint64_t writeIndex = 0;
+    uint64_t readIndex = 0;
+    uint64_t configurationCounter = 0;
+    uint64_t ringGeneration = 0;
+    uint64_t eventOverruns = 0;
+
+    uint64_t blocksProcessed = 0;
+    uint64_t overruns = 0;
+    uint64_t underruns = 0;
+    uint64_t returnUnderruns = 0;
+    double callbackMs = 0.0;
+    double callbackPeakMs = 0.0;
+    double callbackIntervalMs = 0.0;
+    double readerHeartbeatAgeMs = -1.0;   // -1 until the receiver has been seen reading
+    bool receiverPresent = false;
+    uint64_t idleBlocks = 0;
+    uint64_t resyncs = 0;
+    uint64_t offlineDrops = 0;
+
+    // Aggregation lane (see AggregateLane)
+    uint64_t aggregationDroppedBlocks = 0;
+    uint64_t aggregationOversizedBlocks = 0;
+    int aggregationTruncatedChannels = 0;
+
+    // Loudness per enabled input bus (see LoudnessAnalyzer)
+    struct BusLoudness
+    {
+        float momentaryLufs = SharedSegmentExtension::LOUDNESS_FLOOR_DB;
+        float shortTermLufs = SharedSegmentExtension::LOUDNESS_FLOOR_DB;
+        float integratedLufs = SharedSegmentExtension::LOUDNESS_FLOOR_DB;
+        float truePeakDbtp = SharedSegmentExtension::LOUDNESS_FLOOR_DB;
+    };
+
+    int loudnessBuses = 0;
+    BusLoudness loudness[SharedSegmentExtension::MAX_LOUDNESS_BUSES];
+
+    // processBlock stage timing (see BlockInstrumentation); instrumented is false, and
+    // the rest zero, when it is compiled out
+    bool instrumented = false;
+    uint64_t stageHistogram[BlockInstrumentation::NUM_STAGES][BlockInstrumentation::TIME_BINS] {};
+    uint64_t stageTotalNs[BlockInstrumentation::NUM_STAGES] {};
+    uint64_t callbackHistogram[BlockInstrumentation::TIME_BINS] {};
+    uint64_t intervalHistogram[BlockInstrumentation::TIME_BINS] {};
+    uint64_t loadHistogram[BlockInstrumentation::LOAD_BINS] {};
+    uint64_t instrumentedCallbacks = 0;
+    uint64_t deadlineMisses = 0;
+
+    // Upper edge of the histogram bin containing the given fraction (0..1) of blocks
+    double latencyPercentileMs (double fraction) const
+    {
+        uint64_t total = 0;
+        for (const auto count : latencyHistogram)
+            total += count;
+
+        if (total == 0)
+            return 0.0;
+
+        const auto threshold = static_cast<uint64_t>(fraction * static_cast<double>(total));
+        uint64_t cumulative = 0;
+
+        for (int bin = 0; bin < TransportDiagnostics::LATENCY_BINS; ++bin)
+        {
+            cumulative += latencyHistogram[bin];
+            if (cumulative > threshold)
+                return (bin + 1) * TransportDiagnostics::LATENCY_BIN_MS;
+        }
+
+        return TransportDiagnostics::LATENCY_BINS * TransportDiagnostics::LATENCY_BIN_MS;
+    }
+};